@@ -0,0 +1,169 @@
+/*
+  This file is a part of DSRC software distributed under GNU GPL 2 licence.
+  The homepage of the DSRC project is http://sun.aei.polsl.pl/dsrc
+  
+  Authors: Lucas Roguski and Sebastian Deorowicz
+  
+  Version: 2.00
+*/
+
+// microbenchmark of the bit memory reader and writer: the access patterns
+// of the models are replayed -- variable width fields as written by the tag
+// model, single and 2-bit symbols as by the DNA model and the peek/skip
+// pairs of the Huffman table decoding -- reporting the throughput in MB/s
+//
+// usage: BitIoBench [fields count]
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+#include "../src/BitMemory.h"
+
+using namespace dsrc;
+
+struct Field
+{
+	uint32 value;
+	uint32 bits;
+};
+
+// field widths skewed towards the short ones, as in the tag and Huffman streams
+void GenerateFields(std::vector<Field>& fields_, uint32 count_, uint32 maxBits_)
+{
+	fields_.resize(count_);
+	uint32 seed = 12345;
+	for (uint32 i = 0; i < count_; ++i)
+	{
+		seed = seed * 1103515245 + 12345;
+		uint32 r = seed >> 8;
+		uint32 bits = 1 + ((r & 0xFF) * (r & 0xFF) * maxBits_ >> 16);
+		if (bits > maxBits_)
+			bits = maxBits_;
+		fields_[i].bits = bits;
+		fields_[i].value = (seed ^ (seed >> 13)) & ((1U << bits) - 1);
+	}
+}
+
+double Seconds(std::chrono::high_resolution_clock::time_point start_)
+{
+	return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start_).count();
+}
+
+void Report(const char* name_, uint64 bytes_, double writeTime_, double readTime_, bool ok_)
+{
+	std::cout << std::left << std::setw(12) << name_ << std::right << std::fixed << std::setprecision(1)
+			  << std::setw(12) << bytes_ / writeTime_ / (1 << 20)
+			  << std::setw(12) << bytes_ / readTime_ / (1 << 20)
+			  << (ok_ ? "" : "  MISMATCH") << std::endl;
+}
+
+bool BenchFields(const std::vector<Field>& fields_)
+{
+	core::BitMemoryWriter writer;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (const Field& f : fields_)
+		writer.PutBits(f.value, f.bits);
+	writer.Flush();
+	double writeTime = Seconds(start);
+
+	core::BitMemoryReader reader(writer.Pointer(), writer.Position());
+	bool ok = true;
+
+	start = std::chrono::high_resolution_clock::now();
+	for (const Field& f : fields_)
+		ok &= (reader.GetBits(f.bits) == f.value);
+	double readTime = Seconds(start);
+
+	Report("fields", writer.Position(), writeTime, readTime, ok);
+	return ok;
+}
+
+bool BenchSymbols(const std::vector<Field>& fields_)
+{
+	core::BitMemoryWriter writer;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (const Field& f : fields_)
+	{
+		if (f.bits & 1)
+			writer.PutBit(f.value & 1);
+		else
+			writer.Put2Bits(f.value & 3);
+	}
+	writer.Flush();
+	double writeTime = Seconds(start);
+
+	core::BitMemoryReader reader(writer.Pointer(), writer.Position());
+	bool ok = true;
+
+	start = std::chrono::high_resolution_clock::now();
+	for (const Field& f : fields_)
+	{
+		if (f.bits & 1)
+			ok &= (reader.GetBit() == (f.value & 1));
+		else
+			ok &= (reader.Get2Bits() == (f.value & 3));
+	}
+	double readTime = Seconds(start);
+
+	Report("bit/2-bit", writer.Position(), writeTime, readTime, ok);
+	return ok;
+}
+
+// the Huffman decoder peeks a fixed number of bits and skips the code length
+bool BenchPeekSkip(const std::vector<Field>& fields_)
+{
+	const uint32 lookupBits = 11;
+
+	core::BitMemoryWriter writer;
+	for (const Field& f : fields_)
+		writer.PutBits(f.value, f.bits);
+	writer.Flush();
+
+	core::BitMemoryReader reader(writer.Pointer(), writer.Position());
+	bool ok = true;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (const Field& f : fields_)
+	{
+		uint32 v = reader.PeekBits(lookupBits) >> (lookupBits - f.bits);
+		reader.SkipBits(f.bits);
+		ok &= (v == f.value);
+	}
+	double readTime = Seconds(start);
+
+	std::cout << std::left << std::setw(12) << "peek/skip" << std::right << std::fixed << std::setprecision(1)
+			  << std::setw(12) << "-"
+			  << std::setw(12) << writer.Position() / readTime / (1 << 20)
+			  << (ok ? "" : "  MISMATCH") << std::endl;
+	return ok;
+}
+
+int main(int argc_, char* argv_[])
+{
+	const uint32 count = argc_ > 1 ? atoi(argv_[1]) : 20000000;
+
+	if (count == 0)
+	{
+		std::cerr << "usage: BitIoBench [fields count]" << std::endl;
+		return -1;
+	}
+
+	std::vector<Field> fields;
+
+	std::cout << "fields: " << count << ", MB/s of the bit stream:" << std::endl;
+	std::cout << "pattern            write        read" << std::endl;
+
+	GenerateFields(fields, count, 31);
+	bool ok = BenchFields(fields);
+	ok &= BenchSymbols(fields);
+
+	GenerateFields(fields, count, 11);
+	ok &= BenchPeekSkip(fields);
+
+	return ok ? 0 : -1;
+}
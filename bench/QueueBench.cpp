@@ -0,0 +1,107 @@
+/*
+  This file is a part of DSRC software distributed under GNU GPL 2 licence.
+  The homepage of the DSRC project is http://sun.aei.polsl.pl/dsrc
+  
+  Authors: Lucas Roguski and Sebastian Deorowicz
+  
+  Version: 2.00
+*/
+
+// microbenchmark of the parts queues: producers push parts which are popped
+// by consumers, as between the reader, the workers and the writer
+//
+// usage: QueueBench [producers] [consumers] [parts per producer] [queue size]
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+
+#include "../src/DataQueue.h"
+
+using namespace dsrc;
+
+struct Part
+{
+	uint64 value;
+};
+
+template <class _TQueue>
+double RunBenchmark(uint32 producers_, uint32 consumers_, uint32 partNum_, uint32 queueSize_, uint64& checksum_)
+{
+	_TQueue queue(queueSize_, producers_);
+	std::vector<Part> parts(queueSize_ + 1);
+	std::vector<uint64> sums(consumers_, 0);
+	std::vector<std::thread> threads;
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	for (uint32 p = 0; p < producers_; ++p)
+	{
+		threads.push_back(std::thread([&, p]()
+		{
+			for (uint32 i = 0; i < partNum_; ++i)
+				queue.Push((int64)p * partNum_ + i, &parts[i % parts.size()]);
+			queue.SetCompleted();
+		}));
+	}
+
+	for (uint32 c = 0; c < consumers_; ++c)
+	{
+		threads.push_back(std::thread([&, c]()
+		{
+			int64 partId;
+			Part* part;
+			uint64 sum = 0;
+			while (queue.Pop(partId, part))
+				sum += (uint64)partId;
+			sums[c] = sum;
+		}));
+	}
+
+	for (std::thread& t : threads)
+		t.join();
+
+	const auto stop = std::chrono::high_resolution_clock::now();
+
+	checksum_ = 0;
+	for (uint64 s : sums)
+		checksum_ += s;
+
+	return std::chrono::duration<double>(stop - start).count();
+}
+
+int main(int argc_, char* argv_[])
+{
+	const uint32 producers = argc_ > 1 ? atoi(argv_[1]) : 4;
+	const uint32 consumers = argc_ > 2 ? atoi(argv_[2]) : 4;
+	const uint32 partNum = argc_ > 3 ? atoi(argv_[3]) : 250000;
+	const uint32 queueSize = argc_ > 4 ? atoi(argv_[4]) : 16;
+
+	if (producers == 0 || consumers == 0 || partNum == 0 || queueSize == 0)
+	{
+		std::cerr << "usage: QueueBench [producers] [consumers] [parts per producer] [queue size]" << std::endl;
+		return -1;
+	}
+
+	const uint64 total = (uint64)producers * partNum;
+	const uint64 expected = total * (total - 1) / 2;
+
+	std::cout << "producers: " << producers << ", consumers: " << consumers
+			  << ", parts: " << total << ", queue size: " << queueSize << std::endl;
+
+	uint64 checksum = 0;
+	double t = RunBenchmark<core::TMutexDataQueue<Part> >(producers, consumers, partNum, queueSize, checksum);
+	std::cout << "mutex queue:     " << std::setw(8) << std::fixed << std::setprecision(3) << t << " s, "
+			  << std::setw(12) << (uint64)(total / t) << " parts/s" << (checksum == expected ? "" : "  CHECKSUM MISMATCH") << std::endl;
+	if (checksum != expected)
+		return -1;
+
+	t = RunBenchmark<core::TDataQueue<Part> >(producers, consumers, partNum, queueSize, checksum);
+	std::cout << "lock-free queue: " << std::setw(8) << std::fixed << std::setprecision(3) << t << " s, "
+			  << std::setw(12) << (uint64)(total / t) << " parts/s" << (checksum == expected ? "" : "  CHECKSUM MISMATCH") << std::endl;
+
+	return checksum == expected ? 0 : -1;
+}
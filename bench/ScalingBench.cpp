@@ -0,0 +1,90 @@
+/*
+  This file is a part of DSRC software distributed under GNU GPL 2 licence.
+  The homepage of the DSRC project is http://sun.aei.polsl.pl/dsrc
+  
+  Authors: Lucas Roguski and Sebastian Deorowicz
+  
+  Version: 2.00
+*/
+
+// threads scaling benchmark: compresses and decompresses a FASTQ file with
+// the increasing number of processing threads, reporting the throughput
+//
+// usage: ScalingBench <FASTQ file> [max threads] [block size in MB]
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include <Dsrc.h>
+
+using namespace dsrc::lib;
+
+int main(int argc_, char* argv_[])
+{
+	if (argc_ < 2)
+	{
+		std::cerr << "usage: ScalingBench <FASTQ file> [max threads] [block size in MB]" << std::endl;
+		return -1;
+	}
+
+	const std::string fastqFile = argv_[1];
+	const std::string dsrcFile = fastqFile + ".bench.dsrc";
+	const std::string outFile = fastqFile + ".bench.fastq";
+	const unsigned maxThreads = argc_ > 2 ? atoi(argv_[2]) : 2 * DsrcModule::AvailableHardwareThreadsNum;
+
+	DsrcCompressionSettings settings;
+	if (argc_ > 3)
+		settings.fastqBufferSizeMb = atoi(argv_[3]);
+
+	std::ifstream in(fastqFile.c_str(), std::ios::binary | std::ios::ate);
+	const double fileSizeMb = (double)in.tellg() / (1 << 20);
+	if (!in || fileSizeMb <= 0.0 || maxThreads == 0)
+	{
+		std::cerr << "Error: cannot read the FASTQ file: " << fastqFile << std::endl;
+		return -1;
+	}
+
+	// powers of 2 and the maximum count
+	std::vector<unsigned> threads;
+	for (unsigned t = 1; t < maxThreads; t *= 2)
+		threads.push_back(t);
+	threads.push_back(maxThreads);
+
+	std::cout << "threads   compress [MB/s]   decompress [MB/s]" << std::endl;
+
+	for (unsigned i = 0; i < threads.size(); ++i)
+	{
+		DsrcModule module;
+
+		const auto t0 = std::chrono::high_resolution_clock::now();
+		if (!module.Compress(fastqFile, dsrcFile, settings, threads[i]))
+		{
+			std::cerr << module.GetError() << std::endl;
+			return -1;
+		}
+
+		const auto t1 = std::chrono::high_resolution_clock::now();
+		if (!module.Decompress(dsrcFile, outFile, threads[i]))
+		{
+			std::cerr << module.GetError() << std::endl;
+			return -1;
+		}
+		const auto t2 = std::chrono::high_resolution_clock::now();
+
+		const double compTime = std::chrono::duration<double>(t1 - t0).count();
+		const double decompTime = std::chrono::duration<double>(t2 - t1).count();
+
+		std::cout << std::setw(7) << threads[i]
+				  << std::setw(18) << std::fixed << std::setprecision(1) << fileSizeMb / compTime
+				  << std::setw(20) << fileSizeMb / decompTime << std::endl;
+	}
+
+	remove(dsrcFile.c_str());
+	remove(outFile.c_str());
+	return 0;
+}
@@ -0,0 +1,141 @@
+/*
+  This file is a part of DSRC software distributed under GNU GPL 2 licence.
+  The homepage of the DSRC project is http://sun.aei.polsl.pl/dsrc
+  
+  Authors: Lucas Roguski and Sebastian Deorowicz
+  
+  Version: 2.00
+*/
+
+// microbenchmark of the adaptive symbol coders: an order-1 model over
+// a quality-like stream is range coded and decoded with the linear scan
+// coder, the Fenwick tree coder and the one used by the models for the
+// alphabet size (SSE for 4 and 8 symbols), reporting the per-symbol cost
+//
+// usage: SymbolCoderBench [symbols count]
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+#include "../src/SymbolCoderRC.h"
+
+using namespace dsrc;
+using namespace dsrc::comp;
+
+// quality values drifting around the previous one, as in the real data
+template <uint32 _TSymbolCount>
+void GenerateSymbols(std::vector<uint32>& symbols_, uint32 count_)
+{
+	symbols_.resize(count_);
+	uint32 seed = 12345;
+	int32 prev = _TSymbolCount * 3 / 4;
+	for (uint32 i = 0; i < count_; ++i)
+	{
+		seed = seed * 1103515245 + 12345;
+		int32 r = (seed >> 16) & 0xFF;
+		int32 delta = (r < 160) ? 0 : (r < 224) ? (int32)(r & 3) - 2 : (int32)(r & 31) - 16;
+		int32 sym = prev + delta * (int32)(_TSymbolCount / 16 + 1);
+		sym = std::max<int32>(0, std::min<int32>(_TSymbolCount - 1, sym));
+		symbols_[i] = sym;
+		prev = sym;
+	}
+}
+
+template <class _TCoder>
+bool RunBenchmark(const std::vector<uint32>& symbols_, uint32 symbolCount_,
+				  double& encodeNs_, double& decodeNs_, std::vector<byte>& output_)
+{
+	std::vector<_TCoder> models(symbolCount_);
+
+	core::BitMemoryWriter writer;
+	RangeEncoder encoder(writer);
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	encoder.Start();
+	uint32 ctx = 0;
+	for (uint32 sym : symbols_)
+	{
+		models[ctx].EncodeSymbol(encoder, sym);
+		ctx = sym;
+	}
+	encoder.End();
+	writer.Flush();
+
+	auto stop = std::chrono::high_resolution_clock::now();
+	encodeNs_ = std::chrono::duration<double, std::nano>(stop - start).count() / symbols_.size();
+
+	output_.assign(writer.Pointer(), writer.Pointer() + writer.Position());
+
+	for (_TCoder& m : models)
+		m.Clear();
+
+	core::BitMemoryReader reader(output_.data(), output_.size());
+	RangeDecoder decoder(reader);
+
+	start = std::chrono::high_resolution_clock::now();
+
+	decoder.Start();
+	ctx = 0;
+	bool ok = true;
+	for (uint32 sym : symbols_)
+	{
+		uint32 s = models[ctx].DecodeSymbol(decoder);
+		ok &= (s == sym);
+		ctx = s;
+	}
+	decoder.End();
+
+	stop = std::chrono::high_resolution_clock::now();
+	decodeNs_ = std::chrono::duration<double, std::nano>(stop - start).count() / symbols_.size();
+
+	return ok;
+}
+
+template <uint32 _TSymbolCount>
+bool RunAlphabet(uint32 count_)
+{
+	std::vector<uint32> symbols;
+	GenerateSymbols<_TSymbolCount>(symbols, count_);
+
+	double linEnc, linDec, fenEnc, fenDec, selEnc, selDec;
+	std::vector<byte> linOut, fenOut, selOut;
+	bool ok = RunBenchmark<TSymbolCoderRC<_TSymbolCount> >(symbols, _TSymbolCount, linEnc, linDec, linOut);
+	ok &= RunBenchmark<TSymbolCoderFenwickRC<_TSymbolCount> >(symbols, _TSymbolCount, fenEnc, fenDec, fenOut);
+	ok &= RunBenchmark<typename TSymbolCoderSelector<_TSymbolCount>::Coder>(symbols, _TSymbolCount, selEnc, selDec, selOut);
+	ok &= (linOut == fenOut) && (linOut == selOut);
+
+	std::cout << std::setw(8) << _TSymbolCount << std::fixed << std::setprecision(1)
+			  << std::setw(12) << linEnc << std::setw(12) << linDec
+			  << std::setw(12) << fenEnc << std::setw(12) << fenDec
+			  << std::setw(12) << selEnc << std::setw(12) << selDec
+			  << (ok ? "" : "  MISMATCH") << std::endl;
+	return ok;
+}
+
+int main(int argc_, char* argv_[])
+{
+	const uint32 count = argc_ > 1 ? atoi(argv_[1]) : 10000000;
+
+	if (count == 0)
+	{
+		std::cerr << "usage: SymbolCoderBench [symbols count]" << std::endl;
+		return -1;
+	}
+
+	std::cout << "symbols: " << count << ", ns per symbol:" << std::endl;
+	std::cout << "alphabet  linear enc  linear dec fenwick enc fenwick dec    used enc    used dec" << std::endl;
+
+	bool ok = RunAlphabet<4>(count);
+	ok &= RunAlphabet<8>(count);
+	ok &= RunAlphabet<16>(count);
+	ok &= RunAlphabet<32>(count);
+	ok &= RunAlphabet<64>(count);
+	ok &= RunAlphabet<128>(count);
+	ok &= RunAlphabet<256>(count);
+
+	return ok ? 0 : -1;
+}
@@ -63,8 +63,9 @@ int CompressFile(const char* inFilename_, const char* outFilename_)
 	settings.fastqBufferSizeMb = 8;
 
 	// initialize compression routine with prepared settings
+	// and using 2 processing threads
 	DsrcArchiveRecordsWriter archive;
-	if (!archive.StartCompress(outFilename_, settings))
+	if (!archive.StartCompress(outFilename_, settings, 2))
 	{
 		fastqFile.Close();
 
@@ -158,7 +159,7 @@ int DecompressFile(const char* inFilename_, const char* outFilename_)
 	// 1. Open DSRC archive
 	//
 	DsrcArchiveRecordsReader archive;
-	if (!archive.StartDecompress(inFilename_))
+	if (!archive.StartDecompress(inFilename_, 2))		// decompress using 2 processing threads
 	{
 		std::cerr << "Error!" << std::endl;
 		std::cerr << archive.GetError() << std::endl;
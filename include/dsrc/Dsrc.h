@@ -29,6 +29,7 @@ typedef ext::FastqFileBlocksReader FastqFileBlocksReader;
 typedef ext::FastqFileBlocksWriter FastqFileBlocksWriter;
 
 typedef FieldMask FieldMask;
+typedef FastqFields FastqFields;
 typedef DsrcCompressionSettings DsrcCompressionSettings;
 typedef FastqDatasetType FastqDatasetType;
 
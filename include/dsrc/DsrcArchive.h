@@ -13,6 +13,8 @@
 #include "Globals.h"
 #include "FastqRecord.h"
 
+#include <vector>
+
 namespace dsrc
 {
 
@@ -60,6 +62,9 @@ public:
 
 	bool GetCompressionSettings(DsrcCompressionSettings& settings_) const;
 
+	// returns false if the archive does not store the records count (prior v3.0)
+	bool GetRecordsCount(uint64& count_) const;
+
 	bool IsError() const;
 	const std::string& GetError() const;
 	void ClearError();
@@ -84,9 +89,11 @@ public:
 	DsrcArchiveRecordsWriter();
 	~DsrcArchiveRecordsWriter();
 
+	// with more than 1 thread the records are compressed in the background
+	// by a pool of worker threads, while WriteNextRecord() only buffers them
 	bool StartCompress(const std::string& dsrcFilename_,
 					   const DsrcCompressionSettings& compressionSettings_,
-					   uint32 threadsNum_ = 1,				// for future use, currently only 1
+					   uint32 threadsNum_ = 1,
 					   uint32 qualityOffset_ = 0);			// auto selection of quality offset: 0
 	void FinishCompress();
 
@@ -104,12 +111,26 @@ public:
 	DsrcArchiveRecordsReader();
 	~DsrcArchiveRecordsReader();
 
+	// with more than 1 thread the following blocks are decompressed ahead
+	// by a pool of worker threads, the records are returned in archive order
 	bool StartDecompress(const std::string &dsrcFilename_,
 						 uint32 threadsNum_ = 1);
 	void FinishDecompress();
 
 	bool ReadNextRecord(FastqRecord& rec_);
 
+	// selects the record fields to decompress (see FastqFields), the others
+	// are returned empty -- applies to the blocks decompressed afterwards,
+	// so it should be set before reading the records (when decompressing
+	// with more than 1 thread, it applies from the next StartDecompress())
+	bool SetFieldsMask(uint32 fieldsMask_);
+
+	// random access to records by their ordinal number (counted from 0),
+	// only the blocks containing the requested records are decompressed
+	// (requires archives created with DSRC v3.0 or later)
+	bool SeekToRecord(uint64 recordId_);
+	bool ReadRange(uint64 firstRecord_, uint64 recordsCount_, std::vector<FastqRecord>& records_);
+
 protected:
 	struct RecordsReaderImpl;
 	RecordsReaderImpl* readerImpl;
@@ -6,6 +6,10 @@
 #include "../../src/Fastq.h"
 
 namespace dsrc{
+  namespace comp {
+    class BlockCompressorChains;
+  }
+
   namespace ext {
 
     /**
@@ -33,6 +37,8 @@ namespace dsrc{
         comp::DsrcFileReader* reader = NULL;
         comp::DsrcDataChunk* dsrcChunk = NULL;
         fq::FastqDataChunk* fastqChunk = NULL;
+        comp::BlockCompressorChains* chains = NULL;
+        uint64 blockId = 0;
         std::string errorMsg;
     };
   }
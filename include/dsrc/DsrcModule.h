@@ -15,6 +15,11 @@
 namespace dsrc
 {
 
+namespace comp
+{
+class ModelDictionary;
+}
+
 namespace ext
 {
 
@@ -43,10 +48,40 @@ public:
 				  bool useFastqStdIo_ = false,
 				  uint32 qualityOffset_ = 0);
 
+	// when not all the record fields are selected (see FastqFields), only
+	// the selected ones are written, one per line
 	bool Decompress(const std::string& inDsrcFilename_,
 					const std::string& outFastqFilename_,
 					uint32 threadsNum_,
-					bool useFastqStdIo_ = false);
+					bool useFastqStdIo_ = false,
+					uint32 fieldsMask_ = FastqFields::All);
+
+	// extracts the records [firstRecord_, firstRecord_ + recordsCount_)
+	// decompressing only the blocks containing them
+	bool Extract(const std::string& inDsrcFilename_,
+				 const std::string& outFastqFilename_,
+				 uint64 firstRecord_,
+				 uint64 recordsCount_,
+				 bool useFastqStdIo_ = false);
+
+	// decodes the archive checking the CRC32 checksums of all the blocks,
+	// stored when compressing with calculateCrc32 set -- the corrupt blocks
+	// are listed in the error message
+	bool Verify(const std::string& inDsrcFilename_,
+				uint32 threadsNum_);
+
+	// trains the DNA and quality models of the compression settings on the
+	// records and stores them as the dictionary, to compress with by setting
+	// DsrcCompressionSettings::modelDictionary -- the blocks start from the
+	// trained models instead of the cleared ones, helping the small archives
+	bool TrainDictionary(const std::string& inFastqFilename_,
+						 const std::string& outDictionaryFilename_,
+						 const DsrcCompressionSettings& compSettings_,
+						 uint32 qualityOffset_ = 0);
+
+	// the dictionary needed to decompress, extract or verify the archives
+	// compressed with one, empty -- none
+	void SetModelDictionary(const std::string& dictionaryFilename_);
 
 	bool IsError() const;
 	const std::string& GetError() const;
@@ -58,6 +93,9 @@ public:
 private:
 	std::string errorMsg;
 	std::string logMsg;
+	std::string modelDictionaryFilename;
+
+	bool LoadModelDictionary(const std::string& filename_, comp::ModelDictionary& dictionary_);
 
 	void AddError(const std::string& err_);
 	void SetError(const std::string& err_);
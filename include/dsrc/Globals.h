@@ -26,6 +26,14 @@
 #endif
 
 
+// SIMD code paths, selected at compile time -- define DSRC_NO_SIMD
+// to build the portable scalar versions only
+//
+#if !defined(DSRC_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#	define DSRC_USE_SSE2 1
+#endif
+
+
 // assertions
 //
 #if defined(DEBUG) || defined(_DEBUG)
@@ -110,7 +118,7 @@ private:
 struct DsrcCompressionSettings
 {
 	static const uint32 MinDnaCompressionLevel = 0;
-	static const uint32 MaxDnaCompressionLevel = 3;
+	static const uint32 MaxDnaCompressionLevel = 5;
 	static const uint32 MinQualityCompressionLevel = 0;
 	static const uint32 MaxQualityCompressionLevel = 3;
 	static const uint32 MinFastqBufferSizeMB = 1;
@@ -123,13 +131,31 @@ struct DsrcCompressionSettings
 
 	static const bool DefaultLossyQualityCompressionMode = false;
 	static const bool DefaultCrc32Calculation = false;
+	static const bool DefaultCrc32Verification = true;
+	static const bool DefaultParallelStreams = false;
+
+	static const uint32 DefaultModelChainLength = 0;
+	static const uint32 MaxModelChainLength = 65535;
+	static const uint32 MinModelChainCount = 1;
+	static const uint32 MaxModelChainCount = 256;
+	static const uint32 DefaultModelChainCount = 4;
+
+	static const uint32 MinDnaMixingLevel = 1;
+	static const uint32 MaxDnaMixingLevel = 3;
+	static const uint32 DefaultDnaMixingLevel = 2;
 
 	uint32 dnaCompressionLevel;
 	uint32 qualityCompressionLevel;
 	uint64 tagPreserveMask;
 	bool lossyQualityCompression;
 	bool calculateCrc32;
+	bool verifyCrc32;		// decode the blocks again to check the checksums, otherwise only stored
 	uint64 fastqBufferSizeMb;
+	bool parallelStreams;		// encode the quality and DNA streams of each block concurrently, the output is unchanged
+	uint32 modelChainLength;		// blocks continuing the DNA and quality models of the previous ones, 0/1 -- none
+	uint32 modelChainCount;		// interleaved chains, compressed in parallel by up to as many threads
+	std::string modelDictionary;	// file of the trained initial DNA and quality models, empty -- none
+	uint32 dnaMixingLevel;		// models mixed by the DNA mode 5, from the fastest to the best ratio
 
 	DsrcCompressionSettings()
 		:	dnaCompressionLevel(DefaultDnaCompressionLevel)
@@ -137,7 +163,12 @@ struct DsrcCompressionSettings
 		,	tagPreserveMask(TagPreserveAllMask)
 		,	lossyQualityCompression(DefaultLossyQualityCompressionMode)
 		,	calculateCrc32(DefaultCrc32Calculation)
+		,	verifyCrc32(DefaultCrc32Verification)
 		,	fastqBufferSizeMb(DefaultFastqBufferSizeMB)
+		,	parallelStreams(DefaultParallelStreams)
+		,	modelChainLength(DefaultModelChainLength)
+		,	modelChainCount(DefaultModelChainCount)
+		,	dnaMixingLevel(DefaultDnaMixingLevel)
 	{}
 
 	static DsrcCompressionSettings Default()
@@ -172,6 +203,17 @@ struct FastqDatasetType
 	}
 };
 
+// FASTQ record fields selectable at decompression
+//
+struct FastqFields
+{
+	static const uint32 Tag = 1 << 0;
+	static const uint32 Sequence = 1 << 1;
+	static const uint32 Quality = 1 << 2;
+
+	static const uint32 All = Tag | Sequence | Quality;
+};
+
 } // namespace dsrc
 
 
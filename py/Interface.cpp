@@ -151,6 +151,58 @@ struct PyDsrcCompressionSettings : public DsrcCompressionSettings
 	{
 		calculateCrc32 = v_;
 	}
+
+	bool IsCrc32Verification() const
+	{
+		return verifyCrc32;
+	}
+
+	void SetCrc32Verification(bool v_)
+	{
+		verifyCrc32 = v_;
+	}
+
+	bool IsParallelStreams() const
+	{
+		return parallelStreams;
+	}
+
+	void SetParallelStreams(bool v_)
+	{
+		parallelStreams = v_;
+	}
+
+	uint32 GetModelChainLength() const
+	{
+		return modelChainLength;
+	}
+
+	void SetModelChainLength(uint32 v_)
+	{
+		modelChainLength = v_;
+	}
+
+	uint32 GetDnaMixingLevel() const
+	{
+		return dnaMixingLevel;
+	}
+
+	void SetDnaMixingLevel(uint32 v_)
+	{
+		if (v_ < DsrcCompressionSettings::MinDnaMixingLevel || v_ > DsrcCompressionSettings::MaxDnaMixingLevel)
+			throw PyException("Invalid DNA mixing level specified");
+		dnaMixingLevel = v_;
+	}
+
+	std::string GetModelDictionary() const
+	{
+		return modelDictionary;
+	}
+
+	void SetModelDictionary(const std::string& v_)
+	{
+		modelDictionary = v_;
+	}
 };
 
 
@@ -237,9 +289,27 @@ public:
 		TCheckError(dsrc);
 	}
 
+	void TrainDictionary(const std::string& inFastqFilename_,
+						 const std::string& outDictionaryFilename_,
+						 const PyDsrcCompressionSettings& compSettings_,
+						 uint32 qualityOffset_ = 0)
+	{
+		dsrc.TrainDictionary(inFastqFilename_,
+							 outDictionaryFilename_,
+							 compSettings_,
+							 qualityOffset_);
+		TCheckError(dsrc);
+	}
+
+	void SetModelDictionary(const std::string& dictionaryFilename_)
+	{
+		dsrc.SetModelDictionary(dictionaryFilename_);
+	}
+
 	// we need to overload member functions with default arguments for Python <-> C++ API compatibility
 	BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(Compress_overload, Compress, 4, 6)
 	BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(Decompress_overload, Decompress, 3, 4)
+	BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(TrainDictionary_overload, TrainDictionary, 3, 4)
 
 private:
 	DsrcModule dsrc;
@@ -459,6 +529,11 @@ BOOST_PYTHON_MODULE(pydsrc)
 		.add_property("TagFieldFilterMask", &PyDsrcCompressionSettings::GetTagFieldPreserveMask, &PyDsrcCompressionSettings::SetTagFieldPreserveMask)
 		.add_property("FastqBufferSizeMB", &PyDsrcCompressionSettings::GetFastqBufferSizeMb, &PyDsrcCompressionSettings::SetFastqBufferSizeMb)
 		.add_property("Crc32Checking", &PyDsrcCompressionSettings::IsCrc32Checking, &PyDsrcCompressionSettings::SetCrc32Checking)
+		.add_property("Crc32Verification", &PyDsrcCompressionSettings::IsCrc32Verification, &PyDsrcCompressionSettings::SetCrc32Verification)
+		.add_property("ParallelStreams", &PyDsrcCompressionSettings::IsParallelStreams, &PyDsrcCompressionSettings::SetParallelStreams)
+		.add_property("ModelChainLength", &PyDsrcCompressionSettings::GetModelChainLength, &PyDsrcCompressionSettings::SetModelChainLength)
+		.add_property("DNAMixingLevel", &PyDsrcCompressionSettings::GetDnaMixingLevel, &PyDsrcCompressionSettings::SetDnaMixingLevel)
+		.add_property("ModelDictionary", &PyDsrcCompressionSettings::GetModelDictionary, &PyDsrcCompressionSettings::SetModelDictionary)
 	;
 
 	boo::class_<FieldMask>("FieldMask")
@@ -469,6 +544,8 @@ BOOST_PYTHON_MODULE(pydsrc)
 	boo::class_<PyDsrcModule, boost::noncopyable>("DsrcModule")
 		.def("Compress", &PyDsrcModule::Compress, PyDsrcModule::Compress_overload())
 		.def("Decompress", &PyDsrcModule::Decompress, PyDsrcModule::Decompress_overload())
+		.def("TrainDictionary", &PyDsrcModule::TrainDictionary, PyDsrcModule::TrainDictionary_overload())
+		.def("SetModelDictionary", &PyDsrcModule::SetModelDictionary)
 	;
 
 	boo::class_<PyDsrcArchiveRecordsWriter, boost::noncopyable>("DsrcArchiveRecordsWriter")
@@ -25,6 +25,10 @@ namespace dsrc
 namespace core
 {
 
+// the bits are read through a 64-bit buffer, refilled with a single 8-byte load
+// away from the end of the memory -- the whole bytes held in the buffer are
+// returned to the byte stream before any byte-level access
+//
 class BitMemoryReader
 {
 public:
@@ -32,8 +36,8 @@ public:
 		:	memory(mem_)
 		,	size(size_)
 		,	position(0)
-		,	wordBuffer(0)
-		,	wordBufferPos(0)
+		,	bitBuffer(0)
+		,	bitCount(0)
 	{
 		ASSERT(mem_ != NULL);
 		ASSERT(size_ != 0);
@@ -46,12 +50,17 @@ public:
 
 	uint64 Position() const
 	{
-		return position;
+		return position - (bitCount >> 3);
 	}
 
 	void SetPosition(uint64 pos_)
 	{
-		ASSERT(pos_ <= size);
+		// the positions and sizes come from the stream, check them as
+		// they would point anywhere in a corrupted block
+		if (pos_ > size)
+			throw DsrcException("corrupted block data");
+
+		ReleaseBitBuffer();
 		position = pos_;
 	}
 
@@ -60,82 +69,71 @@ public:
 		return memory;
 	}
 
-	// refactor
-	//
 	uint32 GetBit()
 	{
-		if (wordBufferPos == 0)
-		{
-			wordBuffer = GetByte();
-			wordBufferPos = 7;
-			return (wordBuffer >> 7) & 1;
-		}
-
-		return (wordBuffer >> (--wordBufferPos)) & 1;
+		return GetBits(1);
 	}
 
 	uint32 Get2Bits()
 	{
-		if (wordBufferPos >= 2)
-		{
-			wordBufferPos -= 2;
-			return (wordBuffer >> wordBufferPos) & 3;
-		}
-
-		if (wordBufferPos == 0)
-		{
-			wordBuffer = GetByte();
-			wordBufferPos = 6;
-			return (wordBuffer >> wordBufferPos) & 3;
-		}
-
-		uint32 word = (wordBuffer & 1) << 1;
-		wordBuffer = GetByte();
-		wordBufferPos = 7;
-		word += wordBuffer >> wordBufferPos;
-		return word & 3;
+		return GetBits(2);
 	}
 
 	uint32 GetBits(uint32 n_)
 	{
 		ASSERT(n_ > 0 && n_ < 32);
 
-		uint32 word = 0;
-		while (n_)
-		{
-			if (wordBufferPos == 0)
-			{
-				wordBuffer = GetByte();
-				wordBufferPos = 8;
-			}
+		if (bitCount < n_)
+			Refill();
+		ASSERT(bitCount >= n_);
 
-			if (n_ > wordBufferPos)
-			{
-				word <<= wordBufferPos;
-				word += wordBuffer & BitMask(wordBufferPos);
-				n_ -= wordBufferPos;
-				wordBufferPos = 0;
-			}
-			else
-			{
-				word <<= n_;
-				wordBufferPos -= n_;
-				word += (wordBuffer >> wordBufferPos) & BitMask(n_);
-				break;
-			}
-		}
+		uint32 word = (uint32)(bitBuffer >> (64 - n_));
+		bitBuffer <<= n_;
+		bitCount -= n_;
 		return word;
 	}
 
+	// the next n_ bits without consuming them, past the end of the memory
+	// the stream is padded with zeros
+	//
+	uint32 PeekBits(uint32 n_)
+	{
+		ASSERT(n_ > 0 && n_ <= 32);
+
+		if (bitCount < n_)
+			Refill();
+
+		return (uint32)(bitBuffer >> (64 - n_));
+	}
+
+	void SkipBits(uint32 n_)
+	{
+		ASSERT(n_ > 0 && n_ <= 32);
+
+		if (bitCount < n_)
+			Refill();
+		ASSERT(bitCount >= n_);
+
+		bitBuffer <<= n_;
+		bitCount -= n_;
+	}
+
 	byte GetByte()
 	{
+		if (bitCount >= 8)
+			ReleaseBitBuffer();
+
 		ASSERT (position < size);
 		return memory[position++];
 	}
 
 	void GetBytes(uchar *data, uint32 n_bytes)
 	{
-		ASSERT(position + n_bytes <= size);
+		if (bitCount >= 8)
+			ReleaseBitBuffer();
+
+		if (position + n_bytes > size)
+			throw DsrcException("corrupted block data");
 
 		std::copy(memory + position, memory + position + n_bytes, data);
 		position += n_bytes;
@@ -164,37 +162,42 @@ public:
 
 	uint32 Get2Bytes()
 	{
-		return GetByte() << 8 | GetByte();
+		uint32 c = GetByte();
+		return (c << 8) | GetByte();
 	}
 
 	void SkipBytes(uint32 n_)
 	{
+		if (bitCount >= 8)
+			ReleaseBitBuffer();
+
 		ASSERT(position + n_ < size);
 
 		position += n_;
 	}
 
+	// drops the bits left of the current byte
 	void FlushInputWordBuffer()
 	{
-		wordBufferPos = 0;
+		position -= bitCount >> 3;
+		bitCount = 0;
+		bitBuffer = 0;
 	}
 
 	void Reset()
 	{
 		position = 0;
-		wordBufferPos = 0;
-		wordBuffer = 0;
+		bitCount = 0;
+		bitBuffer = 0;
 	}
 
 private:
-	static const uint32 WordBufferSize = 8;
-
 	byte* memory;
 	uint64 size;
-	uint64 position;
+	uint64 position;				// next byte to be loaded into the bit buffer
 
-	uint32 wordBuffer;
-	uint32 wordBufferPos;
+	uint64 bitBuffer;				// MSB first, the bits past bitCount are zeros or the next stream bits
+	uint32 bitCount;
 
 	BitMemoryReader(const BitMemoryReader& )
 	{}
@@ -202,12 +205,35 @@ private:
 	BitMemoryReader& operator= (const BitMemoryReader& )
 	{ return *this; }
 
+	// tops up the buffer to at least 56 bits
+	void Refill()
+	{
+		if (position + 8 <= size)
+		{
+			const byte* p = memory + position;
+			uint64 word = ((uint64)p[0] << 56) | ((uint64)p[1] << 48) | ((uint64)p[2] << 40) | ((uint64)p[3] << 32)
+						| ((uint64)p[4] << 24) | ((uint64)p[5] << 16) | ((uint64)p[6] << 8) | (uint64)p[7];
 
-	uint32 BitMask(uint32 n_)
+			bitBuffer |= word >> bitCount;
+			position += (63 - bitCount) >> 3;
+			bitCount |= 56;
+		}
+		else
+		{
+			while (bitCount <= 56 && position < size)
+			{
+				bitBuffer |= (uint64)memory[position++] << (56 - bitCount);
+				bitCount += 8;
+			}
+		}
+	}
+
+	// keeps only the bits of the partially read byte
+	void ReleaseBitBuffer()
 	{
-		ASSERT(n_ < 32);
-		//return ((uint32)0xFFFFFFFF >> (32 - n_));
-		return ((uint32)1 << n_) - 1;
+		position -= bitCount >> 3;
+		bitCount &= 7;
+		bitBuffer = (bitCount > 0) ? bitBuffer & ~(~0ULL >> bitCount) : 0;
 	}
 };
 
@@ -220,8 +246,8 @@ public:
 	BitMemoryWriter(uint32 bufferSize_ = DefaultBufferSize)
 		:	buffer(NULL)
 		,	position(0)
-		,	wordBuffer(0)
-		,	wordBufferPos(0)
+		,	bitBuffer(0)
+		,	bitCount(0)
 		,	hasOwnership(true)
 	{
 		buffer = new Buffer(bufferSize_);
@@ -232,8 +258,8 @@ public:
 	BitMemoryWriter(Buffer& buffer_)
 		:	buffer(NULL)
 		,	position(0)
-		,	wordBuffer(0)
-		,	wordBufferPos(0)
+		,	bitBuffer(0)
+		,	bitCount(0)
 		,	hasOwnership(false)
 	{
 		buffer = &buffer_;
@@ -271,77 +297,45 @@ public:
 		return memory;
 	}
 
+	// the full 32-bit words are emitted as in the byte-wise implementation:
+	// PutBits() as soon as the word is complete, PutBit() and Put2Bits() with
+	// the next bits -- FlushFullWordBuffer() relies on it
+	//
 	template <typename _T>
 	void PutBit(_T b_)
 	{
-		if (wordBufferPos < WordBufferSize)
-		{
-			wordBuffer <<= 1;
-			wordBuffer += ((uint32)b_) & 1;
-			++wordBufferPos;
-		}
-		else
-		{
-			PutWord(wordBuffer);
-			wordBufferPos = 1;
-			wordBuffer = ((uint32)b_) & 1;
-		}
+		bitBuffer = (bitBuffer << 1) | (((uint32)b_) & 1);
+		if (++bitCount > WordBufferSize)
+			PutBufferWord();
 	}
 
 	void Put2Bits(uint32 word_)
 	{
 		ASSERT(word_ <= 3);
-		word_ &= 3;
 
-		if (wordBufferPos + 2 <= WordBufferSize)
-		{
-			wordBuffer <<= 2;
-			wordBuffer += word_;
-			wordBufferPos += 2;
-		}
-		else if (wordBufferPos == WordBufferSize)
-		{
-			PutWord(wordBuffer);
-			wordBufferPos = 2;
-			wordBuffer = word_;
-		}
-		else
-		{
-			wordBuffer <<= 1;
-			wordBuffer += word_ >> 1;
-			PutWord(wordBuffer);
-			wordBuffer = word_ & 1;
-			wordBufferPos = 1;
-		}
+		bitBuffer = (bitBuffer << 2) | (word_ & 3);
+		bitCount += 2;
+		if (bitCount > WordBufferSize)
+			PutBufferWord();
 	}
 
 	void PutBits(uint32 word_, uint32 n_)
 	{
-		//ASSERT(word <= n_bit_mask[n_bits]);
-		ASSERT(n_ > 0);
-		word_ &= BitMask(n_);
-
-		uint32 rest = WordBufferSize - wordBufferPos;
-		if (n_ >= rest)
-		{
-			n_ -= rest;
-			wordBuffer <<= rest;
-			wordBuffer += word_ >> n_;
-			wordBufferPos = 0;
-			PutWord(wordBuffer);
-			wordBuffer = 0;
-		}
+		ASSERT(n_ > 0 && n_ < 32);
 
-		wordBuffer <<= n_;
-		wordBuffer += word_ & BitMask(n_);
-		wordBufferPos += n_;
+		bitBuffer = (bitBuffer << n_) | (word_ & BitMask(n_));
+		bitCount += n_;
+		if (bitCount >= WordBufferSize)
+			PutBufferWord();
 	}
 
 	void PutByte(byte b_)
 	{
+		ASSERT(bitCount == 0);
+
 		if (position >= size)
 		{
-			ExtendBuffer(size + (size >> 2));
+			ExtendBuffer(size + (size >> 2) + 1);
 		}
 
 		memory[position++] = b_;
@@ -355,6 +349,8 @@ public:
 
 	void PutBytes(const byte *data_, uint32 n_)
 	{
+		ASSERT(bitCount == 0);
+
 		if (position + n_ > size)
 		{
 			ExtendBuffer((uint32)((position + n_) * 1.5f));
@@ -385,27 +381,25 @@ public:
 
 	void FlushFullWordBuffer()
 	{
-		PutWord(wordBuffer);
+		ASSERT(bitCount <= WordBufferSize);
 
-		wordBuffer    = 0;
-		wordBufferPos = 0;
+		uint32 word = (uint32)(bitBuffer & ((1ULL << bitCount) - 1));
+		bitBuffer = 0;
+		bitCount = 0;
+		PutWord(word);
 	}
 
 	void FlushPartialWordBuffer()
 	{
-		wordBuffer <<= (32 - wordBufferPos) & 7;
+		ASSERT(bitCount <= WordBufferSize);
 
-		if (wordBufferPos > 24)
-			PutByte(wordBuffer >> 24);
-		if (wordBufferPos > 16)
-			PutByte((wordBuffer >> 16) & 0xFF);
-		if (wordBufferPos > 8)
-			PutByte((wordBuffer >> 8) & 0xFF);
-		if (wordBufferPos > 0)
-			PutByte(wordBuffer & 0xFF);
+		uint32 n = (bitCount + 7) >> 3;
+		uint64 word = bitBuffer << ((n * 8 - bitCount) & 7);
+		bitBuffer = 0;
+		bitCount = 0;
 
-		wordBuffer = 0;
-		wordBufferPos = 0;
+		for (uint32 i = n; i > 0; --i)
+			PutByte((word >> ((i - 1) * 8)) & 0xFF);
 	}
 
 	void Flush()
@@ -430,8 +424,8 @@ public:
 	void Reset()
 	{
 		position = 0;
-		wordBufferPos = 0;
-		wordBuffer = 0;
+		bitCount = 0;
+		bitBuffer = 0;
 	}
 
 
@@ -443,8 +437,8 @@ private:
 	uint64	size;
 	uint64	position;
 
-	uint32 wordBuffer;
-	uint32 wordBufferPos;
+	uint64 bitBuffer;				// pending bits, LSB aligned
+	uint32 bitCount;
 
 	bool	hasOwnership;
 
@@ -463,6 +457,23 @@ private:
 		return ((uint32)1 << n_) - 1;
 	}
 
+	// emits the oldest 32 pending bits with a single 4-byte store
+	void PutBufferWord()
+	{
+		if (position + 4 > size)
+			ExtendBuffer(size + (size >> 2) + 4);
+
+		bitCount -= WordBufferSize;
+		uint32 word = (uint32)(bitBuffer >> bitCount);
+
+		byte* p = memory + position;
+		p[0] = word >> 24;
+		p[1] = (word >> 16) & 0xFF;
+		p[2] = (word >> 8) & 0xFF;
+		p[3] = word & 0xFF;
+		position += 4;
+	}
+
 	void ExtendBuffer(uint32 newSize_)
 	{
 		ASSERT(newSize_ > 0);
@@ -10,12 +10,15 @@
 #include "BlockCompressor.h"
 
 #include <algorithm>
+#include <numeric>
 #include <cstring>
 #include <ctime>
 
 #include "BlockCompressor.h"
 #include "BitMemory.h"
 #include "FastqParser.h"
+#include "DsrcIo.h"
+#include "ModelDictionary.h"
 
 #include "utils.h"
 
@@ -53,9 +56,15 @@ inline void CONTROL_CHECK_R(BitMemoryReader& r_)
 BlockCompressor::BlockCompressor(const FastqDatasetType& type_, const CompressionSettings& settings_)
 	:	datasetType(type_)
 	,	compSettings(settings_)
+	,	fieldsMask(FastqFields::All)
+	,	modelsChained(false)
 	,	recordsProcessor(NULL)
 	,	dnaModeler(NULL)
 	,	qualityModeler(NULL)
+	,	qualityBuffer(NULL)
+	,	dnaBuffer(NULL)
+	,	qualityThread(NULL)
+	,	dnaThread(NULL)
 {
 	records.resize(8 * 1024);
 
@@ -76,13 +85,15 @@ void BlockCompressor::Configure(const FastqDatasetType& type_, const Compression
 			recordsProcessor = new LosslessRecordsProcessor(type_.qualityOffset, type_.colorSpace);
 	}
 
-	if (settings_.dnaOrder != compSettings.dnaOrder || force_)
+	if (settings_.dnaOrder != compSettings.dnaOrder
+			|| settings_.dnaMixingLevel != compSettings.dnaMixingLevel
+			|| force_)
 	{
 		TFree(dnaModeler);
 		if (settings_.dnaOrder == 0)
 			dnaModeler = new DnaNormalModelerProxy();
 		else
-			dnaModeler = new DnaOrderModelerProxy(settings_.dnaOrder);
+			dnaModeler = new DnaOrderModelerProxy(settings_.dnaOrder, settings_.dnaMixingLevel);
 	}
 
 	if (settings_.qualityOrder != compSettings.qualityOrder
@@ -127,6 +138,10 @@ void BlockCompressor::Reconfigure(const FastqDatasetType& type_, const Compressi
 
 BlockCompressor::~BlockCompressor()
 {
+	delete dnaThread;
+	delete qualityThread;
+	delete dnaBuffer;
+	delete qualityBuffer;
 	delete qualityModeler;
 	delete dnaModeler;
 	delete recordsProcessor;
@@ -137,25 +152,48 @@ void BlockCompressor::Reset()
 {
 	chunkHeader.flags = 0;
 	chunkHeader.recordsCount = 0;
+	modelsChained = false;
 }
 
 
 void BlockCompressor::ParseRecords(const FastqDataChunk& chunk_, StreamsInfo& streamInfo_)
 {
+	// each batch of records is preprocessed while still in cache, instead
+	// of streaming the whole block again in the following passes
+	streamInfo_.Clear();
+	chunkHeader.recordsCount = 0;
+
+	uint64 count = 0;
 	if (compSettings.tagPreserveFlags != 0)
 	{
 		FastqParserExt parser;
-		uint64 size = parser.ParseFrom(chunk_, records, chunkHeader.recordsCount,
-									   streamInfo_, compSettings.tagPreserveFlags);
-		ASSERT(size <= chunk_.size);
-		chunkHeader.rawChunkSize = size;
+		parser.StartParsing(chunk_);
+		do
+		{
+			const uint64 first = chunkHeader.recordsCount;
+			count = parser.ParseNext(records, chunkHeader.recordsCount, RecordsBatchSize,
+									 streamInfo_, compSettings.tagPreserveFlags);
+			PreprocessRecords(first, count);
+		}
+		while (count == RecordsBatchSize);
+
+		ASSERT(parser.ParsedSize() <= chunk_.size);
+		chunkHeader.rawChunkSize = parser.ParsedSize();
 	}
 	else
 	{
 		FastqParser parser;
-		uint64 size = parser.ParseFrom(chunk_, records, chunkHeader.recordsCount, streamInfo_);
-		ASSERT(size <= chunk_.size);
-		chunkHeader.rawChunkSize = size;
+		parser.StartParsing(chunk_);
+		do
+		{
+			const uint64 first = chunkHeader.recordsCount;
+			count = parser.ParseNext(records, chunkHeader.recordsCount, RecordsBatchSize, streamInfo_);
+			PreprocessRecords(first, count);
+		}
+		while (count == RecordsBatchSize);
+
+		ASSERT(parser.ParsedSize() <= chunk_.size);
+		chunkHeader.rawChunkSize = parser.ParsedSize();
 	}
 
 	ASSERT(chunkHeader.recordsCount > 0);
@@ -168,16 +206,51 @@ void BlockCompressor::ParseRecords(const FastqDataChunk& chunk_, StreamsInfo& st
 }
 
 
-void BlockCompressor::PreprocessRecords(uint32 checksumFlags_)
+void BlockCompressor::StartPreprocessing(uint32 checksumFlags_)
+{
+	recordsProcessor->StartForward(checksumFlags_);
+}
+
+
+void BlockCompressor::PreprocessRecords(uint64 first_, uint64 count_)
+{
+	if (count_ == 0)
+		return;
+
+	recordsProcessor->ProcessForward(records.data() + first_, count_);
+
+	TagAnalyzer* analyzer = tagModeler.GetAnalyzer();
+
+	if (first_ == 0)
+		analyzer->InitializeFieldsStats(records[0]);
+
+	for (uint64 i = first_; i < first_ + count_; ++i)
+		analyzer->UpdateFieldsStats(records[i]);
+}
+
+
+void BlockCompressor::FinishPreprocessing(uint32 checksumFlags_)
 {
-	recordsProcessor->InitializeStats();
-	fq::FastqChecksum checksum = recordsProcessor->ProcessForward(records.data(), chunkHeader.recordsCount, checksumFlags_);
-	recordsProcessor->FinalizeStats();
+	fq::FastqChecksum checksum = recordsProcessor->FinishForward();
 
 	if (checksumFlags_ != fq::FastqChecksum::CALC_NONE)
 	{
 		chunkHeader.checksum = checksum;
 	}
+
+	TagAnalyzer* analyzer = tagModeler.GetAnalyzer();
+	analyzer->FinalizeFieldsStats();
+
+	if (analyzer->GetStats().mixedFormatting)
+		chunkHeader.flags |= FLAG_MIXED_FIELD_FORMATTING;
+}
+
+
+void BlockCompressor::PreprocessRecords(uint32 checksumFlags_)
+{
+	StartPreprocessing(checksumFlags_);
+	PreprocessRecords(0, chunkHeader.recordsCount);
+	FinishPreprocessing(checksumFlags_);
 }
 
 
@@ -204,7 +277,8 @@ void BlockCompressor::AnalyzeRecords()
 {	
 	AnalyzeMetaData(recordsProcessor->GetDnaStats(), recordsProcessor->GetQualityStats(), recordsProcessor->GetColorSpaceStats());
 
-	AnalyzeTags();
+	if (datasetType.colorSpace && chunkHeader.csConstBeginSym)
+		ReduceColorSpaceRecords();
 
 	dnaModeler->ProcessStats(recordsProcessor->GetDnaStats());
 
@@ -214,6 +288,22 @@ void BlockCompressor::AnalyzeRecords()
 
 void BlockCompressor::AnalyzeMetaData(const DnaStats& , const QualityStats& qStats_, const ColorSpaceStats& csStats_)
 {
+	chunkHeader.flags |= FLAG_STREAMS_INDEX;
+
+	// when no quality symbol carries a DNA symbol, the sequences can be
+	// decoded without the quality stream
+	uint64 specialCount = 0;
+	if (compSettings.lossyQuality)
+		specialCount = qStats_.symbolFreqs[0];
+	else
+		specialCount = std::accumulate(qStats_.symbolFreqs + 128, qStats_.symbolFreqs + QualityStats::MaxSymbolCount, (uint64)0);
+
+	if (specialCount == 0)
+		chunkHeader.flags |= FLAG_PLAIN_SEQUENCE;
+
+	if (modelsChained)
+		chunkHeader.flags |= FLAG_CHAINED_MODELS;
+
 	chunkHeader.maxQuaLength = qStats_.maxLength;
 	chunkHeader.minQuaLength = qStats_.minLength;
 	chunkHeader.csConstBeginSym = csStats_.constBeginSym;
@@ -236,16 +326,20 @@ void BlockCompressor::AnalyzeMetaData(const DnaStats& , const QualityStats& qSta
 }
 
 
-void BlockCompressor::Store(BitMemoryWriter &memory_, StreamsInfo& rawStreamInfo_, StreamsInfo& compStreamInfo_,
-							const FastqDataChunk &chunk_)
+void BlockCompressor::Store(BitMemoryWriter &memory_, DsrcDataChunk& dsrcChunk_, const FastqDataChunk &chunk_)
 {
-	ParseRecords(chunk_, rawStreamInfo_);
+	StartPreprocessing(chunkHeader.checksumFlags);
 
-	PreprocessRecords(chunkHeader.checksumFlags);
+	ParseRecords(chunk_, dsrcChunk_.rawStreamsInfo);
+
+	FinishPreprocessing(chunkHeader.checksumFlags);
 
 	AnalyzeRecords();
 
-	StoreRecords(memory_, compStreamInfo_);
+	StoreRecords(memory_, dsrcChunk_.compStreamsInfo);
+
+	dsrcChunk_.recordsCount = chunkHeader.recordsCount;
+	dsrcChunk_.rawSize = chunkHeader.rawChunkSize + 1;		// +1 for the last '\n'
 
 	Reset();
 }
@@ -253,12 +347,19 @@ void BlockCompressor::Store(BitMemoryWriter &memory_, StreamsInfo& rawStreamInfo
 
 void BlockCompressor::StoreRecords(BitMemoryWriter &memory_, StreamsInfo& streamInfo_)
 {
-	uint64 pos = memory_.Position();
+	if (compSettings.parallelStreams)
+	{
+		StoreRecordsParallel(memory_, streamInfo_);
+		return;
+	}
+
+	const uint64 blockPos = memory_.Position();
+	uint64 pos = blockPos;
 
 	// store meta data
 	//
 	CONTROL_CHECK_W(memory_);
-	StoreMetaData(memory_);
+	const uint64 offsetsPos = StoreMetaData(memory_);
 
 	streamInfo_.sizes[StreamsInfo::MetaStream] = memory_.Position() - pos;
 	pos = memory_.Position();
@@ -267,17 +368,21 @@ void BlockCompressor::StoreRecords(BitMemoryWriter &memory_, StreamsInfo& stream
 	//
 	CONTROL_CHECK_W(memory_);
 	StoreTags(memory_);
+	memory_.FlushPartialWordBuffer();
 
 	streamInfo_.sizes[StreamsInfo::TagStream] = memory_.Position() - pos;
 	pos = memory_.Position();
+	chunkHeader.qualityOffset = pos - blockPos;
 
 	// store quality
 	//
 	CONTROL_CHECK_W(memory_);
 	StoreQuality(memory_);
+	memory_.FlushPartialWordBuffer();
 
 	streamInfo_.sizes[StreamsInfo::QualityStream] = memory_.Position() - pos;
 	pos = memory_.Position();
+	chunkHeader.dnaOffset = pos - blockPos;
 
 	// store dna
 	//
@@ -287,21 +392,112 @@ void BlockCompressor::StoreRecords(BitMemoryWriter &memory_, StreamsInfo& stream
 	streamInfo_.sizes[StreamsInfo::DnaStream] = memory_.Position() - pos;
 
 	CONTROL_CHECK_W(memory_);
+
+	// fill in the streams offsets reserved in meta data
+	//
+	pos = memory_.Position();
+	memory_.SetPosition(offsetsPos);
+	memory_.PutWord(chunkHeader.qualityOffset);
+	memory_.PutWord(chunkHeader.dnaOffset);
+	memory_.SetPosition(pos);
+}
+
+
+void BlockCompressor::StoreRecordsParallel(BitMemoryWriter &memory_, StreamsInfo& streamInfo_)
+{
+	// the streams are independent once the records are analyzed -- the quality
+	// and DNA streams are encoded into own buffers on separate threads while
+	// the tags are stored in place, then the buffers are appended, so that
+	// the block layout is the same as when storing the streams sequentially
+	//
+	if (qualityBuffer == NULL)
+	{
+		qualityBuffer = new Buffer(BitMemoryWriter::DefaultBufferSize);
+		dnaBuffer = new Buffer(BitMemoryWriter::DefaultBufferSize);
+		qualityThread = new StreamThread(*this, &BlockCompressor::StoreQuality);
+		dnaThread = new StreamThread(*this, &BlockCompressor::StoreDNA);
+	}
+
+	BitMemoryWriter qualityMemory(*qualityBuffer);
+	BitMemoryWriter dnaMemory(*dnaBuffer);
+
+	qualityThread->Start(qualityMemory);
+	dnaThread->Start(dnaMemory);
+
+	const uint64 blockPos = memory_.Position();
+	uint64 pos = blockPos;
+
+	// store meta data
+	//
+	CONTROL_CHECK_W(memory_);
+	const uint64 offsetsPos = StoreMetaData(memory_);
+
+	streamInfo_.sizes[StreamsInfo::MetaStream] = memory_.Position() - pos;
+	pos = memory_.Position();
+
+	// store tags
+	//
+	CONTROL_CHECK_W(memory_);
+	StoreTags(memory_);
+	memory_.FlushPartialWordBuffer();
+
+	streamInfo_.sizes[StreamsInfo::TagStream] = memory_.Position() - pos;
+
+	qualityThread->Wait();
+	dnaThread->Wait();
+
+	qualityMemory.FlushPartialWordBuffer();
+	dnaMemory.FlushPartialWordBuffer();
+
+	// append quality
+	//
+	pos = memory_.Position();
+	chunkHeader.qualityOffset = pos - blockPos;
+
+	CONTROL_CHECK_W(memory_);
+	memory_.PutBytes(qualityMemory.Pointer(), qualityMemory.Position());
+
+	streamInfo_.sizes[StreamsInfo::QualityStream] = memory_.Position() - pos;
+
+	// append dna
+	//
+	pos = memory_.Position();
+	chunkHeader.dnaOffset = pos - blockPos;
+
+	CONTROL_CHECK_W(memory_);
+	memory_.PutBytes(dnaMemory.Pointer(), dnaMemory.Position());
+
+	streamInfo_.sizes[StreamsInfo::DnaStream] = memory_.Position() - pos;
+
+	CONTROL_CHECK_W(memory_);
+
+	// fill in the streams offsets reserved in meta data
+	//
+	pos = memory_.Position();
+	memory_.SetPosition(offsetsPos);
+	memory_.PutWord(chunkHeader.qualityOffset);
+	memory_.PutWord(chunkHeader.dnaOffset);
+	memory_.SetPosition(pos);
 }
 
 
 void BlockCompressor::Read(BitMemoryReader &memory_, FastqDataChunk &chunk)
 {
-	ReadRecords(memory_, chunk);
+	ReadRecords(memory_, chunk, fieldsMask);
 
 	PostprocessRecords(fq::FastqChecksum::CALC_NONE);
 
+	if (fieldsMask != FastqFields::All)
+		CompactFields(chunk);
+
 	Reset();
 }
 
 
-void BlockCompressor::ReadRecords(BitMemoryReader &memory_, FastqDataChunk &chunk_)
+void BlockCompressor::ReadRecords(BitMemoryReader &memory_, FastqDataChunk &chunk_, uint32 fieldsMask_)
 {
+	const uint64 blockPos = memory_.Position();
+
 	CONTROL_CHECK_R(memory_);
 	ReadMetaData(memory_);
 
@@ -315,16 +511,94 @@ void BlockCompressor::ReadRecords(BitMemoryReader &memory_, FastqDataChunk &chun
 		chunk_.data.Extend(chunkHeader.rawChunkSize + MEM_EXTENSION_FACTOR(chunkHeader.rawChunkSize));
 	}
 
-	CONTROL_CHECK_R(memory_);
-	ReadTags(memory_, chunk_);
+	// having the streams offsets, the streams of not selected fields can be
+	// skipped -- however, the quality stream is needed to decode the sequences
+	// unless all the DNA symbols are kept in the DNA stream, and the chained
+	// models need all the symbols to follow the next blocks
+	const bool hasStreamsIndex = (chunkHeader.flags & FLAG_STREAMS_INDEX) != 0;
+	const bool readModels = !hasStreamsIndex || compSettings.HasModelChains();
+	const bool readTags = !hasStreamsIndex || (fieldsMask_ & FastqFields::Tag) != 0;
+	const bool readDna = readModels || (fieldsMask_ & FastqFields::Sequence) != 0;
+	const bool readQuality = readModels || (fieldsMask_ & FastqFields::Quality) != 0
+			|| (readDna && (chunkHeader.flags & FLAG_PLAIN_SEQUENCE) == 0);
 
 	CONTROL_CHECK_R(memory_);
-	ReadQuality(memory_);
+	ReadTags(memory_, chunk_, readTags);
 
-	CONTROL_CHECK_R(memory_);
-	ReadDNA(memory_);
+	if (readQuality)
+	{
+		if (hasStreamsIndex)
+		{
+			memory_.SetPosition(blockPos + chunkHeader.qualityOffset);
+			memory_.FlushInputWordBuffer();
+		}
 
-	CONTROL_CHECK_R(memory_);
+		CONTROL_CHECK_R(memory_);
+		ReadQuality(memory_);
+	}
+	else
+	{
+		// fill with symbols not carrying any DNA information
+		const uchar symbol = compSettings.lossyQuality ? 1 : 0;
+		for (uint32 i = 0; i < chunkHeader.recordsCount; ++i)
+			std::fill(records[i].quality, records[i].quality + records[i].qualityLen, symbol);
+	}
+
+	if (readDna)
+	{
+		if (hasStreamsIndex)
+		{
+			memory_.SetPosition(blockPos + chunkHeader.dnaOffset);
+			memory_.FlushInputWordBuffer();
+		}
+
+		CONTROL_CHECK_R(memory_);
+		ReadDNA(memory_);
+
+		CONTROL_CHECK_R(memory_);
+	}
+	else
+	{
+		for (uint32 i = 0; i < chunkHeader.recordsCount; ++i)
+			std::fill(records[i].sequence, records[i].sequence + records[i].sequenceLen, 0);
+	}
+}
+
+
+void BlockCompressor::CompactFields(FastqDataChunk& chunk_)
+{
+	// the selected fields are only moved towards the chunk beginning
+	uchar* chunkBegin = chunk_.data.Pointer();
+	uint64 bufPos = 0;
+
+	for (uint32 i = 0; i < chunkHeader.recordsCount; ++i)
+	{
+		const FastqRecord& rec = records[i];
+
+		if ((fieldsMask & FastqFields::Tag) != 0)
+		{
+			std::memmove(chunkBegin + bufPos, rec.title, rec.titleLen);
+			bufPos += rec.titleLen;
+			chunkBegin[bufPos++] = '\n';
+		}
+
+		if ((fieldsMask & FastqFields::Sequence) != 0)
+		{
+			std::memmove(chunkBegin + bufPos, rec.sequence, rec.sequenceLen);
+			bufPos += rec.sequenceLen;
+			chunkBegin[bufPos++] = '\n';
+		}
+
+		if ((fieldsMask & FastqFields::Quality) != 0)
+		{
+			std::memmove(chunkBegin + bufPos, rec.quality, rec.qualityLen);
+			bufPos += rec.qualityLen;
+			chunkBegin[bufPos++] = '\n';
+		}
+	}
+
+	ASSERT(bufPos <= chunk_.size);
+	chunk_.size = bufPos;
 }
 
 
@@ -383,55 +657,50 @@ void BlockCompressor::ReadMetaData(BitMemoryReader &memory_)
 		}
 	}
 
+	if ((chunkHeader.flags & FLAG_STREAMS_INDEX) != 0)
+	{
+		chunkHeader.qualityOffset = memory_.GetWord();
+		chunkHeader.dnaOffset = memory_.GetWord();
+
+		const uint32 lenBits = core::bit_length(chunkHeader.maxQuaLength - chunkHeader.minQuaLength);
+		for (uint32 i = 0; i < chunkHeader.recordsCount; ++i)
+		{
+			if (lenBits > 0)
+				records[i].qualityLen = memory_.GetBits(lenBits) + chunkHeader.minQuaLength;
+			else
+				records[i].qualityLen = chunkHeader.maxQuaLength;
+		}
+	}
+
 	memory_.FlushInputWordBuffer();
 }
 
 
-void BlockCompressor::AnalyzeTags()
+// the constant first symbol of the color-space records is stored once in
+// the block header -- known only when all the records are processed
+void BlockCompressor::ReduceColorSpaceRecords()
 {
-	bool cs_reduce_lens = datasetType.colorSpace && chunkHeader.csConstBeginSym;
-
-	TagAnalyzer* analyzer = tagModeler.GetAnalyzer();
-
-	analyzer->InitializeFieldsStats(records[0]);
-
 	for (uint32 j = 0; j < chunkHeader.recordsCount; ++j)
 	{
 		FastqRecord &rec = records[j];
 
-		analyzer->UpdateFieldsStats(rec);
+		ASSERT(rec.qualityLen > 1);
+		ASSERT(rec.sequenceLen > 1);
 
-		//
-		// this should be logically split
-		//
+		rec.sequence++;
+		rec.quality++;
 
-		// 2nd pass:
-		//
-		if (cs_reduce_lens)
-		{
-			ASSERT(rec.qualityLen > 1);
-			ASSERT(rec.sequenceLen > 1);
-
-			rec.sequence++;
-			rec.quality++;
+		rec.qualityLen -= 1;
+		rec.sequenceLen -= 1;
 
-			rec.qualityLen -= 1;
-			rec.sequenceLen -= 1;
-
-			//ASSERT(rec.truncatedLen > 0);		// this can be buggy in case '#######...'
-			if (rec.truncatedLen > 0)
-				rec.truncatedLen -= 1;
-		}
+		//ASSERT(rec.truncatedLen > 0);		// this can be buggy in case '#######...'
+		if (rec.truncatedLen > 0)
+			rec.truncatedLen -= 1;
 	}
-
-	analyzer->FinalizeFieldsStats();
-
-	if (analyzer->GetStats().mixedFormatting)
-		chunkHeader.flags |= FLAG_MIXED_FIELD_FORMATTING;
 }
 
 
-void BlockCompressor::StoreMetaData(BitMemoryWriter &memory_)
+uint64 BlockCompressor::StoreMetaData(BitMemoryWriter &memory_)
 {
 	memory_.PutWord(chunkHeader.recordsCount);
 	memory_.PutWord(chunkHeader.maxQuaLength);
@@ -470,22 +739,84 @@ void BlockCompressor::StoreMetaData(BitMemoryWriter &memory_)
 		}
 	}
 
+	// reserve space for the streams offsets, filled after storing the streams
+	const uint64 offsetsPos = memory_.Position();
+	memory_.PutWord(0);
+	memory_.PutWord(0);
+
+	// store records lengths
+	const uint32 lenBits = core::bit_length(chunkHeader.maxQuaLength - chunkHeader.minQuaLength);
+	if (lenBits > 0)
+	{
+		for (uint32 i = 0; i < chunkHeader.recordsCount; ++i)
+			memory_.PutBits(records[i].qualityLen - chunkHeader.minQuaLength, lenBits);
+	}
+
 	memory_.FlushPartialWordBuffer();
+
+	return offsetsPos;
 }
 
 
 void BlockCompressor::StoreDNA(BitMemoryWriter &memory_)
 {
+	if ((chunkHeader.flags & FLAG_CHAINED_MODELS) == 0)
+		ResetDnaModels();
+
 	dnaModeler->Encode(memory_, records.data(), chunkHeader.recordsCount);
 }
 
 
 void BlockCompressor::StoreQuality(BitMemoryWriter &memory_)
 {
+	if ((chunkHeader.flags & FLAG_CHAINED_MODELS) == 0)
+		ResetQualityModels();
+
 	qualityModeler->Encode(memory_, records.data(), chunkHeader.recordsCount);
 }
 
 
+// the blocks not continuing the previous ones start from the cleared models
+// or, when given, the trained ones of the dictionary
+void BlockCompressor::ResetDnaModels()
+{
+	dnaModeler->Clear();
+
+	if (compSettings.modelDictionary != NULL && !compSettings.modelDictionary->DnaModels().empty())
+	{
+		const std::vector<byte>& models = compSettings.modelDictionary->DnaModels();
+		BitMemoryReader reader((byte*)models.data(), models.size());
+		dnaModeler->ReadModels(reader);
+	}
+}
+
+
+void BlockCompressor::ResetQualityModels()
+{
+	qualityModeler->Clear();
+
+	if (compSettings.modelDictionary != NULL && !compSettings.modelDictionary->QualityModels().empty())
+	{
+		const std::vector<byte>& models = compSettings.modelDictionary->QualityModels();
+		BitMemoryReader reader((byte*)models.data(), models.size());
+		qualityModeler->ReadModels(reader);
+	}
+}
+
+
+void BlockCompressor::StoreModels(ModelDictionary& dictionary_) const
+{
+	BitMemoryWriter dnaWriter;
+	dnaModeler->StoreModels(dnaWriter);
+
+	BitMemoryWriter qualityWriter;
+	qualityModeler->StoreModels(qualityWriter);
+
+	dictionary_.SetModels(compSettings, dnaWriter.Pointer(), dnaWriter.Position(),
+						  qualityWriter.Pointer(), qualityWriter.Position());
+}
+
+
 void BlockCompressor::StoreTags(BitMemoryWriter &memory_)
 {
 	ITagEncoder* encoder = NULL;
@@ -494,25 +825,13 @@ void BlockCompressor::StoreTags(BitMemoryWriter &memory_)
 	else
 		encoder = tagModeler.SelectEncoder(TagModeler::TagTokenizeHuffman);
 
-	const uint32 lenBits = core::bit_length(chunkHeader.maxQuaLength - chunkHeader.minQuaLength);
-	const bool isVariableLen = lenBits > 0;
-
 	encoder->StartEncoding(memory_, &tagModeler.GetAnalyzer()->GetStats());
 
-	// store record title info + some meta-data
+	// store record title info, the records lengths are kept in meta data
 	//
 	for (uint32 i = 0; i < chunkHeader.recordsCount; ++i)
 	{
-		const FastqRecord &rec = records[i];
-
-		encoder->EncodeNextFields(memory_, rec);
-
-		// save other meta info
-		//
-		if (isVariableLen)
-		{
-			memory_.PutBits(rec.qualityLen - chunkHeader.minQuaLength, lenBits);
-		}
+		encoder->EncodeNextFields(memory_, records[i]);
 	}
 
 	encoder->FinishEncoding(memory_);
@@ -521,17 +840,23 @@ void BlockCompressor::StoreTags(BitMemoryWriter &memory_)
 
 void BlockCompressor::ReadDNA(BitMemoryReader &memory_)
 {
+	if ((chunkHeader.flags & FLAG_CHAINED_MODELS) == 0)
+		ResetDnaModels();
+
 	dnaModeler->Decode(memory_, records.data(), chunkHeader.recordsCount);
 }
 
 
 void BlockCompressor::ReadQuality(BitMemoryReader &memory_)
 {
+	if ((chunkHeader.flags & FLAG_CHAINED_MODELS) == 0)
+		ResetQualityModels();
+
 	qualityModeler->Decode(memory_, records.data(), chunkHeader.recordsCount);
 }
 
 
-void BlockCompressor::ReadTags(BitMemoryReader &memory_, FastqDataChunk& fqChunk_)
+void BlockCompressor::ReadTags(BitMemoryReader &memory_, FastqDataChunk& fqChunk_, bool decodeTags_)
 {
 	ITagDecoder* decoder = NULL;
 
@@ -547,7 +872,12 @@ void BlockCompressor::ReadTags(BitMemoryReader &memory_, FastqDataChunk& fqChunk
 	const bool isVariableLen =  lenBits > 0;
 	const bool csConstDeltaEncode = datasetType.colorSpace && (chunkHeader.flags & FLAG_DELTA_CONSTANT) != 0;
 
-	decoder->StartDecoding(memory_);
+	// blocks prior the streams index keep the records lengths in tags stream
+	const bool lengthsInTags = (chunkHeader.flags & FLAG_STREAMS_INDEX) == 0;
+
+	// when not decoding tags, only the records layout is being prepared
+	if (decodeTags_)
+		decoder->StartDecoding(memory_);
 
 	for (uint32 i = 0; i < chunkHeader.recordsCount; ++i)
 	{
@@ -557,7 +887,8 @@ void BlockCompressor::ReadTags(BitMemoryReader &memory_, FastqDataChunk& fqChunk
 		curRec.titleLen = 0;
 		curRec.title = chunkBegin + bufPos;
 
-		decoder->DecodeNextFields(memory_, curRec);
+		if (decodeTags_)
+			decoder->DecodeNextFields(memory_, curRec);
 
 		bufPos += curRec.titleLen;		// title
 		chunkBegin[bufPos++] = '\n';
@@ -565,13 +896,21 @@ void BlockCompressor::ReadTags(BitMemoryReader &memory_, FastqDataChunk& fqChunk
 		// code below should be logically split, but to avoid another loop
 		// throught the records we are doing it here
 
-		if (isVariableLen)
-			curRec.qualityLen = memory_.GetBits(lenBits) + chunkHeader.minQuaLength;
-		else
-			curRec.qualityLen = chunkHeader.maxQuaLength;
+		if (lengthsInTags)
+		{
+			if (isVariableLen)
+				curRec.qualityLen = memory_.GetBits(lenBits) + chunkHeader.minQuaLength;
+			else
+				curRec.qualityLen = chunkHeader.maxQuaLength;
+		}
 
 		curRec.sequenceLen = curRec.qualityLen;
 
+		// the lengths come from the stream, check the rest of the record fits
+		const uint32 plusLen = (datasetType.plusRepetition && decodeTags_ && curRec.titleLen > 0) ? curRec.titleLen - 1 : 0;
+		if ((uint64)bufPos + 2 * curRec.qualityLen + plusLen + (csConstDeltaEncode ? 2 : 0) + 4 > fqChunk_.data.Size())
+			throw DsrcException("corrupted block data");
+
 		curRec.sequence = chunkBegin + bufPos;
 		bufPos += curRec.sequenceLen;
 		if (csConstDeltaEncode)
@@ -582,7 +921,7 @@ void BlockCompressor::ReadTags(BitMemoryReader &memory_, FastqDataChunk& fqChunk
 		chunkBegin[bufPos++] = '\n';
 
 		chunkBegin[bufPos++] = '+';
-		if (datasetType.plusRepetition)
+		if (datasetType.plusRepetition && decodeTags_)
 		{
 			std::copy(curRec.title + 1, curRec.title + curRec.titleLen, chunkBegin + bufPos);
 			bufPos += curRec.titleLen - 1;
@@ -600,7 +939,8 @@ void BlockCompressor::ReadTags(BitMemoryReader &memory_, FastqDataChunk& fqChunk
 		chunkBegin[bufPos++] = '\n';
 	}
 
-	decoder->FinishDecoding(memory_);
+	if (decodeTags_)
+		decoder->FinishDecoding(memory_);
 }
 
 
@@ -624,6 +964,160 @@ bool BlockCompressor::VerifyChecksum(BitMemoryReader &memory_, FastqDataChunk &c
 	return valid;
 }
 
+
+BlockCompressor::StreamThread::StreamThread(BlockCompressor& compressor_, StoreFunction store_)
+	:	compressor(compressor_)
+	,	store(store_)
+	,	memory(NULL)
+	,	finished(false)
+	,	thread(NULL)
+{
+	thread = new th::thread(th::ref(*this));
+}
+
+BlockCompressor::StreamThread::~StreamThread()
+{
+	{
+		th::lock_guard<th::mutex> lock(mutex);
+		ASSERT(memory == NULL);
+
+		finished = true;
+	}
+	taskCondition.notify_all();
+
+	thread->join();
+	delete thread;
+}
+
+void BlockCompressor::StreamThread::Start(BitMemoryWriter& memory_)
+{
+	{
+		th::lock_guard<th::mutex> lock(mutex);
+		ASSERT(memory == NULL);
+
+		memory = &memory_;
+	}
+	taskCondition.notify_all();
+}
+
+void BlockCompressor::StreamThread::Wait()
+{
+	th::unique_lock<th::mutex> lock(mutex);
+
+	while (memory != NULL)
+		taskCondition.wait(lock);
+}
+
+void BlockCompressor::StreamThread::operator() ()
+{
+	th::unique_lock<th::mutex> lock(mutex);
+
+	for ( ;; )
+	{
+		while (memory == NULL && !finished)
+			taskCondition.wait(lock);
+
+		if (memory == NULL)
+			return;
+
+		// the block thread leaves the compressor alone until Wait() returns
+		lock.unlock();
+		(compressor.*store)(*memory);
+		lock.lock();
+
+		memory = NULL;
+		taskCondition.notify_all();
+	}
+}
+
+
+BlockCompressorChains::BlockCompressorChains(const FastqDatasetType& type_, const CompressionSettings& settings_, uint64 firstBlockId_)
+	:	datasetType(type_)
+	,	compSettings(settings_)
+	,	fieldsMask(FastqFields::All)
+{
+	ASSERT(settings_.ModelChainsBegin(firstBlockId_) == firstBlockId_);
+
+	const uint32 chainCount = settings_.HasModelChains() ? settings_.modelChainCount : 1;
+	ASSERT(chainCount > 0);
+
+	// the compressors are created by the first block of their chain, the
+	// archive can have fewer blocks than chains
+	compressors.resize(chainCount, (BlockCompressor*)NULL);
+	checkers.resize(chainCount, (BlockCompressor*)NULL);
+	nextBlockIds.resize(chainCount);
+
+	for (uint32 i = 0; i < chainCount; ++i)
+		nextBlockIds[i] = firstBlockId_ + i;
+}
+
+BlockCompressorChains::~BlockCompressorChains()
+{
+	for (uint32 i = 0; i < compressors.size(); ++i)
+	{
+		TFree(compressors[i]);
+		TFree(checkers[i]);
+	}
+}
+
+BlockCompressor& BlockCompressorChains::Acquire(uint64 blockId_)
+{
+	const uint32 chain = compSettings.ModelChainOf(blockId_);
+
+	// the queues are ordered, so the awaited block is already being processed
+	th::unique_lock<th::mutex> lock(mutex);
+	ASSERT(nextBlockIds[chain] <= blockId_);
+
+	while (nextBlockIds[chain] != blockId_)
+		blockReleasedCondition.wait(lock);
+	lock.unlock();
+
+	// the chain is owned by the block until released
+	if (compressors[chain] == NULL)
+	{
+		compressors[chain] = new BlockCompressor(datasetType, compSettings);
+		compressors[chain]->SetFieldsMask(fieldsMask);
+	}
+
+	compressors[chain]->SetModelsChained(compSettings.IsChainedBlock(blockId_));
+	return *compressors[chain];
+}
+
+void BlockCompressorChains::Release(uint64 blockId_)
+{
+	const uint32 chain = compSettings.ModelChainOf(blockId_);
+
+	{
+		th::lock_guard<th::mutex> lock(mutex);
+		ASSERT(nextBlockIds[chain] == blockId_);
+
+		nextBlockIds[chain] += compressors.size();
+	}
+	blockReleasedCondition.notify_all();
+}
+
+BlockCompressor& BlockCompressorChains::GetChecker(uint64 blockId_)
+{
+	const uint32 chain = compSettings.ModelChainOf(blockId_);
+	ASSERT(nextBlockIds[chain] == blockId_);
+
+	if (checkers[chain] == NULL)
+		checkers[chain] = new BlockCompressor(datasetType, compSettings);
+	return *checkers[chain];
+}
+
+void BlockCompressorChains::SetFieldsMask(uint32 fieldsMask_)
+{
+	th::lock_guard<th::mutex> lock(mutex);
+	fieldsMask = fieldsMask_;
+
+	for (uint32 i = 0; i < compressors.size(); ++i)
+	{
+		if (compressors[i] != NULL)
+			compressors[i]->SetFieldsMask(fieldsMask_);
+	}
+}
+
 } // namespace comp
 
 } // namespace dsrc
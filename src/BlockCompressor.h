@@ -14,6 +14,16 @@
 
 #include <vector>
 
+#ifdef USE_BOOST_THREAD
+#include <boost/thread.hpp>
+namespace th = boost;
+#else
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+namespace th = std;
+#endif
+
 #include "Common.h"
 #include "Fastq.h"
 #include "RecordsProcessor.h"
@@ -51,6 +61,10 @@ struct ChunkHeader
 	fq::FastqChecksum checksum;
 	uint32 checksumFlags;
 
+	// streams offsets relative to the block beginning
+	uint32 qualityOffset;
+	uint32 dnaOffset;
+
 	ChunkHeader()
 		:	recordsCount(0)
 		,	rawChunkSize(0)
@@ -61,6 +75,8 @@ struct ChunkHeader
 		,	csSeqBegin(0)
 		,	csQuaBegin(0)
 		,	checksumFlags(fq::FastqChecksum::CALC_NONE)
+		,	qualityOffset(0)
+		,	dnaOffset(0)
 	{}
 };
 
@@ -70,7 +86,7 @@ public:
 	BlockCompressor(const FastqDatasetType& type_, const CompressionSettings& settings_);
 	virtual ~BlockCompressor();
 	
-	void Store(core::BitMemoryWriter &memory_, fq::StreamsInfo& rawStreamsInfo_, fq::StreamsInfo& compStreamsInfo_, const fq::FastqDataChunk& chunk_);
+	void Store(core::BitMemoryWriter &memory_, DsrcDataChunk& dsrcChunk_, const fq::FastqDataChunk& chunk_);
 	void Read(core::BitMemoryReader &memory_, fq::FastqDataChunk& chunk_);
 	bool VerifyChecksum(core::BitMemoryReader &memory_, fq::FastqDataChunk& chunk_);
 
@@ -78,6 +94,31 @@ public:
 
 	void Reconfigure(const FastqDatasetType& type_, const CompressionSettings& settings_);
 
+	// the next stored block continues the DNA and quality models left by the
+	// previous one instead of clearing them, see CompressionSettings -- such
+	// a block can be decoded only right after its predecessor
+	void SetModelsChained(bool chained_)
+	{
+		modelsChained = chained_;
+	}
+
+	// selects the record fields to be decoded by Read(), see FastqFields --
+	// when not all of them are selected, Read() outputs only the selected
+	// fields of each record, one per line
+	void SetFieldsMask(uint32 fieldsMask_)
+	{
+		ASSERT(fieldsMask_ != 0 && (fieldsMask_ & ~FastqFields::All) == 0);
+		fieldsMask = fieldsMask_;
+	}
+
+	uint32 GetFieldsMask() const
+	{
+		return fieldsMask;
+	}
+
+	// the current DNA and quality models, to train the dictionary
+	void StoreModels(ModelDictionary& dictionary_) const;
+
 	const std::vector<fq::FastqRecord>& GetRecords() const
 	{
 		return records;
@@ -95,7 +136,37 @@ protected:
 	{
 		FLAG_DELTA_CONSTANT			= BIT(0),
 		FLAG_VARIABLE_LENGTH		= BIT(1),
-		FLAG_MIXED_FIELD_FORMATTING	= BIT(2)		// this should be handled by TagModelerProxy*
+		FLAG_MIXED_FIELD_FORMATTING	= BIT(2),		// this should be handled by TagModelerProxy*
+		FLAG_STREAMS_INDEX			= BIT(3),		// streams offsets and records lengths stored in meta data
+		FLAG_PLAIN_SEQUENCE			= BIT(4),		// no DNA symbols moved to the quality stream
+		FLAG_CHAINED_MODELS			= BIT(5)		// the DNA and quality models not cleared
+	};
+
+	// a thread encoding one of the streams of every block stored concurrently,
+	// kept until the compressor is destroyed
+	class StreamThread
+	{
+	public:
+		typedef void (BlockCompressor::*StoreFunction)(core::BitMemoryWriter&);
+
+		StreamThread(BlockCompressor& compressor_, StoreFunction store_);
+		~StreamThread();
+
+		void Start(core::BitMemoryWriter& memory_);
+		void Wait();
+
+		void operator() ();
+
+	private:
+		BlockCompressor& compressor;
+		const StoreFunction store;
+
+		core::BitMemoryWriter* memory;		// NULL when idle
+		bool finished;
+
+		th::mutex mutex;
+		th::condition_variable taskCondition;
+		th::thread* thread;
 	};
 
 	FastqDatasetType datasetType;
@@ -104,14 +175,29 @@ protected:
 	std::vector<fq::FastqRecord> records;
 
 	ChunkHeader chunkHeader;
+	uint32 fieldsMask;
+	bool modelsChained;
 
 	IRecordsProcessor* recordsProcessor;
 	TagModeler tagModeler;
 	IDnaModelerProxy* dnaModeler;
 	IQualityModeler* qualityModeler;
 
+	// used when encoding the streams concurrently
+	core::Buffer* qualityBuffer;
+	core::Buffer* dnaBuffer;
+	StreamThread* qualityThread;
+	StreamThread* dnaThread;
+
+	static const uint64 RecordsBatchSize = 256;		// records preprocessed right after parsing
+
 	void ParseRecords(const fq::FastqDataChunk& chunk_, fq::StreamsInfo& streamSizes_);
 
+	// the records are preprocessed and their tags analyzed in batches between
+	// the start and finish -- the stats are complete after finishing
+	void StartPreprocessing(uint32 checksumFlags_ = fq::FastqChecksum::CALC_NONE);
+	void PreprocessRecords(uint64 first_, uint64 count_);
+	void FinishPreprocessing(uint32 checksumFlags_ = fq::FastqChecksum::CALC_NONE);
 	void PreprocessRecords(uint32 checksumFlags_ = fq::FastqChecksum::CALC_NONE);
 	void PostprocessRecords(uint32 checksumFlags_ = fq::FastqChecksum::CALC_NONE);
 
@@ -119,14 +205,17 @@ protected:
 	void AnalyzeMetaData(const DnaStats& dnaStats_, const QualityStats& qStats_, const ColorSpaceStats& csStats_);
 
 	void StoreRecords(core::BitMemoryWriter &memory_, fq::StreamsInfo& streamInfo_);
-	void ReadRecords(core::BitMemoryReader &memory_, fq::FastqDataChunk& chunk_);
+	void StoreRecordsParallel(core::BitMemoryWriter &memory_, fq::StreamsInfo& streamInfo_);
+	void ReadRecords(core::BitMemoryReader &memory_, fq::FastqDataChunk& chunk_,
+					 uint32 fieldsMask_ = FastqFields::All);
+	void CompactFields(fq::FastqDataChunk& chunk_);
 
-	void StoreMetaData(core::BitMemoryWriter &memory_);
+	uint64 StoreMetaData(core::BitMemoryWriter &memory_);		// returns the streams offsets position
 	void ReadMetaData(core::BitMemoryReader &memory_);
 
-	void AnalyzeTags();
+	void ReduceColorSpaceRecords();
 	void StoreTags(core::BitMemoryWriter &memory_);
-	void ReadTags(core::BitMemoryReader &memory_, fq::FastqDataChunk& chunk_);
+	void ReadTags(core::BitMemoryReader &memory_, fq::FastqDataChunk& chunk_, bool decodeTags_ = true);
 
 	void StoreDNA(core::BitMemoryWriter &memory_);
 	void StoreQuality(core::BitMemoryWriter &memory_);
@@ -134,9 +223,45 @@ protected:
 	void ReadDNA(core::BitMemoryReader &memory_);
 	void ReadQuality(core::BitMemoryReader &memory_);
 
+	void ResetDnaModels();
+	void ResetQualityModels();
+
 	void Configure(const FastqDatasetType& type_, const CompressionSettings& settings_, bool force_ = false);
 };
 
+
+// the block compressors of the interleaved model chains, see CompressionSettings
+// -- shared by the workers, each block waits for the previous block of its
+// chain to be processed and continues the models left by it
+//
+class BlockCompressorChains
+{
+public:
+	BlockCompressorChains(const FastqDatasetType& type_, const CompressionSettings& settings_, uint64 firstBlockId_ = 0);
+	~BlockCompressorChains();
+
+	BlockCompressor& Acquire(uint64 blockId_);
+	void Release(uint64 blockId_);
+
+	// the compressor decoding the blocks stored by the chain, to verify their
+	// checksums -- valid between Acquire() and Release() of the block
+	BlockCompressor& GetChecker(uint64 blockId_);
+
+	void SetFieldsMask(uint32 fieldsMask_);
+
+private:
+	const FastqDatasetType datasetType;
+	const CompressionSettings compSettings;
+	uint32 fieldsMask;
+
+	std::vector<BlockCompressor*> compressors;
+	std::vector<BlockCompressor*> checkers;
+	std::vector<uint64> nextBlockIds;
+
+	th::mutex mutex;
+	th::condition_variable blockReleasedCondition;
+};
+
 } // namespace comp
 
 } // namespace dsrc
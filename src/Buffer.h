@@ -48,7 +48,7 @@ public:
 	~Buffer()
 	{
 		if (ownsMemory)
-			delete buffer;
+			delete[] buffer;
 	}
 
 	uint64 Size() const
@@ -86,12 +86,17 @@ struct FastqRecord;
 namespace comp
 {
 
+class ModelDictionary;
 
 // TODO: move from Order to Level
 // TODO: move settings to Globals unifying the settings structure
 struct CompressionSettings
 {
-	static const uint32 MaxDnaOrder = 9;
+	static const uint32 MaxDnaOrder = 24;
+	static const uint32 MaxDirectDnaOrder = 9;		// above kept in the hashed models
+	static const uint32 HashedDnaOrder = 16;		// the order of the DNA level 4
+	static const uint32 MixingDnaLevel = 5;
+	static const uint32 MaxDnaMixingLevel = 3;
 	static const uint32 MaxQualityOrder = 6;
 
 	static const uint32 MinFastqBufferSizeMb = 1;
@@ -107,7 +112,20 @@ struct CompressionSettings
 	uint64 tagPreserveFlags;
 	bool lossyQuality;
 	bool calculateCrc32;
+	bool verifyCrc32;		// not stored in the archive
 	uint32 fastqBufferSizeMb;
+	bool parallelStreams;		// not stored in the archive
+	uint32 dnaMixingLevel;		// models mixed instead of the single order-k one, 0 -- none
+
+	// the blocks form modelChainCount interleaved chains -- the block i continues
+	// the DNA and quality models of the block i - modelChainCount, except every
+	// modelChainLength-th block of a chain, starting with the cleared models
+	uint32 modelChainLength;
+	uint32 modelChainCount;
+
+	// the initial models of the blocks not continuing the previous ones, NULL
+	// for the cleared models -- only the hash of the dictionary is stored
+	const ModelDictionary* modelDictionary;
 
 	CompressionSettings()
 		:	dnaOrder(DefaultDnaOrder)
@@ -115,7 +133,13 @@ struct CompressionSettings
 		,	tagPreserveFlags(DefaultTagPreserveFlags)
 		,	lossyQuality(false)
 		,	calculateCrc32(false)
+		,	verifyCrc32(true)
 		,	fastqBufferSizeMb(DefaultFastqBufferSizeMb)
+		,	parallelStreams(false)
+		,	dnaMixingLevel(0)
+		,	modelChainLength(0)
+		,	modelChainCount(1)
+		,	modelDictionary(NULL)
 	{}
 
 	static CompressionSettings Default()
@@ -124,11 +148,55 @@ struct CompressionSettings
 		return s;
 	}
 
+	bool HasModelChains() const
+	{
+		return modelChainLength > 1;
+	}
+
+	uint32 ModelChainOf(uint64 blockId_) const
+	{
+		return blockId_ % modelChainCount;
+	}
+
+	// whether the block continues the models of the previous one of its chain
+	bool IsChainedBlock(uint64 blockId_) const
+	{
+		return HasModelChains() && (blockId_ / modelChainCount) % modelChainLength != 0;
+	}
+
+	// the first block to decode to have the models of the given block -- the
+	// beginning of the group of chains' blocks starting with the cleared models
+	uint64 ModelChainsBegin(uint64 blockId_) const
+	{
+		if (!HasModelChains())
+			return blockId_;
+
+		const uint64 groupSize = (uint64)modelChainCount * modelChainLength;
+		return blockId_ - blockId_ % groupSize;
+	}
+
+	// the levels 1-3 use the direct-indexed models of the orders 3, 6 and 9,
+	// the level 4 the hashed one; the level 5 mixing several models keeps the
+	// order of the level 4, told apart by its mixing level
+	static uint32 DnaOrderOfLevel(uint32 level_)
+	{
+		return level_ <= 3 ? level_ * 3 : HashedDnaOrder;
+	}
+
+	static uint32 DnaLevelOfOrder(uint32 order_, uint32 mixingLevel_)
+	{
+		if (mixingLevel_ > 0)
+			return MixingDnaLevel;
+		return order_ <= MaxDirectDnaOrder ? order_ / 3 : 4;
+	}
+
 	// TODO: implement uniform settings to skip the conversion process
 	static CompressionSettings ConvertFrom(const DsrcCompressionSettings& dsrcSettings_)
 	{
 		CompressionSettings outSettings;
-		outSettings.dnaOrder = dsrcSettings_.dnaCompressionLevel * 3;
+		outSettings.dnaOrder = DnaOrderOfLevel(dsrcSettings_.dnaCompressionLevel);
+		if (dsrcSettings_.dnaCompressionLevel == MixingDnaLevel)
+			outSettings.dnaMixingLevel = dsrcSettings_.dnaMixingLevel;
 		if (dsrcSettings_.lossyQualityCompression)
 			outSettings.qualityOrder = dsrcSettings_.qualityCompressionLevel * 3;
 		else
@@ -137,14 +205,21 @@ struct CompressionSettings
 		outSettings.lossyQuality = dsrcSettings_.lossyQualityCompression;
 		outSettings.tagPreserveFlags = dsrcSettings_.tagPreserveMask;
 		outSettings.calculateCrc32 = dsrcSettings_.calculateCrc32;
+		outSettings.verifyCrc32 = dsrcSettings_.verifyCrc32;
 		outSettings.fastqBufferSizeMb = dsrcSettings_.fastqBufferSizeMb;
+		outSettings.parallelStreams = dsrcSettings_.parallelStreams;
+		outSettings.modelChainLength = dsrcSettings_.modelChainLength;
+		if (outSettings.HasModelChains())
+			outSettings.modelChainCount = dsrcSettings_.modelChainCount;
 		return outSettings;
 	}
 
 	static DsrcCompressionSettings ConvertTo(const CompressionSettings& dsrcSettings_)
 	{
 		DsrcCompressionSettings outSettings;
-		outSettings.dnaCompressionLevel = dsrcSettings_.dnaOrder / 3;
+		outSettings.dnaCompressionLevel = DnaLevelOfOrder(dsrcSettings_.dnaOrder, dsrcSettings_.dnaMixingLevel);
+		if (dsrcSettings_.dnaMixingLevel > 0)
+			outSettings.dnaMixingLevel = dsrcSettings_.dnaMixingLevel;
 		if (dsrcSettings_.lossyQuality)
 			outSettings.qualityCompressionLevel = dsrcSettings_.qualityOrder / 3;
 		else
@@ -153,7 +228,12 @@ struct CompressionSettings
 		outSettings.lossyQualityCompression = dsrcSettings_.lossyQuality;
 		outSettings.tagPreserveMask = dsrcSettings_.tagPreserveFlags;
 		outSettings.calculateCrc32 = dsrcSettings_.calculateCrc32;
+		outSettings.verifyCrc32 = dsrcSettings_.verifyCrc32;
 		outSettings.fastqBufferSizeMb = dsrcSettings_.fastqBufferSizeMb;
+		outSettings.parallelStreams = dsrcSettings_.parallelStreams;
+		outSettings.modelChainLength = dsrcSettings_.modelChainLength;
+		if (dsrcSettings_.HasModelChains())
+			outSettings.modelChainCount = dsrcSettings_.modelChainCount;
 		return outSettings;
 	}
 };
@@ -15,22 +15,218 @@
 #include <vector>
 #include <string>
 
+// carry-less multiplication folding, compiled for the x86 targets and used
+// only when the CPU reports the PCLMULQDQ instruction
+//
+#if defined(DSRC_USE_SSE2) && (defined(__GNUC__) || defined(_MSC_VER))
+#	define DSRC_USE_CRC32_CLMUL 1
+#	include <emmintrin.h>
+#	include <wmmintrin.h>
+#	if defined(_MSC_VER)
+#		include <intrin.h>
+#		define DSRC_TARGET_CLMUL
+#	else
+#		define DSRC_TARGET_CLMUL __attribute__((target("pclmul")))
+#	endif
+#endif
+
 namespace dsrc
 {
 
 namespace core
 {
 
+// CRC32 engine of the standard reflected polynomial: slicing-by-8 tables
+// processing 8 bytes per step and, where supported, 4x128-bit folding with
+// carry-less multiplication followed by a Barrett reduction (after Intel's
+// "Fast CRC Computation Using PCLMULQDQ Instruction")
+//
+class Crc32Engine
+{
+public:
+	static const uint32 StandardPolynomial = 0xEDB88320;
+	static const uint32 MinClmulLength = 64;
+
+	static const Crc32Engine& Instance()
+	{
+		static const Crc32Engine engine;
+		return engine;
+	}
+
+	const uint32* LookupTable() const
+	{
+		return tables[0];
+	}
+
+	// updates the raw (not inverted) register value
+	uint32 Update(uint32 crc_, const uchar* data_, uint64 len_) const
+	{
+#if defined(DSRC_USE_CRC32_CLMUL)
+		if (hasClmul && len_ >= MinClmulLength)
+		{
+			const uint64 foldLen = len_ & ~(uint64)15;
+			crc_ = UpdateClmul(crc_, data_, foldLen);
+			data_ += foldLen;
+			len_ -= foldLen;
+		}
+#endif
+		return UpdateSlicing8(crc_, data_, len_);
+	}
+
+	uint32 UpdateSlicing8(uint32 crc_, const uchar* data_, uint64 len_) const
+	{
+		for ( ; len_ >= 8; len_ -= 8, data_ += 8)
+		{
+			const uint32 lo = Load32(data_) ^ crc_;
+			const uint32 hi = Load32(data_ + 4);
+			crc_ = tables[7][lo & 0xFF] ^ tables[6][(lo >> 8) & 0xFF]
+				 ^ tables[5][(lo >> 16) & 0xFF] ^ tables[4][lo >> 24]
+				 ^ tables[3][hi & 0xFF] ^ tables[2][(hi >> 8) & 0xFF]
+				 ^ tables[1][(hi >> 16) & 0xFF] ^ tables[0][hi >> 24];
+		}
+
+		for ( ; len_ > 0; --len_, ++data_)
+			crc_ = (crc_ >> 8) ^ tables[0][(*data_ ^ crc_) & 0xFF];
+
+		return crc_;
+	}
+
+	bool HasClmul() const
+	{
+		return hasClmul;
+	}
+
+#if defined(DSRC_USE_CRC32_CLMUL)
+	// the length needs to be a multiple of 16, at least 64
+	DSRC_TARGET_CLMUL static uint32 UpdateClmul(uint32 crc_, const uchar* data_, uint64 len_)
+	{
+		ASSERT(len_ >= MinClmulLength && (len_ & 15) == 0);
+
+		// the folding constants x^(4*128+32), x^(4*128-32), x^(128+32), x^(128-32)
+		// and x^64 mod P and the Barrett constants, all bit-reflected
+		const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596LL, 0x0154442bd4LL);
+		const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009eLL, 0x01751997d0LL);
+		const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124LL);
+		const __m128i poly = _mm_set_epi64x(0x01f7011641LL, 0x01db710641LL);
+		const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+		__m128i x1 = _mm_loadu_si128((const __m128i*)(data_ + 0x00));
+		__m128i x2 = _mm_loadu_si128((const __m128i*)(data_ + 0x10));
+		__m128i x3 = _mm_loadu_si128((const __m128i*)(data_ + 0x20));
+		__m128i x4 = _mm_loadu_si128((const __m128i*)(data_ + 0x30));
+		x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc_));
+
+		data_ += 64;
+		len_ -= 64;
+
+		// fold the four lanes by 64 bytes
+		for ( ; len_ >= 64; len_ -= 64, data_ += 64)
+		{
+			x1 = Fold(x1, k1k2, _mm_loadu_si128((const __m128i*)(data_ + 0x00)));
+			x2 = Fold(x2, k1k2, _mm_loadu_si128((const __m128i*)(data_ + 0x10)));
+			x3 = Fold(x3, k1k2, _mm_loadu_si128((const __m128i*)(data_ + 0x20)));
+			x4 = Fold(x4, k1k2, _mm_loadu_si128((const __m128i*)(data_ + 0x30)));
+		}
+
+		// merge them into one and fold the remaining 16-byte blocks
+		x1 = Fold(x1, k3k4, x2);
+		x1 = Fold(x1, k3k4, x3);
+		x1 = Fold(x1, k3k4, x4);
+
+		for ( ; len_ >= 16; len_ -= 16, data_ += 16)
+			x1 = Fold(x1, k3k4, _mm_loadu_si128((const __m128i*)data_));
+
+		// 128 -> 64 bits
+		x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+		x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+		x2 = _mm_srli_si128(x1, 4);
+		x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k5k0, 0x00);
+		x1 = _mm_xor_si128(x1, x2);
+
+		// Barrett reduction to 32 bits
+		x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), poly, 0x10);
+		x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, mask32), poly, 0x00);
+		x1 = _mm_xor_si128(x1, x2);
+
+		return (uint32)_mm_cvtsi128_si32(_mm_srli_si128(x1, 4));
+	}
+#endif
+
+private:
+	uint32 tables[8][256];
+	bool hasClmul;
+
+	Crc32Engine()
+		:	hasClmul(DetectClmul())
+	{
+		for (uint32 i = 0; i < 256; ++i)
+		{
+			uint32 h = i;
+			for (uint32 j = 0; j < 8; ++j)
+				h = (h & 1) ? (StandardPolynomial ^ (h >> 1)) : (h >> 1);
+			tables[0][i] = h;
+		}
+
+		// tables[k][i] -- CRC of byte i followed by k zero bytes
+		for (uint32 k = 1; k < 8; ++k)
+		{
+			for (uint32 i = 0; i < 256; ++i)
+				tables[k][i] = (tables[k - 1][i] >> 8) ^ tables[0][tables[k - 1][i] & 0xFF];
+		}
+	}
+
+	static uint32 Load32(const uchar* p_)
+	{
+		return (uint32)p_[0] | ((uint32)p_[1] << 8) | ((uint32)p_[2] << 16) | ((uint32)p_[3] << 24);
+	}
+
+	static bool DetectClmul()
+	{
+#if defined(DSRC_USE_CRC32_CLMUL)
+#	if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 1);
+		return (info[2] & (1 << 1)) != 0;
+#	else
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("pclmul") != 0;
+#	endif
+#else
+		return false;
+#endif
+	}
+
+#if defined(DSRC_USE_CRC32_CLMUL)
+	DSRC_TARGET_CLMUL static __m128i Fold(__m128i x_, __m128i k_, __m128i data_)
+	{
+		const __m128i lo = _mm_clmulepi64_si128(x_, k_, 0x00);
+		const __m128i hi = _mm_clmulepi64_si128(x_, k_, 0x11);
+		return _mm_xor_si128(_mm_xor_si128(hi, lo), data_);
+	}
+#endif
+};
+
+
 class Crc32Hasher	// CRC32 LSB
 {
 private:
 	uint32 polynomial;
 	uint32 crc;
-	uint32 lookup_table[256];
+	const uint32* lookup_table;
+	std::vector<uint32> custom_table;		// used only by non-standard polynomials
 
 	void FillLookupTable()
 	{
-		lookup_table[0] = 0;
+		if (polynomial == Crc32Engine::StandardPolynomial)
+		{
+			custom_table.clear();
+			lookup_table = Crc32Engine::Instance().LookupTable();
+			return;
+		}
+
+		custom_table.resize(256);
+		custom_table[0] = 0;
 		for (uint32 i = 1; i < 256; ++i)
 		{
 			uint32 h = i;
@@ -45,18 +241,34 @@ private:
 					h >>= 1;
 				}
 			}
-			lookup_table[i] = h;
+			custom_table[i] = h;
 		}
+		lookup_table = custom_table.data();
 	}
 
 public:
-	Crc32Hasher(uint32 polynomial_ = 0xEDB88320, uint32 seed_ = 0xFFFFFFFF)
+	Crc32Hasher(uint32 polynomial_ = Crc32Engine::StandardPolynomial, uint32 seed_ = 0xFFFFFFFF)
 		:	polynomial(polynomial_)
 		,	crc(seed_)
 	{
 		FillLookupTable();
 	}
 
+	Crc32Hasher(const Crc32Hasher& h_)
+		:	polynomial(h_.polynomial)
+		,	crc(h_.crc)
+	{
+		FillLookupTable();
+	}
+
+	Crc32Hasher& operator=(const Crc32Hasher& h_)
+	{
+		polynomial = h_.polynomial;
+		crc = h_.crc;
+		FillLookupTable();
+		return *this;
+	}
+
 	void UpdateCrc(uchar c_)
 	{
 		crc = (crc >> 8) ^ lookup_table[(c_ ^ crc) & 0xFF];
@@ -64,6 +276,12 @@ public:
 
 	void UpdateCrc(const uchar* str_, uint32 len_)
 	{
+		if (polynomial == Crc32Engine::StandardPolynomial)
+		{
+			crc = Crc32Engine::Instance().Update(crc, str_, len_);
+			return;
+		}
+
 		for (uint32 i = 0; i < len_; ++i)
 		{
 			UpdateCrc(str_[i]);
@@ -75,7 +293,7 @@ public:
 		return crc ^ 0xFFFFFFFF;
 	}
 
-	void Reset(uint32 polynomial_ = 0xEDB88320, uint32 seed_ = 0xFFFFFFFF)
+	void Reset(uint32 polynomial_ = Crc32Engine::StandardPolynomial, uint32 seed_ = 0xFFFFFFFF)
 	{
 		if (polynomial != polynomial_)
 		{
@@ -90,10 +308,7 @@ public:
 		ASSERT(arr_ != NULL);
 
 		Reset();
-		for (uint32 i = 0; i < len_; ++i)
-		{
-			UpdateCrc(arr_[i]);
-		}
+		UpdateCrc(arr_, len_);
 		return GetHash();
 	}
 
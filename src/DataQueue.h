@@ -16,10 +16,13 @@
 
 #ifdef USE_BOOST_THREAD
 #include <boost/thread.hpp>
+#include <boost/atomic.hpp>
 namespace th = boost;
 #else
+#include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <atomic>
 namespace th = std;
 #endif
 
@@ -29,17 +32,19 @@ namespace dsrc
 namespace core
 {
 
+// the original queue serializing all the operations through a mutex,
+// kept for reference and benchmarking
+//
 template <class _TDataType>
-class TDataQueue
+class TMutexDataQueue
 {
 	typedef _TDataType DataType;
 	typedef std::queue<std::pair<int64, DataType*> > part_queue;
 
 	const uint32 threadNum;
 	const uint32 maxPartNum;
-	uint64 completedThreadMask;
 	uint32 partNum;
-	uint64 currentThreadMask;
+	uint32 runningThreadNum;		// producers not completed yet
 	part_queue parts;
 
 	th::mutex mutex;
@@ -48,22 +53,18 @@ class TDataQueue
 
 public:
 	static const uint32 DefaultMaxPartNum = 64;
-	static const uint32 DefaultMaxThreadtNum = 64;
 
-	TDataQueue(uint32 maxPartNum_ = DefaultMaxPartNum, uint32 threadNum_ = 1)
+	TMutexDataQueue(uint32 maxPartNum_ = DefaultMaxPartNum, uint32 threadNum_ = 1)
 		:	threadNum(threadNum_)
 		,	maxPartNum(maxPartNum_)
 		,	partNum(0)
-		,	currentThreadMask(0)
+		,	runningThreadNum(threadNum_)
 	{
 		ASSERT(maxPartNum_ > 0);
 		ASSERT(threadNum_ >= 1);
-		ASSERT(threadNum_ < 64);
-
-		completedThreadMask = ((uint64)1 << threadNum) - 1;
 	}
 
-	~TDataQueue()
+	~TMutexDataQueue()
 	{}
 
 	bool IsEmpty()
@@ -73,15 +74,15 @@ public:
 
 	bool IsCompleted()
 	{
-		return parts.empty() && currentThreadMask == completedThreadMask;
+		return parts.empty() && runningThreadNum == 0;
 	}
 
 	void SetCompleted()
 	{
 		th::lock_guard<th::mutex> lock(mutex);
 
-		ASSERT(currentThreadMask != completedThreadMask);
-		currentThreadMask = (currentThreadMask << 1) | 1;
+		ASSERT(runningThreadNum > 0);
+		runningThreadNum--;
 
 		queueEmptyCondition.notify_all();
 	}
@@ -103,7 +104,7 @@ public:
 	{
 		th::unique_lock<th::mutex> lock(mutex);
 
-		while ((parts.size() == 0) && currentThreadMask != completedThreadMask)
+		while ((parts.size() == 0) && runningThreadNum != 0)
 			queueEmptyCondition.wait(lock);
 
 		if (parts.size() != 0)
@@ -117,17 +118,483 @@ public:
 		}
 
 		// assure this is impossible
-		ASSERT(currentThreadMask == completedThreadMask);
+		ASSERT(runningThreadNum == 0);
 		ASSERT(parts.size() == 0);
 		return false;
 	}
 
 	void Reset()
 	{
-		ASSERT(currentThreadMask == completedThreadMask);
+		ASSERT(runningThreadNum == 0);
 
 		partNum = 0;
-		currentThreadMask = 0;
+		runningThreadNum = threadNum;
+	}
+};
+
+
+// bounded multi-producer multi-consumer queue on a ring buffer of cells with
+// sequence numbers (D. Vyukov's algorithm) -- Push()/Pop() do not lock nor
+// allocate, the threads spin for a while before parking on a condition
+// variable when the queue is full/empty
+//
+template <class _TDataType>
+class TDataQueue
+{
+	typedef _TDataType DataType;
+
+	struct Cell
+	{
+		th::atomic<uint64> sequence;
+		int64 partId;
+		DataType* part;
+	};
+
+	static const uint32 CacheLineSize = 64;
+	static const uint32 SpinCount = 64;
+	static const uint32 SpinYieldCount = 16;
+
+	const uint32 threadNum;
+	const uint32 maxPartNum;
+	th::atomic<uint32> runningThreadNum;		// producers not completed yet
+
+	Cell* cells;
+	uint64 cellMask;
+
+	byte pad0[CacheLineSize];
+	th::atomic<uint64> pushPos;
+	byte pad1[CacheLineSize];
+	th::atomic<uint64> popPos;
+	byte pad2[CacheLineSize];
+
+	// used only for parking the waiting threads
+	th::atomic<uint32> waitingProducers;
+	th::atomic<uint32> waitingConsumers;
+	th::mutex mutex;
+	th::condition_variable queueFullCondition;
+	th::condition_variable queueEmptyCondition;
+
+public:
+	static const uint32 DefaultMaxPartNum = 64;
+
+	TDataQueue(uint32 maxPartNum_ = DefaultMaxPartNum, uint32 threadNum_ = 1)
+		:	threadNum(threadNum_)
+		,	maxPartNum(maxPartNum_)
+		,	runningThreadNum(threadNum_)
+		,	pushPos(0)
+		,	popPos(0)
+		,	waitingProducers(0)
+		,	waitingConsumers(0)
+	{
+		ASSERT(maxPartNum_ > 0);
+		ASSERT(threadNum_ >= 1);
+
+		// as the mutex queue, accept up to maxPartNum + 1 parts
+		uint64 cellNum = 2;
+		while (cellNum < (uint64)maxPartNum_ + 1)
+			cellNum <<= 1;
+
+		cells = new Cell[cellNum];
+		cellMask = cellNum - 1;
+		for (uint64 i = 0; i < cellNum; ++i)
+			cells[i].sequence.store(i, th::memory_order_relaxed);
+	}
+
+	~TDataQueue()
+	{
+		delete[] cells;
+	}
+
+	bool IsEmpty()
+	{
+		return popPos.load(th::memory_order_acquire) == pushPos.load(th::memory_order_acquire);
+	}
+
+	bool IsCompleted()
+	{
+		return IsEmpty() && runningThreadNum.load(th::memory_order_acquire) == 0;
+	}
+
+	void SetCompleted()
+	{
+		th::lock_guard<th::mutex> lock(mutex);
+
+		ASSERT(runningThreadNum.load(th::memory_order_relaxed) > 0);
+		runningThreadNum.fetch_sub(1, th::memory_order_release);
+
+		queueEmptyCondition.notify_all();
+	}
+
+	void Push(int64 partId_, const DataType* part_)
+	{
+		bool pushed = false;
+		for (uint32 i = 0; i < SpinCount && !pushed; ++i)
+		{
+			pushed = TryPush(partId_, part_);
+			if (!pushed)
+				Backoff(i);
+		}
+
+		if (!pushed)
+		{
+			th::unique_lock<th::mutex> lock(mutex);
+			waitingProducers.fetch_add(1);
+			th::atomic_thread_fence(th::memory_order_seq_cst);
+
+			while (!TryPush(partId_, part_))
+				queueFullCondition.wait(lock);
+
+			waitingProducers.fetch_sub(1);
+		}
+
+		Notify(waitingConsumers, queueEmptyCondition);
+	}
+
+	bool Pop(int64 &partId_, DataType* &part_)
+	{
+		bool popped = false;
+		for (uint32 i = 0; i < SpinCount && !popped; ++i)
+		{
+			popped = TryPop(partId_, part_);
+			if (!popped)
+			{
+				// do not spin when there is nothing more to come
+				if (runningThreadNum.load(th::memory_order_acquire) == 0)
+				{
+					popped = TryPop(partId_, part_);
+					if (!popped)
+						return false;
+					break;
+				}
+				Backoff(i);
+			}
+		}
+
+		if (!popped)
+		{
+			th::unique_lock<th::mutex> lock(mutex);
+			waitingConsumers.fetch_add(1);
+			th::atomic_thread_fence(th::memory_order_seq_cst);
+
+			while (!(popped = TryPop(partId_, part_)))
+			{
+				// the parts pushed before completion are visible here
+				if (runningThreadNum.load(th::memory_order_acquire) == 0)
+				{
+					popped = TryPop(partId_, part_);
+					break;
+				}
+				queueEmptyCondition.wait(lock);
+			}
+
+			waitingConsumers.fetch_sub(1);
+			if (!popped)
+				return false;
+		}
+
+		Notify(waitingProducers, queueFullCondition);
+		return true;
+	}
+
+	void Reset()
+	{
+		ASSERT(runningThreadNum.load() == 0);
+		ASSERT(IsEmpty());
+
+		runningThreadNum.store(threadNum);
+	}
+
+private:
+	bool TryPush(int64 partId_, const DataType* part_)
+	{
+		uint64 pos = pushPos.load(th::memory_order_relaxed);
+		Cell* cell;
+
+		for ( ;; )
+		{
+			cell = &cells[pos & cellMask];
+			const int64 diff = (int64)(cell->sequence.load(th::memory_order_acquire) - pos);
+
+			if (diff == 0)
+			{
+				if (pushPos.compare_exchange_weak(pos, pos + 1, th::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0)
+			{
+				return false;		// full
+			}
+			else
+			{
+				pos = pushPos.load(th::memory_order_relaxed);
+			}
+		}
+
+		cell->partId = partId_;
+		cell->part = (DataType*)part_;
+		cell->sequence.store(pos + 1, th::memory_order_release);
+		return true;
+	}
+
+	bool TryPop(int64& partId_, DataType*& part_)
+	{
+		uint64 pos = popPos.load(th::memory_order_relaxed);
+		Cell* cell;
+
+		for ( ;; )
+		{
+			cell = &cells[pos & cellMask];
+			const int64 diff = (int64)(cell->sequence.load(th::memory_order_acquire) - (pos + 1));
+
+			if (diff == 0)
+			{
+				if (popPos.compare_exchange_weak(pos, pos + 1, th::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0)
+			{
+				return false;		// empty
+			}
+			else
+			{
+				pos = popPos.load(th::memory_order_relaxed);
+			}
+		}
+
+		partId_ = cell->partId;
+		part_ = cell->part;
+		cell->sequence.store(pos + cellMask + 1, th::memory_order_release);
+		return true;
+	}
+
+	static void Backoff(uint32 iteration_)
+	{
+		if (iteration_ >= SpinYieldCount)
+			th::this_thread::yield();
+	}
+
+	// wakes up the parked threads, the fence pairs with the one issued
+	// by the waiting thread after registering itself
+	void Notify(th::atomic<uint32>& waiting_, th::condition_variable& condition_)
+	{
+		th::atomic_thread_fence(th::memory_order_seq_cst);
+		if (waiting_.load(th::memory_order_relaxed) > 0)
+		{
+			th::lock_guard<th::mutex> lock(mutex);
+			condition_.notify_all();
+		}
+	}
+};
+
+
+// reorder stage between the processing threads and the writer: the parts are
+// handed off directly into a fixed ring indexed by partId % windowSize and
+// popped strictly in the partId order by a single consumer. The producers
+// wait only when their part is windowSize ahead of the next one to pop
+//
+template <class _TDataType>
+class TReorderQueue
+{
+	typedef _TDataType DataType;
+
+	static const uint32 SpinCount = 64;
+	static const uint32 SpinYieldCount = 16;
+
+	const uint32 threadNum;
+	const uint32 windowSize;
+	th::atomic<uint32> runningThreadNum;		// producers not completed yet
+
+	th::atomic<DataType*>* slots;				// NULL when empty
+	th::atomic<int64> nextPartId;
+
+	// used only by the consumer
+	uint64 popCount;
+	uint64 stallCount;
+
+	// used only for parking the waiting threads
+	th::atomic<uint32> waitingProducers;
+	th::atomic<uint32> waitingConsumers;
+	th::mutex mutex;
+	th::condition_variable windowCondition;
+	th::condition_variable partCondition;
+
+public:
+	TReorderQueue(uint32 windowSize_, uint32 threadNum_ = 1)
+		:	threadNum(threadNum_)
+		,	windowSize(windowSize_)
+		,	runningThreadNum(threadNum_)
+		,	nextPartId(0)
+		,	popCount(0)
+		,	stallCount(0)
+		,	waitingProducers(0)
+		,	waitingConsumers(0)
+	{
+		ASSERT(windowSize_ > 0);
+		ASSERT(threadNum_ >= 1);
+
+		slots = new th::atomic<DataType*>[windowSize];
+		for (uint32 i = 0; i < windowSize; ++i)
+			slots[i].store(NULL, th::memory_order_relaxed);
+	}
+
+	~TReorderQueue()
+	{
+		delete[] slots;
+	}
+
+	void SetCompleted()
+	{
+		th::lock_guard<th::mutex> lock(mutex);
+
+		ASSERT(runningThreadNum.load(th::memory_order_relaxed) > 0);
+		runningThreadNum.fetch_sub(1, th::memory_order_release);
+
+		partCondition.notify_all();
+	}
+
+	void Push(int64 partId_, const DataType* part_)
+	{
+		ASSERT(part_ != NULL);
+		ASSERT(partId_ >= nextPartId.load());
+
+		bool inWindow = false;
+		for (uint32 i = 0; i < SpinCount && !inWindow; ++i)
+		{
+			inWindow = IsInWindow(partId_);
+			if (!inWindow)
+				Backoff(i);
+		}
+
+		if (!inWindow)
+		{
+			th::unique_lock<th::mutex> lock(mutex);
+			waitingProducers.fetch_add(1);
+			th::atomic_thread_fence(th::memory_order_seq_cst);
+
+			while (!IsInWindow(partId_))
+				windowCondition.wait(lock);
+
+			waitingProducers.fetch_sub(1);
+		}
+
+		th::atomic<DataType*>& slot = slots[partId_ % windowSize];
+		ASSERT(slot.load() == NULL);
+		slot.store((DataType*)part_, th::memory_order_release);
+
+		Notify(waitingConsumers, partCondition);
+	}
+
+	// returns the parts in the partId order, false when all the producers
+	// completed and there are no more parts
+	bool Pop(int64 &partId_, DataType* &part_)
+	{
+		const int64 partId = nextPartId.load(th::memory_order_relaxed);
+		th::atomic<DataType*>& slot = slots[partId % windowSize];
+
+		DataType* part = slot.load(th::memory_order_acquire);
+		if (part == NULL)
+		{
+			// the writer stalls while a part is missing and the later ones are ready
+			if (HasPendingParts())
+				stallCount++;
+
+			for (uint32 i = 0; i < SpinCount && part == NULL; ++i)
+			{
+				Backoff(i);
+				part = slot.load(th::memory_order_acquire);
+			}
+		}
+
+		if (part == NULL)
+		{
+			th::unique_lock<th::mutex> lock(mutex);
+			waitingConsumers.fetch_add(1);
+			th::atomic_thread_fence(th::memory_order_seq_cst);
+
+			while ((part = slot.load(th::memory_order_acquire)) == NULL)
+			{
+				// the parts pushed before completion are visible here
+				if (runningThreadNum.load(th::memory_order_acquire) == 0)
+				{
+					part = slot.load(th::memory_order_acquire);
+					break;
+				}
+				partCondition.wait(lock);
+			}
+
+			waitingConsumers.fetch_sub(1);
+
+			if (part == NULL)
+			{
+				ASSERT(!HasPendingParts());
+				return false;
+			}
+		}
+
+		slot.store(NULL, th::memory_order_relaxed);
+		nextPartId.store(partId + 1, th::memory_order_release);
+		popCount++;
+
+		Notify(waitingProducers, windowCondition);
+
+		partId_ = partId;
+		part_ = part;
+		return true;
+	}
+
+	void Reset()
+	{
+		ASSERT(runningThreadNum.load() == 0);
+		ASSERT(!HasPendingParts());
+
+		runningThreadNum.store(threadNum);
+		nextPartId.store(0);
+		popCount = 0;
+		stallCount = 0;
+	}
+
+	// number of parts popped and how many times the consumer found the next
+	// part missing while the following ones were already waiting
+	uint64 PopCount() const
+	{
+		return popCount;
+	}
+
+	uint64 StallCount() const
+	{
+		return stallCount;
+	}
+
+private:
+	bool IsInWindow(int64 partId_)
+	{
+		return partId_ < nextPartId.load(th::memory_order_acquire) + (int64)windowSize;
+	}
+
+	bool HasPendingParts()
+	{
+		for (uint32 i = 0; i < windowSize; ++i)
+		{
+			if (slots[i].load(th::memory_order_relaxed) != NULL)
+				return true;
+		}
+		return false;
+	}
+
+	static void Backoff(uint32 iteration_)
+	{
+		if (iteration_ >= SpinYieldCount)
+			th::this_thread::yield();
+	}
+
+	void Notify(th::atomic<uint32>& waiting_, th::condition_variable& condition_)
+	{
+		th::atomic_thread_fence(th::memory_order_seq_cst);
+		if (waiting_.load(th::memory_order_relaxed) > 0)
+		{
+			th::lock_guard<th::mutex> lock(mutex);
+			condition_.notify_all();
+		}
 	}
 };
 
@@ -12,6 +12,13 @@
 
 #include "../include/dsrc/Globals.h"
 
+#include <vector>
+#include <algorithm>
+
+#if defined(DSRC_USE_SSE2)
+#	include <emmintrin.h>
+#endif
+
 #include "DnaModeler.h"
 #include "Stats.h"
 #include "Fastq.h"
@@ -23,6 +30,10 @@ namespace dsrc
 namespace comp
 {
 
+// the symbols of all the records form one 2-bit stream, four symbols per
+// byte with the first one in the most significant bits -- the same layout
+// as written by Put2Bits(), so the block is packed and unpacked in bulk
+//
 class DnaModelerBasicB2 : public IDnaModeler
 {
 public:
@@ -33,30 +44,141 @@ public:
 
 	void Encode(core::BitMemoryWriter& writer_, const fq::FastqRecord* records_, uint32 recordsCount_)
 	{
+		uint64 symbolCount = 0;
+		for (uint32 i = 0; i < recordsCount_; ++i)
+			symbolCount += records_[i].sequenceLen;
+
+		if (symbolCount == 0)
+			return;
+
+		symbols.resize(symbolCount);
+		packed.resize((symbolCount + 3) / 4);
+
+		byte* sym = symbols.data();
 		for (uint32 i = 0; i < recordsCount_; ++i)
 		{
 			const fq::FastqRecord& r = records_[i];
-			for (uint32 j = 0; j < r.sequenceLen; ++j)
-			{
-				ASSERT(r.sequence[j] < 4);
-				writer_.Put2Bits(r.sequence[j]);
-			}
+			std::copy(r.sequence, r.sequence + r.sequenceLen, sym);
+			sym += r.sequenceLen;
 		}
-		writer_.FlushPartialWordBuffer();
+
+		PackSymbols(symbols.data(), symbolCount, packed.data());
+
+		writer_.PutBytes(packed.data(), packed.size());
 	}
 
 	void Decode(core::BitMemoryReader& reader_, fq::FastqRecord* records_, uint32 recordsCount_)
 	{
+		uint64 symbolCount = 0;
+		for (uint32 i = 0; i < recordsCount_; ++i)
+			symbolCount += records_[i].sequenceLen;
+
+		if (symbolCount == 0)
+			return;
+
+		reader_.FlushInputWordBuffer();
+
+		const uint64 pos = reader_.Position();
+		const uint64 packedSize = (symbolCount + 3) / 4;
+
+		ASSERT(pos + packedSize <= reader_.Size());
+
+		symbols.resize(symbolCount);
+		UnpackSymbols(reader_.Pointer() + pos, symbolCount, symbols.data());
+		reader_.SetPosition(pos + packedSize);
+
+		const byte* sym = symbols.data();
 		for (uint32 i = 0; i < recordsCount_; ++i)
 		{
 			fq::FastqRecord& r = records_[i];
-			for (uint32 j = 0; j < r.sequenceLen; ++j)
+			std::copy(sym, sym + r.sequenceLen, r.sequence);
+			sym += r.sequenceLen;
+		}
+	}
+
+private:
+	std::vector<byte> symbols;
+	std::vector<byte> packed;
+
+	static void PackSymbols(const byte* symbols_, uint64 count_, byte* packed_)
+	{
+		uint64 i = 0;
+
+#if defined(DSRC_USE_SSE2)
+		// 64 symbols -> 16 bytes: the symbol pairs are merged within the 16-bit
+		// lanes, the pairs within the 32-bit lanes and the lanes narrowed to bytes
+		const __m128i pairMask = _mm_set1_epi16(0x00FF);
+		const __m128i quadMask = _mm_set1_epi32(0x000000FF);
+
+		for ( ; i + 64 <= count_; i += 64)
+		{
+			__m128i q[4];
+			for (uint32 j = 0; j < 4; ++j)
 			{
-				r.sequence[j] = reader_.Get2Bits();
-				ASSERT(r.sequence[j] < 4);
+				__m128i v = _mm_loadu_si128((const __m128i*)(symbols_ + i + j * 16));
+				v = _mm_and_si128(_mm_or_si128(_mm_slli_epi16(v, 2), _mm_srli_epi16(v, 8)), pairMask);
+				q[j] = _mm_and_si128(_mm_or_si128(_mm_slli_epi32(v, 4), _mm_srli_epi32(v, 16)), quadMask);
 			}
+			__m128i p = _mm_packus_epi16(_mm_packs_epi32(q[0], q[1]), _mm_packs_epi32(q[2], q[3]));
+			_mm_storeu_si128((__m128i*)(packed_ + i / 4), p);
 		}
-		reader_.FlushInputWordBuffer();
+#endif
+
+		for ( ; i + 4 <= count_; i += 4)
+		{
+			ASSERT((symbols_[i] | symbols_[i + 1] | symbols_[i + 2] | symbols_[i + 3]) < 4);
+			packed_[i / 4] = (symbols_[i] << 6) | (symbols_[i + 1] << 4) | (symbols_[i + 2] << 2) | symbols_[i + 3];
+		}
+
+		if (i < count_)
+		{
+			uint32 b = 0;
+			for (uint32 j = 0; j < 4; ++j)
+				b = (b << 2) | (i + j < count_ ? symbols_[i + j] : 0);
+			packed_[i / 4] = b;
+		}
+	}
+
+	static void UnpackSymbols(const byte* packed_, uint64 count_, byte* symbols_)
+	{
+		uint64 i = 0;
+
+#if defined(DSRC_USE_SSE2)
+		// 16 bytes -> 64 symbols: the four bit pairs are extracted into separate
+		// vectors and interleaved back
+		const __m128i symMask = _mm_set1_epi8(3);
+
+		for ( ; i + 64 <= count_; i += 64)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*)(packed_ + i / 4));
+			__m128i s0 = _mm_and_si128(_mm_srli_epi16(v, 6), symMask);
+			__m128i s1 = _mm_and_si128(_mm_srli_epi16(v, 4), symMask);
+			__m128i s2 = _mm_and_si128(_mm_srli_epi16(v, 2), symMask);
+			__m128i s3 = _mm_and_si128(v, symMask);
+
+			__m128i lo01 = _mm_unpacklo_epi8(s0, s1);
+			__m128i hi01 = _mm_unpackhi_epi8(s0, s1);
+			__m128i lo23 = _mm_unpacklo_epi8(s2, s3);
+			__m128i hi23 = _mm_unpackhi_epi8(s2, s3);
+
+			_mm_storeu_si128((__m128i*)(symbols_ + i), _mm_unpacklo_epi16(lo01, lo23));
+			_mm_storeu_si128((__m128i*)(symbols_ + i + 16), _mm_unpackhi_epi16(lo01, lo23));
+			_mm_storeu_si128((__m128i*)(symbols_ + i + 32), _mm_unpacklo_epi16(hi01, hi23));
+			_mm_storeu_si128((__m128i*)(symbols_ + i + 48), _mm_unpackhi_epi16(hi01, hi23));
+		}
+#endif
+
+		for ( ; i + 4 <= count_; i += 4)
+		{
+			const uint32 b = packed_[i / 4];
+			symbols_[i] = b >> 6;
+			symbols_[i + 1] = (b >> 4) & 3;
+			symbols_[i + 2] = (b >> 2) & 3;
+			symbols_[i + 3] = b & 3;
+		}
+
+		for ( ; i < count_; ++i)
+			symbols_[i] = (packed_[i / 4] >> (6 - 2 * (i & 3))) & 3;
 	}
 };
 
@@ -0,0 +1,329 @@
+/*
+  This file is a part of DSRC software distributed under GNU GPL 2 licence.
+  The homepage of the DSRC project is http://sun.aei.polsl.pl/dsrc
+  
+  Authors: Lucas Roguski and Sebastian Deorowicz
+  
+  Version: 2.00
+*/
+
+#ifndef H_DNAMODELERHASHED
+#define H_DNAMODELERHASHED
+
+#include "../include/dsrc/Globals.h"
+
+#include <new>
+#include <vector>
+
+#include "DnaModeler.h"
+#include "Fastq.h"
+#include "RangeCoder.h"
+#include "BitMemory.h"
+#include "SymbolCoderRC.h"
+#include "utils.h"
+
+namespace dsrc
+{
+
+namespace comp
+{
+
+// the order-k contexts too long to be direct-indexed kept in a fixed-size hash
+// table: each 64-byte bucket holds a few slots of the contexts hashed to it, each
+// slot with a check of the context hash and a confidence counter -- the number
+// of the recent hits of its most frequent symbol, halved on a miss. The symbols
+// are coded with the slot's stats when the context proved to be confident and
+// with the direct-indexed lower order model otherwise, while both are updated.
+// On a full bucket the least confident slot is replaced.
+//
+// The bucket is selected by the context without its last symbol, so the bucket
+// of the next symbol is known, and prefetched, while coding the current one
+//
+template <uint32 _TAlphabetSize>
+class TDnaRCHashedModeler : public IDnaModeler
+{
+public:
+	static const uint32 AlphabetSize = _TAlphabetSize;
+	static const uint32 AlphabetBits = core::TLog2<AlphabetSize>::Value;
+
+	// the context needs to fit in 64 bits, e.g. the 8 symbol one is limited to order 21
+	static const uint32 MaxOrder = 64 / AlphabetBits;
+
+	// lock the lower order due to memory usage: 4^11 and 8^7 contexts
+	static const uint32 LowOrder = AlphabetSize <= 4 ? 11 : 7;
+
+	static const uint32 BucketCountLog = 19;		// 32 MB
+	static const uint32 MinConfidence = 2;
+
+	TDnaRCHashedModeler(uint32 order_)
+		:	contextMask(ContextMask(order_ < MaxOrder ? order_ : MaxOrder))
+		,	prefixMask(contextMask >> AlphabetBits)
+		,	context(0)
+		,	lowCoders(LowModelCount)
+		,	memory(NULL)
+		,	buckets(NULL)
+		,	epoch(1)
+	{
+		// the buckets are aligned to the cache lines
+		memory = new byte[BucketCount * sizeof(Bucket) + CacheLineSize];
+		buckets = (Bucket*)(memory + ((CacheLineSize - ((uint64)memory & (CacheLineSize - 1))) & (CacheLineSize - 1)));
+
+		for (uint32 i = 0; i < BucketCount; ++i)
+		{
+			new (buckets + i) Bucket();
+			for (uint32 j = 0; j < SlotsPerBucket; ++j)
+				buckets[i].slots[j].epoch = 0;
+		}
+	}
+
+	~TDnaRCHashedModeler()
+	{
+		delete[] memory;
+	}
+
+	void ProcessStats(const DnaStats &stats_)
+	{
+		ASSERT(stats_.symbolCount <= AlphabetSize);
+	}
+
+	// the encoder knows the following symbols, so it prefetches the memory of
+	// the contexts further ahead than the decoder
+	void Encode(core::BitMemoryWriter& writer_, const fq::FastqRecord* records_, uint32 recordsCount_)
+	{
+		symbols.clear();
+		for (uint32 i = 0; i < recordsCount_; ++i)
+			symbols.insert(symbols.end(), records_[i].sequence, records_[i].sequence + records_[i].sequenceLen);
+
+		const uint64 count = symbols.size();
+		uint64 ahead = context;
+		for (uint64 i = 0; i < PrefetchDistance && i < count; ++i)
+			ahead = (ahead << AlphabetBits) | symbols[i];
+
+		RangeEncoder encoder(writer_);
+
+		encoder.Start();
+		for (uint64 i = 0; i < count; ++i)
+		{
+			ASSERT(symbols[i] < AlphabetSize);
+
+			if (i + PrefetchDistance < count)
+			{
+				PrefetchNext(ahead);
+				ahead = (ahead << AlphabetBits) | symbols[i + PrefetchDistance];
+			}
+			EncodeSymbol(encoder, symbols[i]);
+		}
+		encoder.End();
+	}
+
+	void Decode(core::BitMemoryReader& reader_, fq::FastqRecord* records_, uint32 recordsCount_)
+	{
+		RangeDecoder decoder(reader_);
+
+		decoder.Start();
+		for (uint32 i = 0; i < recordsCount_; ++i)
+		{
+			const fq::FastqRecord& r = records_[i];
+			for (uint32 j = 0; j < r.sequenceLen; ++j)
+			{
+				r.sequence[j] = DecodeSymbol(decoder);
+				ASSERT(r.sequence[j] < AlphabetSize);
+			}
+		}
+		decoder.End();
+	}
+
+	void Clear()
+	{
+		context = 0;
+		lowCoders.Clear();
+
+		// the slots of the previous epochs are free, on the wrap-around all of them are reset
+		if (++epoch == 0)
+		{
+			for (uint32 i = 0; i < BucketCount; ++i)
+			{
+				for (uint32 j = 0; j < SlotsPerBucket; ++j)
+					buckets[i].slots[j].epoch = 0;
+			}
+			epoch = 1;
+		}
+	}
+
+	// only the lower order model is stored, the hashed contexts are left to be learnt
+	void StoreModels(core::BitMemoryWriter& writer_) const
+	{
+		StoreCoderStats(writer_, lowCoders);
+	}
+
+	void ReadModels(core::BitMemoryReader& reader_)
+	{
+		ReadCoderStats(reader_, lowCoders);
+	}
+
+private:
+	typedef typename TSymbolCoderSelector<AlphabetSize>::Coder Coder;
+
+	static const uint32 CacheLineSize = 64;
+	static const uint32 PrefetchDistance = 8;
+	static const uint32 BucketCount = 1 << BucketCountLog;
+	static const uint32 LowModelCount = 1 << (AlphabetBits * LowOrder);
+	static const uint64 LowContextMask = LowModelCount - 1;
+
+	struct Slot
+	{
+		Coder coder;
+		uint16 check;
+		byte confidence;
+		byte epoch;
+	};
+
+	static const uint32 SlotsPerBucket = CacheLineSize / sizeof(Slot);
+
+	struct Bucket
+	{
+		Slot slots[SlotsPerBucket];
+		byte padding[CacheLineSize - SlotsPerBucket * sizeof(Slot)];
+	};
+
+	static_assert(sizeof(Bucket) == CacheLineSize, "the bucket needs to fill the cache line");
+
+	const uint64 contextMask;
+	const uint64 prefixMask;
+	uint64 context;
+
+	TLazyCoderTable<Coder> lowCoders;
+
+	byte* memory;
+	Bucket* buckets;
+	byte epoch;
+
+	std::vector<byte> symbols;
+
+	static uint64 ContextMask(uint32 order_)
+	{
+		return (order_ * AlphabetBits < 64) ? (1ULL << (order_ * AlphabetBits)) - 1 : ~0ULL;
+	}
+
+	void EncodeSymbol(RangeEncoder& rc_, uint32 sym_)
+	{
+		Slot& slot = FindSlot();
+		Coder& low = lowCoders[context & LowContextMask];
+		const uint32 top = slot.coder.TopSymbol();
+
+		if (slot.confidence >= MinConfidence)
+		{
+			slot.coder.EncodeSymbol(rc_, sym_);
+			low.Update(sym_);
+		}
+		else
+		{
+			low.EncodeSymbol(rc_, sym_);
+			slot.coder.Update(sym_);
+		}
+
+		UpdateConfidence(slot, top, sym_);
+		UpdateContext(sym_);
+	}
+
+	uint32 DecodeSymbol(RangeDecoder& rc_)
+	{
+		Slot& slot = FindSlot();
+		PrefetchNext(context);
+		Coder& low = lowCoders[context & LowContextMask];
+		const uint32 top = slot.coder.TopSymbol();
+		uint32 sym;
+
+		if (slot.confidence >= MinConfidence)
+		{
+			sym = slot.coder.DecodeSymbol(rc_);
+			low.Update(sym);
+		}
+		else
+		{
+			sym = low.DecodeSymbol(rc_);
+			slot.coder.Update(sym);
+		}
+
+		UpdateConfidence(slot, top, sym);
+		UpdateContext(sym);
+		return sym;
+	}
+
+	// the bucket of the contexts extending the given one by a symbol
+	Bucket& BucketOf(uint64 prefix_)
+	{
+		return buckets[((prefix_ & prefixMask) * 0x9E3779B97F4A7C15ULL) >> (64 - BucketCountLog)];
+	}
+
+	Slot& FindSlot()
+	{
+		const uint16 check = (uint16)(((context & contextMask) * 0xC2B2AE3D27D4EB4FULL) >> 48);
+		Bucket& b = BucketOf(context >> AlphabetBits);
+
+		uint32 victim = 0;
+		uint32 victimConfidence = 256;
+		for (uint32 i = 0; i < SlotsPerBucket; ++i)
+		{
+			Slot& s = b.slots[i];
+
+			// the slots are filled in order, so a free one ends the search
+			if (s.epoch != epoch)
+			{
+				victim = i;
+				victimConfidence = 0;
+				break;
+			}
+
+			if (s.check == check)
+				return s;
+
+			if (s.confidence < victimConfidence)
+			{
+				victim = i;
+				victimConfidence = s.confidence;
+			}
+		}
+
+		Slot& s = b.slots[victim];
+		s.coder.Clear();
+		s.check = check;
+		s.confidence = 0;
+		s.epoch = epoch;
+		return s;
+	}
+
+	void UpdateConfidence(Slot& slot_, uint32 top_, uint32 sym_)
+	{
+		if (sym_ == top_)
+		{
+			if (slot_.confidence < 255)
+				slot_.confidence++;
+		}
+		else
+		{
+			slot_.confidence >>= 1;
+		}
+	}
+
+	void UpdateContext(uint32 sym_)
+	{
+		context = (context << AlphabetBits) | sym_;
+	}
+
+	// the bucket and the lower order coders of all the symbols possible after
+	// the given context
+	void PrefetchNext(uint64 context_)
+	{
+		const uint32 low = (context_ << AlphabetBits) & LowContextMask;
+		core::prefetch(&BucketOf(context_));
+		core::prefetch(&lowCoders.Peek(low));
+		core::prefetch(&lowCoders.Peek(low + AlphabetSize - 1));
+	}
+};
+
+} // namespace comp
+
+} // namespace dsrc
+
+#endif // H_DNAMODELERHASHED
@@ -99,13 +99,7 @@ void DnaModelerHuffman::Decode(BitMemoryReader& reader_, FastqRecord* records_,
 
 		for (uint32 j = 0; j < r.sequenceLen; ++j)
 		{
-			uint32 bit = reader_.GetBits(coder.GetMinLen());
-			int32 sidx = coder.DecodeFast(bit);
-			while (sidx < 0)
-			{
-				bit = reader_.GetBit();
-				sidx = coder.Decode(bit);
-			};
+			int32 sidx = coder.DecodeSymbol(reader_);
 
 			r.sequence[j] = symbols[sidx];
 		}
@@ -0,0 +1,488 @@
+/*
+  This file is a part of DSRC software distributed under GNU GPL 2 licence.
+  The homepage of the DSRC project is http://sun.aei.polsl.pl/dsrc
+  
+  Authors: Lucas Roguski and Sebastian Deorowicz
+  
+  Version: 2.00
+*/
+
+#ifndef H_DNAMODELERMIXING
+#define H_DNAMODELERMIXING
+
+#include "../include/dsrc/Globals.h"
+
+#include <vector>
+#include <algorithm>
+
+#include "DnaModeler.h"
+#include "Fastq.h"
+#include "RangeCoder.h"
+#include "BitMemory.h"
+#include "utils.h"
+
+namespace dsrc
+{
+
+namespace comp
+{
+
+// the logistic domain of the binary predictions: 12-bit probabilities and their
+// stretched values ln(p / (1 - p)) in [-2047, 2047], scaled by 256. The tables
+// are computed with integers only, so that all the platforms code the same, and
+// once, the users keeping the reference to the shared instance
+//
+class Logistic
+{
+public:
+	static const int32 ProbabilityBits = 12;
+	static const int32 MaxProbability = (1 << ProbabilityBits) - 1;
+	static const int32 MaxStretch = 2047;
+
+	static const Logistic& Instance()
+	{
+		static const Logistic logistic;
+		return logistic;
+	}
+
+	int32 Stretch(int32 p_) const
+	{
+		ASSERT(p_ >= 0 && p_ <= MaxProbability);
+		return stretch[p_];
+	}
+
+	int32 Squash(int32 d_) const
+	{
+		if (d_ > MaxStretch)
+			return MaxProbability;
+		if (d_ < -MaxStretch)
+			return 1;
+		return squash[d_ + MaxStretch];
+	}
+
+private:
+	int16 stretch[MaxProbability + 1];
+	int16 squash[2 * MaxStretch + 1];
+
+	Logistic()
+	{
+		// 1 / (1 + e^-x) interpolated between the points of x = k/2, k in [-16, 16]
+		static const int32 points[33] = {
+			1, 2, 3, 6, 10, 16, 27, 45, 73, 120, 194, 310, 488, 747, 1101, 1546,
+			2047, 2549, 2994, 3348, 3607, 3785, 3901, 3975, 4022, 4050, 4068, 4079,
+			4085, 4089, 4092, 4093, 4094
+		};
+
+		for (int32 d = -MaxStretch; d <= MaxStretch; ++d)
+		{
+			const int32 w = d & 127;
+			const int32 i = (d >> 7) + 16;
+			squash[d + MaxStretch] = (int16)((points[i] * (128 - w) + points[i + 1] * w + 64) >> 7);
+		}
+
+		// the inverse of squash
+		int32 p = 0;
+		for (int32 d = -MaxStretch; d <= MaxStretch; ++d)
+		{
+			const int32 v = squash[d + MaxStretch];
+			for ( ; p <= v; ++p)
+				stretch[p] = (int16)d;
+		}
+		for ( ; p <= MaxProbability; ++p)
+			stretch[p] = (int16)MaxStretch;
+	}
+};
+
+
+// the context model predictions mixed in the logistic domain by one of the
+// weight sets selected by a small context, trained online to minimize the
+// coding cost
+//
+class LogisticMixer
+{
+public:
+	static const uint32 MaxInputCount = 16;
+
+	LogisticMixer()
+		:	logistic(Logistic::Instance())
+		,	inputCount(0)
+		,	learningRate(0)
+		,	weights(NULL)
+		,	selected(NULL)
+		,	pr(0)
+	{}
+
+	void Configure(uint32 inputCount_, uint32 setCount_, int32 learningRate_)
+	{
+		ASSERT(inputCount_ > 0 && inputCount_ <= MaxInputCount);
+
+		inputCount = inputCount_;
+		learningRate = learningRate_;
+		weightsBuffer.resize(inputCount_ * setCount_);
+		weights = weightsBuffer.data();
+		Clear();
+	}
+
+	void Clear()
+	{
+		// all the inputs equally weighted, together summing to 1
+		std::fill(weightsBuffer.begin(), weightsBuffer.end(), (1 << 16) / (int32)inputCount);
+	}
+
+	void SetInput(uint32 i_, int32 st_)
+	{
+		ASSERT(i_ < inputCount);
+		inputs[i_] = st_;
+	}
+
+	int32 Mix(uint32 set_)
+	{
+		selected = weights + set_ * inputCount;
+
+		int64 dot = 0;
+		for (uint32 i = 0; i < inputCount; ++i)
+			dot += (int64)inputs[i] * selected[i];
+
+		pr = logistic.Squash((int32)(dot >> 16));
+		return pr;
+	}
+
+	void Update(uint32 bit_)
+	{
+		const int32 err = (((int32)bit_ << Logistic::ProbabilityBits) - pr) * learningRate;
+		for (uint32 i = 0; i < inputCount; ++i)
+			selected[i] += (inputs[i] * err + (1 << 13)) >> 14;
+	}
+
+private:
+	const Logistic& logistic;
+	uint32 inputCount;
+	int32 learningRate;
+	std::vector<int32> weightsBuffer;
+	int32* weights;
+	int32* selected;
+	int32 inputs[MaxInputCount];
+	int32 pr;
+};
+
+
+// the DNA symbols coded as their AlphabetBits binary decisions, each predicted
+// by several order-k context models mixed with the logistic mixer. The models
+// up to MaxDirectOrder are direct-indexed, the higher ones are hashed.
+//
+// Each context keeps a slot of the counters of the nodes of the binary tree of
+// the symbol (1 .. AlphabetSize - 1) and, in the place of the unused node 0,
+// a tag of the hash check and the epoch of the slot, so the stale slots of the
+// previous blocks and the ones of the other contexts are reset on their first
+// use. The counters keep a 12-bit probability and a 4-bit count, adapting fast
+// to the new contexts and slower to the frequently seen ones.
+//
+// The slots of the contexts extending the same one by a symbol are adjacent,
+// so the memory of the next symbol is prefetched while coding the current one.
+//
+// The mixing level selects the models mixed, trading the speed for the ratio
+//
+template <uint32 _TAlphabetSize>
+class TDnaMixingModeler : public IDnaModeler
+{
+public:
+	static const uint32 AlphabetSize = _TAlphabetSize;
+	static const uint32 AlphabetBits = core::TLog2<AlphabetSize>::Value;
+
+	static const uint32 MaxDirectOrder = AlphabetSize <= 4 ? 11 : 7;
+	static const uint32 HashedTableLog = 24;		// counters of each hashed model, 32 MB
+
+	TDnaMixingModeler(uint32 mixingLevel_)
+		:	logistic(Logistic::Instance())
+		,	modelCount(0)
+		,	context(0)
+		,	epoch(1)
+	{
+		const uint32* orders = ModelOrders(mixingLevel_);
+		for ( ; orders[modelCount] != 0; ++modelCount)
+		{
+			ContextModel& m = models[modelCount];
+			const uint32 order = std::min(orders[modelCount], 64 / AlphabetBits);
+
+			m.hashed = order > MaxDirectOrder;
+			m.prefixMask = PrefixMask(order);
+			m.groupBits = m.hashed ? HashedTableLog - 2 * AlphabetBits : AlphabetBits * (order - 1);
+
+			// the zeroed tags do not match any epoch
+			m.table.resize((uint64)AlphabetSize * AlphabetSize << m.groupBits);
+		}
+
+		mixer.Configure(modelCount + 1, MixerSetCount, MixerLearningRate);
+	}
+
+	void ProcessStats(const DnaStats &stats_)
+	{
+		ASSERT(stats_.symbolCount <= AlphabetSize);
+	}
+
+	// the encoder knows the following symbols, so it prefetches the memory of
+	// the contexts further ahead than the decoder
+	void Encode(core::BitMemoryWriter& writer_, const fq::FastqRecord* records_, uint32 recordsCount_)
+	{
+		symbols.clear();
+		for (uint32 i = 0; i < recordsCount_; ++i)
+			symbols.insert(symbols.end(), records_[i].sequence, records_[i].sequence + records_[i].sequenceLen);
+
+		const uint64 count = symbols.size();
+		uint64 ahead = context;
+		for (uint64 i = 0; i < PrefetchDistance && i < count; ++i)
+			ahead = (ahead << AlphabetBits) | symbols[i];
+
+		RangeEncoder encoder(writer_);
+
+		encoder.Start();
+		for (uint64 i = 0; i < count; ++i)
+		{
+			ASSERT(symbols[i] < AlphabetSize);
+
+			if (i + PrefetchDistance < count)
+			{
+				PrefetchNext(ahead);
+				ahead = (ahead << AlphabetBits) | symbols[i + PrefetchDistance];
+			}
+			EncodeSymbol(encoder, symbols[i]);
+		}
+		encoder.End();
+	}
+
+	void Decode(core::BitMemoryReader& reader_, fq::FastqRecord* records_, uint32 recordsCount_)
+	{
+		RangeDecoder decoder(reader_);
+
+		decoder.Start();
+		for (uint32 i = 0; i < recordsCount_; ++i)
+		{
+			const fq::FastqRecord& r = records_[i];
+			for (uint32 j = 0; j < r.sequenceLen; ++j)
+			{
+				r.sequence[j] = DecodeSymbol(decoder);
+				ASSERT(r.sequence[j] < AlphabetSize);
+			}
+		}
+		decoder.End();
+	}
+
+	void Clear()
+	{
+		context = 0;
+		mixer.Clear();
+
+		// the slots of the previous epochs are reset on their first use,
+		// on the wrap-around all of them are reset
+		if (++epoch == 0)
+		{
+			ResetSlots();
+			epoch = 1;
+		}
+	}
+
+	// the orders of the models mixed on the given level, 0-terminated
+	static const uint32* ModelOrders(uint32 mixingLevel_)
+	{
+		static const uint32 orders[][MaxModelCount + 1] = {
+			{8, 11, 16, 0},
+			{6, 9, 11, 14, 18, 0},
+			{2, 4, 6, 9, 11, 12, 14, 18, 0}
+		};
+
+		ASSERT(mixingLevel_ >= 1 && mixingLevel_ <= 3);
+		return orders[mixingLevel_ - 1];
+	}
+
+private:
+	typedef uint16 Counter;
+
+	static const uint32 MaxModelCount = 8;
+	static const uint32 PrefetchDistance = 8;
+
+	static const uint32 ConfidenceBuckets = 4;
+	static const uint32 MixerSetCount = AlphabetSize * ConfidenceBuckets * ConfidenceBuckets;
+	static const int32 MixerLearningRate = 6;
+	static const int32 MixerBias = 256;
+
+	static const uint32 CountBits = 4;
+	static const uint32 MaxCount = (1 << CountBits) - 1;
+	static const Counter InitialCounter = 1 << (Logistic::ProbabilityBits - 1 + CountBits);
+
+	struct ContextModel
+	{
+		bool hashed;
+		uint64 prefixMask;			// of the context without its last symbol
+		uint32 groupBits;			// of the number of the groups of the slots of the same prefix
+		std::vector<Counter> table;
+	};
+
+	const Logistic& logistic;
+	uint32 modelCount;
+	ContextModel models[MaxModelCount];
+	Counter* slots[MaxModelCount];
+	LogisticMixer mixer;
+
+	uint64 context;
+	byte epoch;
+
+	std::vector<byte> symbols;
+
+	static uint64 PrefixMask(uint32 order_)
+	{
+		const uint32 bits = (order_ - 1) * AlphabetBits;
+		return bits < 64 ? (1ULL << bits) - 1 : ~0ULL;
+	}
+
+	void ResetSlots()
+	{
+		for (uint32 i = 0; i < modelCount; ++i)
+		{
+			std::vector<Counter>& t = models[i].table;
+			for (uint64 j = 0; j < t.size(); j += AlphabetSize)
+				t[j] = 0;
+		}
+	}
+
+	// the first slot of the contexts extending the given prefix by a symbol
+	// and the tag of their slots
+	Counter* SlotGroup(const ContextModel& m_, uint64 prefix_, Counter& tag_)
+	{
+		prefix_ &= m_.prefixMask;
+
+		uint64 group = prefix_;
+		uint32 check = 0;
+		if (m_.hashed)
+		{
+			const uint64 h = prefix_ * 0x9E3779B97F4A7C15ULL;
+			group = h >> (64 - m_.groupBits);
+			check = (uint32)(h >> 8) & 0xFF;
+		}
+
+		tag_ = (Counter)((check << 8) | epoch);
+		return (Counter*)m_.table.data() + group * AlphabetSize * AlphabetSize;
+	}
+
+	void SelectSlots()
+	{
+		const uint32 last = (uint32)context & (AlphabetSize - 1);
+		for (uint32 i = 0; i < modelCount; ++i)
+		{
+			Counter tag;
+			Counter* s = SlotGroup(models[i], context >> AlphabetBits, tag) + last * AlphabetSize;
+			if (s[0] != tag)
+			{
+				s[0] = tag;
+				std::fill(s + 1, s + AlphabetSize, InitialCounter);
+			}
+			slots[i] = s;
+		}
+	}
+
+	// the slots of all the symbols possible after the given context
+	void PrefetchNext(uint64 context_)
+	{
+		for (uint32 i = 0; i < modelCount; ++i)
+		{
+			Counter tag;
+			const char* p = (const char*)SlotGroup(models[i], context_, tag);
+			for (uint32 j = 0; j < AlphabetSize * AlphabetSize * sizeof(Counter); j += 64)
+				core::prefetch(p + j);
+		}
+	}
+
+	// the mixed prediction of the node, its weights selected by the node and
+	// the numbers of the occurrences of the contexts of the two highest orders
+	int32 Predict(uint32 node_)
+	{
+		for (uint32 i = 0; i < modelCount; ++i)
+			mixer.SetInput(i, logistic.Stretch(slots[i][node_] >> CountBits));
+		mixer.SetInput(modelCount, MixerBias);
+
+		const uint32 set = (node_ * ConfidenceBuckets + Confidence(slots[modelCount - 1][node_]))
+							* ConfidenceBuckets + Confidence(slots[modelCount - 2][node_]);
+
+		const int32 p = mixer.Mix(set);
+		return std::min(std::max(p, 1), Logistic::MaxProbability);
+	}
+
+	static uint32 Confidence(Counter c_)
+	{
+		const uint32 count = c_ & MaxCount;
+		return count == 0 ? 0 : (count < 3 ? 1 : (count < MaxCount ? 2 : 3));
+	}
+
+	void Update(uint32 node_, uint32 bit_)
+	{
+		mixer.Update(bit_);
+
+		// p += (bit - p) / (count + 1.5)
+		static const int32 rates[MaxCount + 1] = {
+			43690, 26214, 18724, 14563, 11915, 10082, 8738, 7710,
+			6898, 6241, 5698, 5242, 4854, 4519, 4228, 3971
+		};
+
+		const int32 target = bit_ ? Logistic::MaxProbability : 0;
+		for (uint32 i = 0; i < modelCount; ++i)
+		{
+			Counter& c = slots[i][node_];
+			const int32 p = c >> CountBits;
+			const uint32 n = c & MaxCount;
+			const int32 np = p + ((target - p) * rates[n] >> 16);
+			c = (Counter)((np << CountBits) | (n < MaxCount ? n + 1 : n));
+		}
+	}
+
+	void EncodeSymbol(RangeEncoder& rc_, uint32 sym_)
+	{
+		SelectSlots();
+
+		uint32 node = 1;
+		for (int32 b = AlphabetBits - 1; b >= 0; --b)
+		{
+			const uint32 bit = (sym_ >> b) & 1;
+			const uint32 p = Predict(node);
+
+			if (bit)
+				rc_.EncodeFrequency(p, 0, 1 << Logistic::ProbabilityBits);
+			else
+				rc_.EncodeFrequency((1 << Logistic::ProbabilityBits) - p, p, 1 << Logistic::ProbabilityBits);
+
+			Update(node, bit);
+			node = (node << 1) | bit;
+		}
+
+		context = (context << AlphabetBits) | sym_;
+	}
+
+	uint32 DecodeSymbol(RangeDecoder& rc_)
+	{
+		SelectSlots();
+		PrefetchNext(context);
+
+		uint32 node = 1;
+		for (uint32 b = 0; b < AlphabetBits; ++b)
+		{
+			const uint32 p = Predict(node);
+			const uint32 bit = rc_.GetCumulativeFreq(1 << Logistic::ProbabilityBits) < p;
+
+			if (bit)
+				rc_.UpdateFrequency(p, 0, 1 << Logistic::ProbabilityBits);
+			else
+				rc_.UpdateFrequency((1 << Logistic::ProbabilityBits) - p, p, 1 << Logistic::ProbabilityBits);
+
+			Update(node, bit);
+			node = (node << 1) | bit;
+		}
+
+		const uint32 sym = node - AlphabetSize;
+		context = (context << AlphabetBits) | sym;
+		return sym;
+	}
+};
+
+} // namespace comp
+
+} // namespace dsrc
+
+#endif // H_DNAMODELERMIXING
@@ -16,6 +16,8 @@
 #include "DnaModelerBasicB2.h"
 #include "DnaModelerHuffman.h"
 #include "DnaModelerRCO.h"
+#include "DnaModelerHashed.h"
+#include "DnaModelerMixing.h"
 
 #include <algorithm>
 
@@ -123,12 +125,14 @@ private:
 class DnaOrderModelerProxy : public IDnaModelerProxy
 {
 public:
-	DnaOrderModelerProxy(uint32 order_)
+	DnaOrderModelerProxy(uint32 order_, uint32 mixingLevel_ = 0)
 		:	order(order_)
+		,	mixingLevel(mixingLevel_)
 		,	modeler4s(NULL)
 		,	modeler8s(NULL)
 	{
-		ASSERT(order_ > 0 && order_ < 10);
+		ASSERT(order_ > 0 && order_ <= CompressionSettings::MaxDnaOrder);
+		ASSERT(mixingLevel_ <= CompressionSettings::MaxDnaMixingLevel);
 
 		 modeler4s = CreateModeler(Scheme4Sym);
 	}
@@ -142,9 +146,55 @@ public:
 			delete modeler8s;
 	}
 
+	void Clear()
+	{
+		if (modeler4s != NULL)
+			modeler4s->Clear();
+
+		if (modeler8s != NULL)
+			modeler8s->Clear();
+	}
+
+	// the models of each created scheme, preceded by the scheme id
+	void StoreModels(core::BitMemoryWriter& writer_) const
+	{
+		if (modeler4s != NULL)
+		{
+			writer_.PutByte(Scheme4Sym);
+			modeler4s->StoreModels(writer_);
+		}
+
+		if (modeler8s != NULL)
+		{
+			writer_.PutByte(Scheme8Sym);
+			modeler8s->StoreModels(writer_);
+		}
+
+		writer_.PutByte(SchemeNone);
+	}
+
+	void ReadModels(core::BitMemoryReader& reader_)
+	{
+		for ( ;; )
+		{
+			if (reader_.Position() >= reader_.Size())
+				throw DsrcException("Corrupted model dictionary");
+
+			const SchemeId scheme = reader_.GetByte();
+			if (scheme == SchemeNone)
+				break;
+
+			if (scheme != Scheme4Sym && scheme != Scheme8Sym)
+				throw DsrcException("Corrupted model dictionary");
+
+			SelectModeler(scheme)->ReadModels(reader_);
+		}
+	}
+
 private:
 	static const uint32 MaxSymbolCount = 8;
 	const uint32 order;
+	const uint32 mixingLevel;
 
 	enum OrderNSchemes
 	{
@@ -189,6 +239,24 @@ private:
 
 	IDnaModeler* CreateModeler(SchemeId scheme_)
 	{
+		if (mixingLevel > 0)
+		{
+			if (scheme_ == Scheme4Sym)
+				return new TDnaMixingModeler<4>(mixingLevel);
+
+			if (scheme_ == Scheme8Sym)
+				return new TDnaMixingModeler<8>(mixingLevel);
+		}
+
+		if (order > CompressionSettings::MaxDirectDnaOrder)
+		{
+			if (scheme_ == Scheme4Sym)
+				return new TDnaRCHashedModeler<4>(order);
+
+			if (scheme_ == Scheme8Sym)
+				return new TDnaRCHashedModeler<8>(order);
+		}
+
 		if (scheme_ == Scheme4Sym)
 		{
 			switch (order)
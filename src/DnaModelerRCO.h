@@ -33,7 +33,8 @@ public:
 	static const uint32 Order = _TOrder;
 
 	TDnaRCOrderModeler()
-		:	hash(0)
+		:	coders(ModelCount)
+		,	hash(0)
 	{}
 
 	void ProcessStats(const DnaStats &stats_)
@@ -43,8 +44,6 @@ public:
 
 	void Encode(core::BitMemoryWriter& writer_, const fq::FastqRecord* records_, uint32 recordsCount_)
 	{
-		Clear();
-
 		RangeEncoder encoder(writer_);
 
 		encoder.Start();
@@ -62,8 +61,6 @@ public:
 
 	void Decode(core::BitMemoryReader& reader_, fq::FastqRecord* records_, uint32 recordsCount_)
 	{
-		Clear();
-
 		RangeDecoder decoder(reader_);
 
 		decoder.Start();
@@ -79,16 +76,33 @@ public:
 		decoder.End();
 	}
 
+	void Clear()
+	{
+		// clear hash
+		hash = 0;
+
+		// clear stats -- the contexts are filled with initial '1' value on their first use
+		coders.Clear();
+	}
+
+	void StoreModels(core::BitMemoryWriter& writer_) const
+	{
+		StoreCoderStats(writer_, coders);
+	}
+
+	void ReadModels(core::BitMemoryReader& reader_)
+	{
+		ReadCoderStats(reader_, coders);
+	}
 
 private:
 	typedef uint64 HashType;
-	typedef TSymbolCoderRC<AlphabetSize> Coder;
-	typedef typename Coder::StatType CoderStatType;
+	typedef typename TSymbolCoderSelector<AlphabetSize>::Coder Coder;
 
 	static const HashType HashMask = (1 << (Order * AlphabetBits)) - 1;
 	static const uint32 ModelCount = 1 << (core::TLog2<AlphabetSize>::Value * Order);
 
-	Coder coders[ModelCount];
+	TLazyCoderTable<Coder> coders;
 	HashType hash;
 
 	void EncodeSymbol(RangeEncoder& rc_, uint32 sym_)
@@ -107,17 +121,6 @@ private:
 		return sym;
 	}
 
-
-	void Clear()
-	{
-		// clear hash
-		hash = 0;
-
-		// clear stats -- fill context data with initial '1' value
-		CoderStatType* cd = (CoderStatType*)coders;
-		std::fill(cd, cd + ModelCount * AlphabetSize, 1);
-	}
-
 	HashType GetHash()
 	{
 		return hash;
@@ -8,6 +8,7 @@
 */
 
 #include <algorithm>
+#include <cstring>
 
 #include "../include/dsrc/DsrcArchive.h"
 
@@ -15,6 +16,9 @@
 #include "FastqParser.h"
 #include "DsrcFile.h"
 #include "DsrcIo.h"
+#include "FastqIo.h"
+#include "DsrcWorker.h"
+#include "ErrorHandler.h"
 #include "utils.h"
 
 namespace dsrc
@@ -54,6 +58,7 @@ struct DsrcArchiveWriter::ArchiveWriterImpl : public ArchiveImplBase
 
 	bool isDatasetTypeKnown;
 	uint32 fastqQualityOffset;
+	FastqDatasetType datasetType;
 
 	ArchiveWriterImpl()
 		:	dsrcWriter(NULL)
@@ -117,6 +122,7 @@ struct DsrcArchiveWriter::ArchiveWriterImpl : public ArchiveImplBase
 		ASSERT(compressor != NULL);
 		ASSERT(dsrcWriter != NULL);
 
+		datasetType = type_;
 		compressor->Reconfigure(type_, compSettings);
 		dsrcWriter->SetDatasetType(type_);
 	}
@@ -134,11 +140,24 @@ struct DsrcArchiveWriter::ArchiveWriterImpl : public ArchiveImplBase
 			AddError("no input DSRC file specified");
 
 		if (compressionSettings_.dnaCompressionLevel > DsrcCompressionSettings::MaxDnaCompressionLevel)
-			AddError("invalid DNA compression mode specified [0-3]\n");
+			AddError("invalid DNA compression mode specified [0-5]\n");
 
 		if (compressionSettings_.qualityCompressionLevel > DsrcCompressionSettings::MaxQualityCompressionLevel)
 			AddError("invalid Quality compression mode specified [0-2]\n");
 
+		// the mixing level is used only by the DNA mode 5
+		if (compressionSettings_.dnaCompressionLevel == CompressionSettings::MixingDnaLevel
+				&& (compressionSettings_.dnaMixingLevel < DsrcCompressionSettings::MinDnaMixingLevel
+					|| compressionSettings_.dnaMixingLevel > DsrcCompressionSettings::MaxDnaMixingLevel))
+			AddError("invalid DNA mixing level specified [1-3]\n");
+
+		// the records are compressed and read back block by block, out of the chains order
+		if (compressionSettings_.modelChainLength > 1)
+			AddError("model chains are not supported by the archive interface, use DsrcModule\n");
+
+		if (compressionSettings_.modelDictionary.length() > 0)
+			AddError("model dictionary is not supported by the archive interface, use DsrcModule\n");
+
 		if ( !(compressionSettings_.fastqBufferSizeMb >= DsrcCompressionSettings::MinFastqBufferSizeMB
 			   && compressionSettings_.fastqBufferSizeMb <= DsrcCompressionSettings::MaxFastqBufferSizeMB) )
 		{
@@ -208,7 +227,18 @@ struct DsrcArchiveReader::ArchiveReaderImpl : public ArchiveImplBase
 		}
 		catch (const DsrcException& e)
 		{
-			AddError(e.what());
+			// the dictionary file is not known here, only DsrcModule loads it
+			if (dsrcReader->UsesModelDictionary())
+				AddError("archive with a model dictionary is not supported by the archive interface, use DsrcModule");
+			else
+				AddError(e.what());
+			return false;
+		}
+
+		if (dsrcReader->GetCompressionSettings().HasModelChains())
+		{
+			dsrcReader->FinishDecompress();
+			AddError("archive with model chains is not supported by the archive interface, use DsrcModule");
 			return false;
 		}
 
@@ -306,6 +336,15 @@ bool DsrcArchiveReader::GetCompressionSettings(DsrcCompressionSettings& settings
 	return true;
 }
 
+bool DsrcArchiveReader::GetRecordsCount(uint64& count_) const
+{
+	if (archiveImpl->dsrcReader == NULL || !archiveImpl->dsrcReader->HasRecordsIndex())
+		return false;
+
+	count_ = archiveImpl->dsrcReader->RecordsCount();
+	return true;
+}
+
 
 bool DsrcArchiveReader::IsError() const
 {
@@ -323,12 +362,492 @@ void DsrcArchiveReader::ClearError()
 }
 
 
+// releases the pipeline objects, so the pipeline can be restarted
+template <typename _T>
+inline void Free(_T*& p_)
+{
+	TFree(p_);
+	p_ = NULL;
+}
+
+
+// multithreaded records writer -- the records are serialized back to FASTQ
+// text chunks which are compressed by the DsrcCompressor workers, the same
+// way as when compressing FASTQ files
+//
+struct RecordsWriterMT
+{
+	uint32 threadsNum;
+	uint32 partNum;
+	int64 partId;
+
+	fq::FastqDataPool* fastqPool;
+	fq::FastqDataQueue* fastqQueue;
+	DsrcDataPool* dsrcPool;
+	DsrcDataReorderQueue* dsrcQueue;
+	ErrorHandler* errorHandler;
+
+	DsrcWriter* dataWriter;
+	std::vector<DsrcCompressor*> operators;
+	std::vector<th::thread*> threads;
+
+	fq::FastqDataChunk* fastqChunk;
+
+	RecordsWriterMT()
+		:	threadsNum(0)
+		,	partNum(0)
+		,	partId(0)
+		,	fastqPool(NULL)
+		,	fastqQueue(NULL)
+		,	dsrcPool(NULL)
+		,	dsrcQueue(NULL)
+		,	errorHandler(NULL)
+		,	dataWriter(NULL)
+		,	fastqChunk(NULL)
+	{}
+
+	~RecordsWriterMT()
+	{
+		Finish();
+	}
+
+	void Start(uint32 threadsNum_, uint32 fastqBufferSizeMb_, bool calculateCrc32_)
+	{
+		ASSERT(fastqPool == NULL);
+
+		threadsNum = threadsNum_;
+		partNum = (fastqBufferSizeMb_ < 128) ? threadsNum_ * 4 : threadsNum_ * 2;
+		partId = 0;
+
+		fastqPool = new fq::FastqDataPool(partNum, fastqBufferSizeMb_ << 20);
+		fastqQueue = new fq::FastqDataQueue(partNum, 1);
+		dsrcPool = new DsrcDataPool(partNum, fastqBufferSizeMb_ << 20);
+		dsrcQueue = new DsrcDataReorderQueue(partNum * 2, threadsNum_);
+
+		if (calculateCrc32_)
+			errorHandler = new MultithreadedErrorHandler();
+		else
+			errorHandler = new ErrorHandler();
+
+		fastqPool->Acquire(fastqChunk);
+		fastqChunk->size = 0;
+	}
+
+	bool IsStarted() const
+	{
+		return fastqPool != NULL;
+	}
+
+	uint64 ChunkSize() const
+	{
+		return fastqChunk->size;
+	}
+
+	void AppendRecord(const FastqRecord& rec_)
+	{
+		const uint64 plusLen = MAX(rec_.plus.length(), (size_t)1);
+		const uint64 recSize = rec_.tag.length() + rec_.sequence.length() + plusLen + rec_.quality.length() + 4;
+
+		if (fastqChunk->size + recSize > fastqChunk->data.Size())
+			fastqChunk->data.Extend(fastqChunk->size + recSize, true);
+
+		byte* p = fastqChunk->data.Pointer() + fastqChunk->size;
+		p = AppendLine(p, rec_.tag);
+		p = AppendLine(p, rec_.sequence);
+		if (rec_.plus.length() > 0)
+			p = AppendLine(p, rec_.plus);
+		else
+			p = AppendLine(p, "+");
+		p = AppendLine(p, rec_.quality);
+
+		fastqChunk->size += recSize;
+	}
+
+	// analyzes the dataset type on the text of the first chunk
+	bool AnalyzeChunk(FastqDatasetType& type_)
+	{
+		fq::FastqParser parser;
+		return parser.Analyze(*fastqChunk, type_, type_.qualityOffset == FastqDatasetType::AutoQualityOffsetSelect);
+	}
+
+	void PushChunk(DsrcFileWriter& fileWriter_, const FastqDatasetType& type_, const CompressionSettings& settings_)
+	{
+		ASSERT(fastqChunk->size > 0);
+
+		// the workers are launched once the dataset type is known
+		if (dataWriter == NULL)
+			LaunchThreads(fileWriter_, type_, settings_);
+
+		// the FASTQ chunks are stored without the trailing end of line
+		fastqChunk->size -= 1;
+		fastqQueue->Push(partId++, fastqChunk);
+
+		fastqPool->Acquire(fastqChunk);
+		fastqChunk->size = 0;
+	}
+
+	// waits for all the chunks to be compressed and written, returns false on error
+	bool Finish()
+	{
+		if (!IsStarted())
+			return true;
+
+		fastqPool->Release(fastqChunk);
+		fastqChunk = NULL;
+
+		bool ok = true;
+		if (dataWriter != NULL)
+		{
+			fastqQueue->SetCompleted();
+
+			for (std::vector<th::thread*>::iterator i = threads.begin(); i != threads.end(); ++i)
+			{
+				(*i)->join();
+				delete *i;
+			}
+			threads.clear();
+
+			fastqQueue->Reset();
+			dsrcQueue->Reset();
+
+			for (std::vector<DsrcCompressor*>::iterator i = operators.begin(); i != operators.end(); ++i)
+				delete *i;
+			operators.clear();
+
+			ok = !errorHandler->IsError();
+		}
+
+		Free(dataWriter);
+		Free(errorHandler);
+		Free(dsrcQueue);
+		Free(dsrcPool);
+		Free(fastqQueue);
+		Free(fastqPool);
+
+		return ok;
+	}
+
+	std::string GetError() const
+	{
+		return errorHandler != NULL ? errorHandler->GetError() : std::string();
+	}
+
+private:
+	static byte* AppendLine(byte* p_, const std::string& str_)
+	{
+		std::copy(str_.begin(), str_.end(), p_);
+		p_ += str_.length();
+		*p_++ = '\n';
+		return p_;
+	}
+
+	void LaunchThreads(DsrcFileWriter& fileWriter_, const FastqDatasetType& type_, const CompressionSettings& settings_)
+	{
+		dataWriter = new DsrcWriter(fileWriter_, *dsrcQueue, *dsrcPool, *errorHandler);
+		threads.push_back(new th::thread(th::ref(*dataWriter)));
+
+		for (uint32 i = 0; i < threadsNum; ++i)
+		{
+			operators.push_back(new DsrcCompressor(*fastqQueue, *fastqPool, *dsrcQueue, *dsrcPool, *errorHandler, type_, settings_));
+			threads.push_back(new th::thread(th::ref(*operators.back())));
+		}
+	}
+};
+
+
+// multithreaded records reader -- the blocks are decompressed by the
+// DsrcDecompressor workers into FASTQ text chunks, which are split into
+// records in the archive order. At most partNum blocks are kept in flight,
+// so submitting blocks never blocks on the pools
+//
+struct RecordsReaderMT
+{
+	uint32 threadsNum;
+	uint32 partNum;
+	uint32 fieldsMask;
+	bool plusRepetition;
+
+	// the parts are numbered continuously across the seeks, as the reorder
+	// queue expects, so the block id is the part id shifted by the offset
+	int64 nextPartId;			// id of the part to be consumed next
+	int64 submittedPartId;		// id of the part to be submitted next
+	int64 blockIdOffset;
+	uint32 partsInFlight;
+
+	fq::FastqDataPool* fastqPool;
+	fq::FastqDataReorderQueue* fastqQueue;
+	DsrcDataPool* dsrcPool;
+	DsrcDataQueue* dsrcQueue;
+	ErrorHandler* errorHandler;
+
+	std::vector<DsrcDecompressor*> operators;
+	std::vector<th::thread*> threads;
+
+	fq::FastqDataChunk* fastqChunk;
+	uint64 chunkPos;
+
+	RecordsReaderMT()
+		:	threadsNum(0)
+		,	partNum(0)
+		,	fieldsMask(FastqFields::All)
+		,	plusRepetition(false)
+		,	nextPartId(0)
+		,	submittedPartId(0)
+		,	blockIdOffset(0)
+		,	partsInFlight(0)
+		,	fastqPool(NULL)
+		,	fastqQueue(NULL)
+		,	dsrcPool(NULL)
+		,	dsrcQueue(NULL)
+		,	errorHandler(NULL)
+		,	fastqChunk(NULL)
+		,	chunkPos(0)
+	{}
+
+	~RecordsReaderMT()
+	{
+		Finish();
+	}
+
+	bool IsStarted() const
+	{
+		return fastqPool != NULL;
+	}
+
+	void Start(const DsrcFileReader& dsrcReader_, uint32 threadsNum_, uint32 fieldsMask_)
+	{
+		ASSERT(!IsStarted());
+
+		const uint32 fastqBufferSizeMb = dsrcReader_.GetCompressionSettings().fastqBufferSizeMb;
+
+		threadsNum = threadsNum_;
+		partNum = (fastqBufferSizeMb < 128) ? threadsNum_ * 4 : threadsNum_ * 2;
+		fieldsMask = fieldsMask_;
+		plusRepetition = dsrcReader_.GetDatasetType().plusRepetition;
+
+		nextPartId = submittedPartId = 0;
+		blockIdOffset = dsrcReader_.CurrentBlockId();
+		partsInFlight = 0;
+
+		dsrcPool = new DsrcDataPool(partNum, fastqBufferSizeMb << 20);
+		dsrcQueue = new DsrcDataQueue(partNum, 1);
+		fastqPool = new fq::FastqDataPool(partNum, fastqBufferSizeMb << 20);
+		fastqQueue = new fq::FastqDataReorderQueue(partNum, threadsNum_);
+		errorHandler = new MultithreadedErrorHandler();
+
+		for (uint32 i = 0; i < threadsNum; ++i)
+		{
+			operators.push_back(new DsrcDecompressor(*fastqQueue, *fastqPool, *dsrcQueue, *dsrcPool, *errorHandler,
+													 dsrcReader_.GetDatasetType(), dsrcReader_.GetCompressionSettings(),
+													 fieldsMask));
+			threads.push_back(new th::thread(th::ref(*operators.back())));
+		}
+	}
+
+	void Finish()
+	{
+		if (!IsStarted())
+			return;
+
+		Drain();
+
+		dsrcQueue->SetCompleted();
+		for (std::vector<th::thread*>::iterator i = threads.begin(); i != threads.end(); ++i)
+		{
+			(*i)->join();
+			delete *i;
+		}
+		threads.clear();
+
+		fastqQueue->Reset();
+		dsrcQueue->Reset();
+
+		for (std::vector<DsrcDecompressor*>::iterator i = operators.begin(); i != operators.end(); ++i)
+			delete *i;
+		operators.clear();
+
+		Free(errorHandler);
+		Free(fastqQueue);
+		Free(fastqPool);
+		Free(dsrcQueue);
+		Free(dsrcPool);
+	}
+
+	bool ReadNextRecord(DsrcFileReader& dsrcReader_, FastqRecord& rec_)
+	{
+		while (fastqChunk == NULL || chunkPos >= fastqChunk->size)
+		{
+			if (!NextChunk(dsrcReader_))
+				return false;
+		}
+
+		const char* tag = NULL;
+		const char* plus = NULL;
+		uint64 tagLen = 0, plusLen = 0;
+
+		if (fieldsMask == FastqFields::All)
+		{
+			tag = NextLine(tagLen);
+			AssignLine(rec_.sequence);
+			plus = NextLine(plusLen);
+			AssignLine(rec_.quality);
+
+			rec_.tag.assign(tag, tagLen);
+			rec_.plus.assign(plus, plusLen);
+			return true;
+		}
+
+		// the partially decompressed blocks store only the selected fields,
+		// one per line, so the plus line is rebuilt as in the single threaded mode
+		if ((fieldsMask & FastqFields::Tag) != 0)
+			AssignLine(rec_.tag);
+		else
+			rec_.tag.clear();
+
+		if ((fieldsMask & FastqFields::Sequence) != 0)
+			AssignLine(rec_.sequence);
+		else
+			rec_.sequence.clear();
+
+		if ((fieldsMask & FastqFields::Quality) != 0)
+			AssignLine(rec_.quality);
+		else
+			rec_.quality.clear();
+
+		rec_.plus.assign(1, '+');
+		if (plusRepetition && !rec_.tag.empty())
+			rec_.plus.insert(rec_.plus.end(), rec_.tag.begin() + 1, rec_.tag.end());
+
+		return true;
+	}
+
+	// restarts decompression from the given block and skips its first records
+	void SeekToRecord(DsrcFileReader& dsrcReader_, uint64 blockId_, uint64 skipRecords_)
+	{
+		// rewind the current chunk only if it's the requested block
+		if (fastqChunk == NULL || nextPartId - 1 + blockIdOffset != (int64)blockId_)
+		{
+			Drain();
+			dsrcReader_.SeekToBlock(blockId_);
+			blockIdOffset = (int64)blockId_ - submittedPartId;
+
+			if (blockId_ == dsrcReader_.BlockCount() || !NextChunk(dsrcReader_))
+				return;
+		}
+
+		chunkPos = 0;
+		const uint32 linesPerRecord = (fieldsMask == FastqFields::All) ? 4 : PopCount(fieldsMask);
+		for (uint64 i = 0; i < skipRecords_ * linesPerRecord; ++i)
+		{
+			uint64 len;
+			NextLine(len);
+		}
+	}
+
+private:
+	static uint32 PopCount(uint32 x_)
+	{
+		uint32 n = 0;
+		for ( ; x_ != 0; x_ &= x_ - 1)
+			n++;
+		return n;
+	}
+
+	const char* NextLine(uint64& len_)
+	{
+		const char* line = (const char*)fastqChunk->data.Pointer() + chunkPos;
+		const char* end = (const char*)memchr(line, '\n', fastqChunk->size - chunkPos);
+		len_ = (end != NULL) ? (uint64)(end - line) : fastqChunk->size - chunkPos;
+		chunkPos += len_ + 1;
+		return line;
+	}
+
+	void AssignLine(std::string& str_)
+	{
+		uint64 len;
+		const char* line = NextLine(len);
+		str_.assign(line, len);
+	}
+
+	void SubmitChunks(DsrcFileReader& dsrcReader_)
+	{
+		while (partsInFlight < partNum && dsrcReader_.CurrentBlockId() < dsrcReader_.BlockCount())
+		{
+			DsrcDataChunk* dsrcChunk = NULL;
+			dsrcPool->Acquire(dsrcChunk);
+
+			if (!dsrcReader_.ReadNextChunk(dsrcChunk))
+			{
+				dsrcPool->Release(dsrcChunk);
+				break;
+			}
+
+			dsrcQueue->Push(submittedPartId++, dsrcChunk);
+			partsInFlight++;
+		}
+	}
+
+	void ReleaseChunk()
+	{
+		if (fastqChunk == NULL)
+			return;
+
+		fastqPool->Release(fastqChunk);
+		fastqChunk = NULL;
+		partsInFlight--;
+	}
+
+	bool NextChunk(DsrcFileReader& dsrcReader_)
+	{
+		ReleaseChunk();
+		SubmitChunks(dsrcReader_);
+
+		if (partsInFlight == 0)
+			return false;
+
+		int64 partId = 0;
+		if (!fastqQueue->Pop(partId, fastqChunk))
+			return false;
+
+		ASSERT(partId == nextPartId);
+		nextPartId++;
+		chunkPos = 0;
+
+		// a corrupt block, reported as by the single-threaded reader
+		if (errorHandler->IsError())
+		{
+			ReleaseChunk();
+			throw DsrcException(errorHandler->GetError());
+		}
+		return true;
+	}
+
+	// waits for the blocks in flight and discards them
+	void Drain()
+	{
+		ReleaseChunk();
+
+		while (partsInFlight > 0)
+		{
+			int64 partId = 0;
+			fq::FastqDataChunk* part = NULL;
+			if (!fastqQueue->Pop(partId, part))
+				break;
+			fastqPool->Release(part);
+			nextPartId++;
+			partsInFlight--;
+		}
+	}
+};
+
+
 // DSRC archive records writer/reader implementation
 //
 struct DsrcArchiveRecordsWriter::RecordsWriterImpl
 {
 	RecordsBlockCompressor* recordsCompressor;
 	fq::FastqDataChunk* fastqChunk;
+	RecordsWriterMT parallelWriter;		// used when compressing with more than 1 thread
 
 	bool fastqHasPlusRepetition;		// used when parsing
 
@@ -361,12 +880,32 @@ struct DsrcArchiveRecordsWriter::RecordsWriterImpl
 
 	void FlushChunk(DsrcFileWriter& dsrcWriter_, DsrcDataChunk& dsrcChunk_)
 	{
+		dsrcChunk_.recordsCount = recordsCompressor->ChunkRecordsCount();
+		dsrcChunk_.rawSize = recordsCompressor->RawChunkSize();
+
 		core::BitMemoryWriter mem(dsrcChunk_.data);
 		recordsCompressor->Flush(mem);
 		mem.Flush();
 		dsrcChunk_.size = mem.Position();
 		dsrcWriter_.WriteNextChunk(&dsrcChunk_);
 	}
+
+	// in the multithreaded mode the analysis is performed on the text of the first FASTQ chunk
+	bool AnalyzeParallelChunk(ArchiveWriterImpl& archive_)
+	{
+		FastqDatasetType dsType;
+		dsType.qualityOffset = archive_.fastqQualityOffset;
+		if (!parallelWriter.AnalyzeChunk(dsType))
+		{
+			archive_.AddError("problem analyzing FASTQ dataset type");
+			return false;
+		}
+		dsType.plusRepetition = fastqHasPlusRepetition;
+
+		archive_.isDatasetTypeKnown = true;
+		archive_.SetFastqDatasetType(dsType);
+		return true;
+	}
 };
 
 
@@ -374,10 +913,13 @@ struct DsrcArchiveRecordsReader::RecordsReaderImpl
 {
 	RecordsBlockCompressor* recordsCompressor;
 	fq::FastqDataChunk* fastqChunk;
+	RecordsReaderMT parallelReader;		// used when decompressing with more than 1 thread
+	uint32 fieldsMask;
 
 	RecordsReaderImpl()
 		:	recordsCompressor(NULL)
 		,	fastqChunk(NULL)
+		,	fieldsMask(FastqFields::All)
 	{}
 
 	~RecordsReaderImpl()
@@ -407,6 +949,32 @@ struct DsrcArchiveRecordsReader::RecordsReaderImpl
 		recordsCompressor->Feed(mem);
 		return true;
 	}
+
+	void SeekToRecord(DsrcFileReader& dsrcReader_, DsrcDataChunk& dsrcChunk_, uint64 recordId_)
+	{
+		ASSERT(dsrcReader_.HasRecordsIndex());
+		ASSERT(recordId_ <= dsrcReader_.RecordsCount());
+
+		if (recordId_ == dsrcReader_.RecordsCount())
+		{
+			dsrcReader_.SeekToBlock(dsrcReader_.BlockCount());
+			recordsCompressor->Reset();
+			return;
+		}
+
+		const uint64 blockId = dsrcReader_.FindBlockByRecord(recordId_);
+		const DsrcBlockInfo& info = dsrcReader_.GetBlockInfo(blockId);
+
+		// decompress the block only if it's not the one already decompressed
+		if (dsrcReader_.CurrentBlockId() != blockId + 1 || recordsCompressor->ChunkRecordsCount() == 0)
+		{
+			dsrcReader_.SeekToBlock(blockId);
+			FeedChunk(dsrcReader_, dsrcChunk_);
+		}
+
+		ASSERT(recordsCompressor->ChunkRecordsCount() == info.recordsCount);
+		recordsCompressor->SkipToRecord(recordId_ - info.firstRecord);
+	}
 };
 
 
@@ -424,13 +992,16 @@ DsrcArchiveRecordsWriter::~DsrcArchiveRecordsWriter()
 
 bool DsrcArchiveRecordsWriter::StartCompress(const std::string &filename_,
 											 const DsrcCompressionSettings &compressionSettings_,
-											 uint32 /*threadsNum_*/,
+											 uint32 threadsNum_,
 											 uint32 qualityOffset_)
 {
 	if (!archiveImpl->StartCompress(filename_, compressionSettings_, qualityOffset_))
 		return false;
 
-	writerImpl->CreateCompressorContext(*archiveImpl->compressor, compressionSettings_.fastqBufferSizeMb);
+	if (threadsNum_ > 1)
+		writerImpl->parallelWriter.Start(threadsNum_, compressionSettings_.fastqBufferSizeMb, compressionSettings_.calculateCrc32);
+	else
+		writerImpl->CreateCompressorContext(*archiveImpl->compressor, compressionSettings_.fastqBufferSizeMb);
 
 	// variables used when analysing FASTQ records
 	writerImpl->fastqHasPlusRepetition = false;
@@ -461,6 +1032,21 @@ bool DsrcArchiveRecordsWriter::WriteNextRecord(const FastqRecord& rec_)
 		}
 	}
 
+	if (writerImpl->parallelWriter.IsStarted())
+	{
+		RecordsWriterMT& writer = writerImpl->parallelWriter;
+
+		if (writer.ChunkSize() > 0 && writer.ChunkSize() + approxRecordSize > (uint64)archiveImpl->compSettings.fastqBufferSizeMb << 20)
+		{
+			if (!archiveImpl->isDatasetTypeKnown && !writerImpl->AnalyzeParallelChunk(*archiveImpl))
+				return false;
+
+			writer.PushChunk(*archiveImpl->dsrcWriter, archiveImpl->datasetType, archiveImpl->compSettings);
+		}
+
+		writer.AppendRecord(rec_);
+		return true;
+	}
 
 	// do we have all the data to compresss the next block?
 	if (writerImpl->recordsCompressor->RawChunkSize() + approxRecordSize > (uint64)archiveImpl->compSettings.fastqBufferSizeMb << 20)
@@ -493,6 +1079,20 @@ bool DsrcArchiveRecordsWriter::WriteNextRecord(const FastqRecord& rec_)
 
 void DsrcArchiveRecordsWriter::FinishCompress()
 {
+	if (writerImpl->parallelWriter.IsStarted())
+	{
+		RecordsWriterMT& writer = writerImpl->parallelWriter;
+
+		if (writer.ChunkSize() > 0 && (archiveImpl->isDatasetTypeKnown || writerImpl->AnalyzeParallelChunk(*archiveImpl)))
+			writer.PushChunk(*archiveImpl->dsrcWriter, archiveImpl->datasetType, archiveImpl->compSettings);
+
+		if (!writer.Finish())
+			archiveImpl->AddError(writer.GetError());
+
+		archiveImpl->FinishCompress();
+		return;
+	}
+
 	if (writerImpl->recordsCompressor->RawChunkSize() > 0)
 	{
 		// handle the case of only one block-archive
@@ -537,23 +1137,103 @@ DsrcArchiveRecordsReader::~DsrcArchiveRecordsReader()
 }
 
 bool DsrcArchiveRecordsReader::StartDecompress(const std::string &filename_,
-											   uint32 /*threadsNum_*/)
+											   uint32 threadsNum_)
 {
+	readerImpl->parallelReader.Finish();
+
 	if (!archiveImpl->StartDecompress(filename_))
 		return false;
 
+	if (threadsNum_ > 1)
+	{
+		readerImpl->parallelReader.Start(*archiveImpl->dsrcReader, threadsNum_, readerImpl->fieldsMask);
+		return true;
+	}
+
 	readerImpl->CreateCompressorContext(*archiveImpl->compressor, archiveImpl->compSettings.fastqBufferSizeMb);
+	archiveImpl->compressor->SetFieldsMask(readerImpl->fieldsMask);
 
 	return true;
 }
 
+bool DsrcArchiveRecordsReader::SetFieldsMask(uint32 fieldsMask_)
+{
+	if (fieldsMask_ == 0 || (fieldsMask_ & ~FastqFields::All) != 0)
+	{
+		archiveImpl->AddError("invalid record fields mask");
+		return false;
+	}
+
+	readerImpl->fieldsMask = fieldsMask_;
+	if (archiveImpl->compressor != NULL)
+		archiveImpl->compressor->SetFieldsMask(fieldsMask_);
+	return true;
+}
+
 void DsrcArchiveRecordsReader::FinishDecompress()
 {
+	readerImpl->parallelReader.Finish();
 	archiveImpl->FinishDecompress();
 }
 
+bool DsrcArchiveRecordsReader::SeekToRecord(uint64 recordId_)
+{
+	DsrcFileReader* dsrcReader = archiveImpl->dsrcReader;
+	if (dsrcReader == NULL)
+		return false;
+
+	if (!dsrcReader->HasRecordsIndex())
+	{
+		archiveImpl->AddError("archive does not store the records index (created with DSRC prior v3.0)");
+		return false;
+	}
+
+	if (recordId_ > dsrcReader->RecordsCount())
+	{
+		archiveImpl->AddError("record number exceeds the number of records in archive");
+		return false;
+	}
+
+	if (readerImpl->parallelReader.IsStarted())
+	{
+		const uint64 blockId = (recordId_ < dsrcReader->RecordsCount()) ? dsrcReader->FindBlockByRecord(recordId_)
+																		: dsrcReader->BlockCount();
+		const uint64 firstRecord = (blockId < dsrcReader->BlockCount()) ? dsrcReader->GetBlockInfo(blockId).firstRecord
+																		: recordId_;
+		readerImpl->parallelReader.SeekToRecord(*dsrcReader, blockId, recordId_ - firstRecord);
+		return true;
+	}
+
+	readerImpl->SeekToRecord(*dsrcReader, *archiveImpl->dsrcChunk, recordId_);
+	return true;
+}
+
+bool DsrcArchiveRecordsReader::ReadRange(uint64 firstRecord_, uint64 recordsCount_, std::vector<FastqRecord>& records_)
+{
+	records_.clear();
+
+	if (!SeekToRecord(firstRecord_))
+		return false;
+
+	records_.resize(MIN(recordsCount_, archiveImpl->dsrcReader->RecordsCount() - firstRecord_));
+
+	for (std::vector<FastqRecord>::iterator i = records_.begin(); i != records_.end(); ++i)
+	{
+		if (!ReadNextRecord(*i))
+		{
+			archiveImpl->AddError("corrupted DSRC archive records index");
+			records_.clear();
+			return false;
+		}
+	}
+	return true;
+}
+
 bool DsrcArchiveRecordsReader::ReadNextRecord(FastqRecord& rec_)
 {
+	if (readerImpl->parallelReader.IsStarted())
+		return readerImpl->parallelReader.ReadNextRecord(*archiveImpl->dsrcReader, rec_);
+
 	if (!readerImpl->recordsCompressor->ReadNextRecord(rec_))
 	{
 		if (!readerImpl->FeedChunk(*archiveImpl->dsrcReader, *archiveImpl->dsrcChunk))
@@ -568,8 +1248,6 @@ bool DsrcArchiveRecordsReader::ReadNextRecord(FastqRecord& rec_)
 //
 struct DsrcArchiveBlocksWriterST::BlockWriterImpl
 {
-	fq::StreamsInfo rawStreamInfo;
-	fq::StreamsInfo compStreamInfo;
 	fq::FastqDataChunk* fastqChunk;
 
 	BlockWriterImpl()
@@ -684,10 +1362,7 @@ unsigned long DsrcArchiveBlocksWriterST::WriteNextBlock(const char* buffer_, uns
 
 	// compress the FASTQ block
 	core::BitMemoryWriter mem(archiveImpl->dsrcChunk->data);
-	archiveImpl->compressor->Store(mem,
-								   writerImpl->rawStreamInfo,
-								   writerImpl->compStreamInfo,
-								   *writerImpl->fastqChunk);
+	archiveImpl->compressor->Store(mem, *archiveImpl->dsrcChunk, *writerImpl->fastqChunk);
 	const uint64 compSize = mem.Position();
 
 	archiveImpl->dsrcChunk->size = compSize;
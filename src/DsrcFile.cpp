@@ -10,8 +10,11 @@
 #include "DsrcFile.h"
 #include "DsrcIo.h"
 #include "BitMemory.h"
+#include "ModelDictionary.h"
 
 #include <cstring>
+#include <sstream>
+#include <iomanip>
 
 namespace dsrc
 {
@@ -24,6 +27,7 @@ using namespace core;
 DsrcFileWriter::DsrcFileWriter()
 	:	fileStream(NULL)
 	,	currentBlockId(0)
+	,	currentRecordId(0)
 {		
 	std::fill((uchar*)&fileHeader, (uchar*)&fileHeader + sizeof(DsrcFileHeader), 0);
 	fileFooter.dummyByte = 0;
@@ -46,6 +50,7 @@ void DsrcFileWriter::StartCompress(const std::string& fileName_)
 	std::fill((uchar*)&fileHeader, (uchar*)&fileHeader + sizeof(DsrcFileHeader), 0);
 
 	fileFooter.blockSizes.clear();
+	fileFooter.blockInfo.clear();
 	fileFooter.dummyByte = 0;
 
 
@@ -54,15 +59,24 @@ void DsrcFileWriter::StartCompress(const std::string& fileName_)
 	fileStream->SetPosition(DsrcFileHeader::HeaderSize);
 
 	currentBlockId = 0;
+	currentRecordId = 0;
 }
 
 void DsrcFileWriter::WriteNextChunk(const DsrcDataChunk* block_)
 {
 	ASSERT(block_ != NULL);
 	ASSERT(block_->size > 0);
+	ASSERT(block_->recordsCount > 0);
+
+	DsrcBlockInfo info;
+	info.fileOffset = fileStream->Position();
+	info.recordsCount = block_->recordsCount;
+	info.firstRecord = currentRecordId;
+	info.rawSize = block_->rawSize;
 
 	fileStream->Write(block_->data.Pointer(), block_->size);
 	fileFooter.blockSizes.push_back(block_->size);
+	fileFooter.blockInfo.push_back(info);
 
 	for (uint32 i = 0; i < fq::StreamsInfo::StreamCount; ++i)
 	{
@@ -70,6 +84,7 @@ void DsrcFileWriter::WriteNextChunk(const DsrcDataChunk* block_)
 		dsrcStreamInfo.sizes[i] += block_->compStreamsInfo.sizes[i];
 	}
 	currentBlockId++;
+	currentRecordId += block_->recordsCount;
 }
 
 void DsrcFileWriter::FinishCompress()
@@ -85,7 +100,7 @@ void DsrcFileWriter::FinishCompress()
 	fileHeader.versionRev = DsrcFileHeader::VersionRev;
 	std::fill(fileHeader.reserved, fileHeader.reserved + DsrcFileHeader::ReservedBytes, +DsrcFileHeader::DummyByteValue);
 	fileHeader.blockCount = fileFooter.blockSizes.size();
-	fileHeader.recordsCount = 0; //! TODO!!!
+	fileHeader.recordsCount = currentRecordId;
 	fileHeader.footerOffset = fileStream->Position();
 
 	// write footer
@@ -134,7 +149,8 @@ void DsrcFileWriter::WriteFileFooter()
 {	
 	// store data
 	//
-	BitMemoryWriter writer(fileFooter.blockSizes.size() * 4 + DsrcFileFooter::DatasetTypeSize + DsrcFileFooter::CompressionSettingsSize);
+	BitMemoryWriter writer(fileFooter.blockSizes.size() * (4 + DsrcFileFooter::BlockInfoSize)
+						   + DsrcFileFooter::DatasetTypeSize + DsrcFileFooter::CompressionSettingsSize);
 	writer.PutByte(fileFooter.dummyByte);
 
 	// store blocks
@@ -159,12 +175,41 @@ void DsrcFileWriter::WriteFileFooter()
 		flags |= DsrcFileFooter::FLAG_LOSSY_QUALITY;
 	if (fileFooter.compSettings.calculateCrc32)
 		flags |= DsrcFileFooter::FLAG_CALCULATE_CRC32;
+	if (fileFooter.compSettings.HasModelChains())
+		flags |= DsrcFileFooter::FLAG_MODEL_CHAINS;
+	if (fileFooter.compSettings.modelDictionary != NULL)
+		flags |= DsrcFileFooter::FLAG_MODEL_DICTIONARY;
+	if (fileFooter.compSettings.dnaMixingLevel > 0)
+		flags |= DsrcFileFooter::FLAG_DNA_MIXING;
 	writer.PutByte(flags);
 	writer.PutByte(fileFooter.compSettings.dnaOrder);
 	writer.PutByte(fileFooter.compSettings.qualityOrder);
 	writer.PutDWord(fileFooter.compSettings.tagPreserveFlags);
 	writer.Put2Bytes(fileFooter.compSettings.fastqBufferSizeMb);
 
+	// the keyframes of the chained blocks, needed for the random access
+	if (fileFooter.compSettings.HasModelChains())
+	{
+		writer.Put2Bytes(fileFooter.compSettings.modelChainLength);
+		writer.Put2Bytes(fileFooter.compSettings.modelChainCount);
+	}
+
+	if (fileFooter.compSettings.modelDictionary != NULL)
+		writer.PutWord(fileFooter.compSettings.modelDictionary->Hash());
+
+	if (fileFooter.compSettings.dnaMixingLevel > 0)
+		writer.PutByte(fileFooter.compSettings.dnaMixingLevel);
+
+	// store blocks index
+	//
+	for (std::vector<DsrcBlockInfo>::const_iterator i = fileFooter.blockInfo.begin(); i != fileFooter.blockInfo.end(); ++i)
+	{
+		writer.PutDWord(i->fileOffset);
+		writer.PutDWord(i->recordsCount);
+		writer.PutDWord(i->firstRecord);
+		writer.PutDWord(i->rawSize);
+	}
+
 	// flush
 	//
 	fileStream->Write(writer.Pointer(), writer.Position());
@@ -184,11 +229,12 @@ DsrcFileReader::~DsrcFileReader()
 		delete fileStream;
 }
 
-void DsrcFileReader::StartDecompress(const std::string& fileName_)
+void DsrcFileReader::StartDecompress(const std::string& fileName_, const ModelDictionary* dictionary_)
 {
 	ASSERT(fileStream == NULL);
 
 	fileStream = new FileStreamReaderExt(fileName_);
+	fileFooter.usesModelDictionary = false;
 
 	if (fileStream->Size() == 0)
 	{
@@ -202,17 +248,25 @@ void DsrcFileReader::StartDecompress(const std::string& fileName_)
 	std::fill((uchar*)&fileHeader, (uchar*)&fileHeader + sizeof(DsrcFileHeader), 0);
 	ReadFileHeader();
 
-	// Check version compatibility
-	if (fileHeader.versionMajor != DsrcFileHeader::VersionMajor)
+	// Check version compatibility, v2.0 and v2.1 archives are still read
+	if (fileHeader.versionMajor < DsrcFileHeader::LegacyVersionMajor)
 	{
-		//! TODO: add old file version checking
 		delete fileStream;
 		fileStream = NULL;
 
-		if (fileHeader.versionMajor < DsrcFileHeader::VersionMajor)
-			throw DsrcException("Invalid or old unsupported DSRC archive");
-		else
-			throw DsrcException("Invalid archive or using outdated DSRC application");
+		throw DsrcException("Invalid or old unsupported DSRC archive");
+	}
+
+	// newer versions can use features not known here
+	const bool newerVersion = fileHeader.IsLegacy()
+			? fileHeader.versionMinor > DsrcFileHeader::LegacyVersionMinor
+			: fileHeader.versionMajor > DsrcFileHeader::VersionMajor || fileHeader.versionMinor > DsrcFileHeader::VersionMinor;
+	if (newerVersion)
+	{
+		delete fileStream;
+		fileStream = NULL;
+
+		throw DsrcException("Invalid archive or using outdated DSRC application");
 	}
 
 	if ((fileHeader.blockCount == 0ULL) || fileHeader.footerOffset + (uint64)fileHeader.footerSize > fileStream->Size())
@@ -227,9 +281,22 @@ void DsrcFileReader::StartDecompress(const std::string& fileName_)
 	//
 	fileFooter.blockSizes.clear();
 	fileFooter.blockSizes.resize(fileHeader.blockCount, 0);
+	fileFooter.blockInfo.clear();
+	fileFooter.blockInfo.resize(fileHeader.blockCount);
 
 	fileStream->SetPosition(fileHeader.footerOffset);
-	ReadFileFooter();
+	try
+	{
+		ReadFileFooter();
+	}
+	catch (const DsrcException& )
+	{
+		// the footer fields are validated while read
+		delete fileStream;
+		fileStream = NULL;
+
+		throw;
+	}
 
 	if (fileFooter.dummyByte != DsrcFileFooter::DummyByteValue)
 	{
@@ -239,6 +306,22 @@ void DsrcFileReader::StartDecompress(const std::string& fileName_)
 		throw DsrcException("Corrupted DSRC archive footer");
 	}
 
+	// the blocks start from the models of the dictionary
+	if (fileFooter.usesModelDictionary && (dictionary_ == NULL || dictionary_->Hash() != fileFooter.modelDictionaryHash))
+	{
+		delete fileStream;
+		fileStream = NULL;
+
+		std::ostringstream ss;
+		if (dictionary_ == NULL)
+			ss << "Archive compressed with a model dictionary (hash ";
+		else
+			ss << "Model dictionary does not match the archive (expected hash ";
+		ss << std::hex << std::uppercase << std::setw(8) << std::setfill('0') << fileFooter.modelDictionaryHash << ")";
+		throw DsrcException(ss.str());
+	}
+	fileFooter.compSettings.modelDictionary = fileFooter.usesModelDictionary ? dictionary_ : NULL;
+
 	fileStream->SetPosition(DsrcFileHeader::HeaderSize);
 
 	currentBlockId = 0;
@@ -265,6 +348,44 @@ bool DsrcFileReader::ReadNextChunk(DsrcDataChunk* block_)
 	return true;
 }
 
+void DsrcFileReader::SeekToBlock(uint64 blockId_)
+{
+	ASSERT(fileStream != NULL);
+
+	if (blockId_ > fileHeader.blockCount)
+	{
+		throw DsrcException("Block index exceeds the number of blocks");
+	}
+
+	// seeking just past the last block sets the reader at the end of data
+	if (blockId_ == fileHeader.blockCount)
+		fileStream->SetPosition(fileHeader.footerOffset);
+	else
+		fileStream->SetPosition(fileFooter.blockInfo[blockId_].fileOffset);
+
+	currentBlockId = blockId_;
+}
+
+uint64 DsrcFileReader::FindBlockByRecord(uint64 recordId_) const
+{
+	ASSERT(HasRecordsIndex());
+	ASSERT(recordId_ < fileHeader.recordsCount);
+
+	// find the last block starting not after the record
+	uint64 lo = 0;
+	uint64 hi = fileHeader.blockCount;
+	while (hi - lo > 1)
+	{
+		const uint64 mid = (lo + hi) / 2;
+		if (fileFooter.blockInfo[mid].firstRecord <= recordId_)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
 void DsrcFileReader::FinishDecompress()
 {
 	fileStream->Close();
@@ -324,8 +445,12 @@ void DsrcFileReader::ReadFileFooter()
 	fileFooter.compSettings.qualityOrder = reader.GetByte();
 	fileFooter.compSettings.tagPreserveFlags = reader.GetDWord();
 
+	if (fileFooter.compSettings.dnaOrder > CompressionSettings::MaxDnaOrder
+			|| fileFooter.compSettings.qualityOrder > CompressionSettings::MaxQualityOrder)
+		throw DsrcException("Corrupted DSRC archive footer");
+
 	// features supported from versions prior
-	if (fileHeader.versionMinor >= 1)
+	if (!fileHeader.IsLegacy() || fileHeader.versionMinor >= 1)
 	{
 		fileFooter.compSettings.fastqBufferSizeMb = reader.Get2Bytes();
 	}
@@ -333,6 +458,54 @@ void DsrcFileReader::ReadFileFooter()
 	{
 		fileFooter.compSettings.fastqBufferSizeMb = CompressionSettings::MinFastqBufferSizeMb;
 	}
+
+	fileFooter.compSettings.modelChainLength = 0;
+	fileFooter.compSettings.modelChainCount = 1;
+	if ((flags & DsrcFileFooter::FLAG_MODEL_CHAINS) != 0)
+	{
+		fileFooter.compSettings.modelChainLength = reader.Get2Bytes();
+		fileFooter.compSettings.modelChainCount = reader.Get2Bytes();
+
+		if (!fileFooter.compSettings.HasModelChains() || fileFooter.compSettings.modelChainCount < DsrcCompressionSettings::MinModelChainCount
+				|| fileFooter.compSettings.modelChainCount > DsrcCompressionSettings::MaxModelChainCount)
+			throw DsrcException("Corrupted DSRC archive footer");
+	}
+
+	fileFooter.usesModelDictionary = (flags & DsrcFileFooter::FLAG_MODEL_DICTIONARY) != 0;
+	fileFooter.modelDictionaryHash = fileFooter.usesModelDictionary ? reader.GetWord() : 0;
+
+	fileFooter.compSettings.dnaMixingLevel = 0;
+	if ((flags & DsrcFileFooter::FLAG_DNA_MIXING) != 0)
+	{
+		fileFooter.compSettings.dnaMixingLevel = reader.GetByte();
+
+		if (fileFooter.compSettings.dnaMixingLevel == 0
+				|| fileFooter.compSettings.dnaMixingLevel > CompressionSettings::MaxDnaMixingLevel
+				|| fileFooter.compSettings.dnaOrder == 0)
+			throw DsrcException("Corrupted DSRC archive footer");
+	}
+
+	// read blocks index
+	//
+	if (HasRecordsIndex())
+	{
+		for (std::vector<DsrcBlockInfo>::iterator i = fileFooter.blockInfo.begin(); i != fileFooter.blockInfo.end(); ++i)
+		{
+			i->fileOffset = reader.GetDWord();
+			i->recordsCount = reader.GetDWord();
+			i->firstRecord = reader.GetDWord();
+			i->rawSize = reader.GetDWord();
+		}
+	}
+	else
+	{
+		uint64 offset = DsrcFileHeader::HeaderSize;
+		for (uint64 i = 0; i < fileHeader.blockCount; ++i)
+		{
+			fileFooter.blockInfo[i].fileOffset = offset;
+			offset += fileFooter.blockSizes[i];
+		}
+	}
 }
 
 } // namespace comp
@@ -29,10 +29,14 @@ struct DsrcFileHeader
 	static const uint32	ReservedBytes			= 8;
 	static const uint32 HeaderSize				= 4 + ReservedBytes + 3*8 + 4;
 
-	static const uint32 VersionMajor = 2;
-	static const uint32 VersionMinor = 1;
+	static const uint32 VersionMajor = 3;
+	static const uint32 VersionMinor = 0;		// v3.0: blocks index and streams offsets, not readable by v2.1
 	static const uint32 VersionRev = 0;
 
+	// v2.0 and v2.1 archives are still read
+	static const uint32 LegacyVersionMajor = 2;
+	static const uint32 LegacyVersionMinor = 1;
+
 	uchar	dummyByte;
 	uchar	versionMajor;
 	uchar	versionMinor;
@@ -44,19 +48,43 @@ struct DsrcFileHeader
 	uint64	blockCount;
 
 	uchar	reserved[ReservedBytes];
+
+	bool IsLegacy() const
+	{
+		return versionMajor == LegacyVersionMajor;
+	}
+};
+
+struct DsrcBlockInfo
+{
+	uint64 fileOffset;
+	uint64 recordsCount;		// 0 when unknown (archives prior v3.0)
+	uint64 firstRecord;
+	uint64 rawSize;
+
+	DsrcBlockInfo()
+		:	fileOffset(0)
+		,	recordsCount(0)
+		,	firstRecord(0)
+		,	rawSize(0)
+	{}
 };
 
 struct DsrcFileFooter
 {
 	static const uchar DummyByteValue			= 0xCC;
 	static const uint32 DatasetTypeSize			= 1 + 1;
-	static const uint32 CompressionSettingsSize = 1 + 1 + 1 + 8 + 2;
+	static const uint32 CompressionSettingsSize = 1 + 1 + 1 + 8 + 2 + 2 + 2 + 4 + 1;
+	static const uint32 BlockInfoSize			= 4*8;
 
 	uchar dummyByte;
 
 	FastqDatasetType datasetType;
 	CompressionSettings compSettings;
 
+	bool usesModelDictionary;
+	uint32 modelDictionaryHash;
+
 	enum DatasetTypeFlags
 	{
 		FLAG_PLUS_REPETITION	= BIT(0),
@@ -66,10 +94,14 @@ struct DsrcFileFooter
 	enum CompressionFlags
 	{
 		FLAG_LOSSY_QUALITY		= BIT(0),
-		FLAG_CALCULATE_CRC32	= BIT(1)
+		FLAG_CALCULATE_CRC32	= BIT(1),
+		FLAG_MODEL_CHAINS		= BIT(2),		// followed by the chains length and count
+		FLAG_MODEL_DICTIONARY	= BIT(3),		// followed by the dictionary hash
+		FLAG_DNA_MIXING			= BIT(4)		// followed by the DNA mixing level
 	};
 
 	std::vector<uint32> blockSizes;
+	std::vector<DsrcBlockInfo> blockInfo;	// stored after the settings since v3.0
 
 	// TODO: serializer/deserializer
 };
@@ -82,6 +114,7 @@ class DsrcFileWriter
 	DsrcFileFooter fileFooter;
 
 	uint64 currentBlockId;
+	uint64 currentRecordId;
 
 	fq::StreamsInfo fastqStreamInfo;
 	fq::StreamsInfo dsrcStreamInfo;
@@ -134,7 +167,8 @@ public:
 	DsrcFileReader();
 	~DsrcFileReader();
 
-	void StartDecompress(const std::string& fileName_);
+	// the dictionary needs to be the one the archive was compressed with, if any
+	void StartDecompress(const std::string& fileName_, const ModelDictionary* dictionary_ = NULL);
 
 	const FastqDatasetType& GetDatasetType() const
 	{
@@ -146,13 +180,46 @@ public:
 		return fileFooter.compSettings;
 	}
 
+	// set as soon as the footer is read, also when the dictionary is rejected
+	bool UsesModelDictionary() const
+	{
+		return fileFooter.usesModelDictionary;
+	}
+
 	bool ReadNextChunk(DsrcDataChunk* block_);
+	void SeekToBlock(uint64 blockId_);
 	void FinishDecompress();
 
 	uint64 BlockCount() const
 	{
 		return fileHeader.blockCount;
 	}
+
+	// id of the block to be read next
+	uint64 CurrentBlockId() const
+	{
+		return currentBlockId;
+	}
+
+	// archives prior v3.0 do not store the records count nor the per-block
+	// records info -- only the block file offsets are available then
+	bool HasRecordsIndex() const
+	{
+		return !fileHeader.IsLegacy();
+	}
+
+	uint64 RecordsCount() const
+	{
+		return fileHeader.recordsCount;
+	}
+
+	const DsrcBlockInfo& GetBlockInfo(uint64 blockId_) const
+	{
+		ASSERT(blockId_ < fileHeader.blockCount);
+		return fileFooter.blockInfo[blockId_];
+	}
+
+	uint64 FindBlockByRecord(uint64 recordId_) const;
 };
 
 } // namespace comp
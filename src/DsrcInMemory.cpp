@@ -26,8 +26,16 @@ namespace dsrc{
         reader->StartDecompress(dsrcFilename_);
         dsrcChunk = new comp::DsrcDataChunk(comp::DsrcDataChunk::DefaultBufferSize);
         fastqChunk = new fq::FastqDataChunk(fq::FastqDataChunk::DefaultBufferSize);
+        chains = new comp::BlockCompressorChains(
+          reader->GetDatasetType(),
+          reader->GetCompressionSettings()
+        );
       } catch (const DsrcException& e_) {
-        AddError(e_.what());
+        // the dictionary file is not known here, only DsrcModule loads it
+        if (reader->UsesModelDictionary())
+          AddError("archive with a model dictionary is not supported, use DsrcModule");
+        else
+          AddError(e_.what());
       }
     }
 
@@ -38,14 +46,18 @@ namespace dsrc{
      */
     DsrcInMemory::~DsrcInMemory() {
       try {
-        dsrcChunk->Reset();
-        fastqChunk->Reset();
-        reader->FinishDecompress();
+        // nothing to finish when the archive failed to open
+        if (chains != NULL) {
+          dsrcChunk->Reset();
+          fastqChunk->Reset();
+          reader->FinishDecompress();
+        }
       } catch (const DsrcException& e_) {
         AddError(e_.what());
       }
       delete dsrcChunk;
       delete fastqChunk;
+      delete chains;
       delete reader;
     }
 
@@ -57,16 +69,14 @@ namespace dsrc{
      * content of the input file
      */
     std::string DsrcInMemory::getNextChunk(){
-      comp::BlockCompressor superblock(
-        reader->GetDatasetType(),
-        reader->GetCompressionSettings()
-      );
       if (reader->ReadNextChunk(dsrcChunk)) {
         core::BitMemoryReader bitMemory(
           dsrcChunk->data.Pointer(),
           dsrcChunk->size
         );
-        superblock.Read(bitMemory, *fastqChunk);
+        // the blocks are decoded in order, following the model chains
+        chains->Acquire(blockId).Read(bitMemory, *fastqChunk);
+        chains->Release(blockId++);
         std::string chunkContents = std::string(
           reinterpret_cast<char const*>(fastqChunk->data.Pointer()),
           fastqChunk->size
@@ -19,73 +19,18 @@ namespace comp
 void DsrcWriter::operator()()
 {
 	int64 partId = 0;
-	int64 lastPartId = -1;
-
 	DsrcDataChunk* part = NULL;
-	std::map<int64, DsrcDataChunk*> partsQueue;
 
+	// the reorder queue returns the parts in order
 	while (!errorHandler.IsError() && dsrcQueue.Pop(partId, part))
 	{
 		ASSERT(part->size < (1 << 30));
 
-		if (partId != lastPartId + 1)
-		{
-			ASSERT(partsQueue.count(partId) == 0);
-			partsQueue.insert(std::make_pair(partId, part));
-			continue;
-		}
-
 		dsrcWriter.WriteNextChunk(part);
 
-		lastPartId++;
-
 		dsrcPool.Release(part);
 		part = NULL;
-
-		while (partsQueue.size() > 0)
-		{
-			partId = partsQueue.begin()->first;
-			if (partId == lastPartId + 1)
-			{
-				part = partsQueue.begin()->second;
-
-				dsrcWriter.WriteNextChunk(part);
-
-				lastPartId++;
-
-				dsrcPool.Release(part);
-				partsQueue.erase(partsQueue.begin());
-			}
-			else
-			{
-				break;
-			}
-		}
-
-		part = NULL;
-	}
-
-	while (!errorHandler.IsError() && partsQueue.size() > 0)
-	{
-		partId = partsQueue.begin()->first;
-		if (partId == lastPartId + 1)
-		{
-			part = partsQueue.begin()->second;
-
-			dsrcWriter.WriteNextChunk(part);
-
-			lastPartId++;
-
-			dsrcPool.Release(part);
-			partsQueue.erase(partsQueue.begin());
-		}
-		else
-		{
-			break;
-		}
 	}
-
-	ASSERT(errorHandler.IsError() || partsQueue.size() == 0);
 }
 
 void DsrcReader::operator()()
@@ -18,7 +18,6 @@
 #include "DsrcFile.h"
 
 #include <vector>
-#include <map>
 
 namespace dsrc
 {
@@ -31,8 +30,13 @@ struct DsrcDataChunk : public core::DataChunk
 	fq::StreamsInfo rawStreamsInfo;
 	fq::StreamsInfo compStreamsInfo;
 
+	uint64 recordsCount;
+	uint64 rawSize;			// size of the decompressed FASTQ block
+
 	DsrcDataChunk(uint64 bufferSize_ = core::DataChunk::DefaultBufferSize)
 		:	core::DataChunk(bufferSize_)
+		,	recordsCount(0)
+		,	rawSize(0)
 	{}
 
 	void Reset()
@@ -40,18 +44,20 @@ struct DsrcDataChunk : public core::DataChunk
 		core::DataChunk::Reset();
 		rawStreamsInfo.Clear();
 		compStreamsInfo.Clear();
+		recordsCount = 0;
+		rawSize = 0;
 	}
 };
 
 typedef core::TDataQueue<DsrcDataChunk> DsrcDataQueue;
+typedef core::TReorderQueue<DsrcDataChunk> DsrcDataReorderQueue;
 typedef core::TDataPool<DsrcDataChunk> DsrcDataPool;
 
 class IDsrcIoOperator
 {
 public:
-	IDsrcIoOperator(DsrcDataQueue& queue_, DsrcDataPool& pool_, core::ErrorHandler& errorHandler_)
-		:	dsrcQueue(queue_)
-		,	dsrcPool(pool_)
+	IDsrcIoOperator(DsrcDataPool& pool_, core::ErrorHandler& errorHandler_)
+		:	dsrcPool(pool_)
 		,	errorHandler(errorHandler_)
 	{}
 
@@ -60,18 +66,19 @@ public:
 	virtual void operator()() = 0;
 
 protected:
-	DsrcDataQueue& dsrcQueue;
 	DsrcDataPool& dsrcPool;
 	core::ErrorHandler& errorHandler;
 };
 
 class DsrcWriter : public IDsrcIoOperator
 {
+	DsrcDataReorderQueue& dsrcQueue;
 	DsrcFileWriter& dsrcWriter;
 
 public:
-	DsrcWriter(DsrcFileWriter& writer_, DsrcDataQueue& queue_, DsrcDataPool& pool_, core::ErrorHandler& errorHandler_)
-		:	IDsrcIoOperator(queue_, pool_, errorHandler_)
+	DsrcWriter(DsrcFileWriter& writer_, DsrcDataReorderQueue& queue_, DsrcDataPool& pool_, core::ErrorHandler& errorHandler_)
+		:	IDsrcIoOperator(pool_, errorHandler_)
+		,	dsrcQueue(queue_)
 		,	dsrcWriter(writer_)
 	{}
 
@@ -81,11 +88,13 @@ public:
 
 class DsrcReader : public IDsrcIoOperator
 {
+	DsrcDataQueue& dsrcQueue;
 	DsrcFileReader& dsrcReader;
 
 public:
 	DsrcReader(DsrcFileReader& reader_, DsrcDataQueue& queue_, DsrcDataPool& pool_, core::ErrorHandler& errorHandler_)
-		:	IDsrcIoOperator(queue_, pool_, errorHandler_)
+		:	IDsrcIoOperator(pool_, errorHandler_)
+		,	dsrcQueue(queue_)
 		,	dsrcReader(reader_)
 	{}
 
@@ -22,6 +22,7 @@ namespace th = std;
 #include "../include/dsrc/DsrcModule.h"
 
 #include "DsrcOperator.h"
+#include "ModelDictionary.h"
 
 
 namespace dsrc
@@ -68,11 +69,25 @@ bool DsrcModule::Compress(const std::string &inFastqFilename_,
 		AddError("no input FASTQ file specified");
 
 	if (compSettings_.dnaCompressionLevel > DsrcCompressionSettings::MaxDnaCompressionLevel)
-		AddError("invalid DNA compression mode specified [0-3]\n");
+		AddError("invalid DNA compression mode specified [0-5]\n");
 
 	if (compSettings_.qualityCompressionLevel > DsrcCompressionSettings::MaxQualityCompressionLevel)
 		AddError("invalid Quality compression mode specified [0-2]\n");
 
+	if (compSettings_.modelChainLength > DsrcCompressionSettings::MaxModelChainLength)
+		AddError("invalid model chain length specified\n");
+
+	if (compSettings_.modelChainLength > 1
+			&& (compSettings_.modelChainCount < DsrcCompressionSettings::MinModelChainCount
+				|| compSettings_.modelChainCount > DsrcCompressionSettings::MaxModelChainCount))
+		AddError("invalid model chains count specified [1-256]\n");
+
+	// the mixing level is used only by the DNA mode 5
+	if (compSettings_.dnaCompressionLevel == CompressionSettings::MixingDnaLevel
+			&& (compSettings_.dnaMixingLevel < DsrcCompressionSettings::MinDnaMixingLevel
+				|| compSettings_.dnaMixingLevel > DsrcCompressionSettings::MaxDnaMixingLevel))
+		AddError("invalid DNA mixing level specified [1-3]\n");
+
 	if ( !(compSettings_.fastqBufferSizeMb >= DsrcCompressionSettings::MinFastqBufferSizeMB
 		   && compSettings_.fastqBufferSizeMb <= DsrcCompressionSettings::MaxFastqBufferSizeMB) )
 	{
@@ -88,12 +103,28 @@ bool DsrcModule::Compress(const std::string &inFastqFilename_,
 	if (IsError())
 		return false;
 
+	ModelDictionary dictionary;
+	const ModelDictionary* dictionaryPtr = NULL;
+	if (compSettings_.modelDictionary.length() > 0)
+	{
+		if (!LoadModelDictionary(compSettings_.modelDictionary, dictionary))
+			return false;
+
+		if (!dictionary.Matches(CompressionSettings::ConvertFrom(compSettings_)))
+		{
+			AddError("model dictionary trained with other DNA or Quality compression modes");
+			return false;
+		}
+		dictionaryPtr = &dictionary;
+	}
+
 
 	// compress
 	//
 	if (threadsNum_ > 0)
 	{
 		DsrcCompressorMT dsrc;
+		dsrc.SetModelDictionary(dictionaryPtr);
 		if (!dsrc.Process(inFastqFilename_, outDsrcFilename_, compSettings_,
 						  threadsNum_, useFastqStdIo_, qualityOffset_))
 		{
@@ -106,6 +137,7 @@ bool DsrcModule::Compress(const std::string &inFastqFilename_,
 	else
 	{
 		DsrcCompressorST dsrc;
+		dsrc.SetModelDictionary(dictionaryPtr);
 		if (!dsrc.Process(inFastqFilename_, outDsrcFilename_, compSettings_,
 						  useFastqStdIo_, qualityOffset_))
 		{
@@ -121,7 +153,8 @@ bool DsrcModule::Compress(const std::string &inFastqFilename_,
 bool DsrcModule::Decompress(const std::string &inDsrcFilename_,
 							const std::string &outFastqFilename_,
 							uint32 threadsNum_,
-							bool useFastqStdIo_)
+							bool useFastqStdIo_,
+							uint32 fieldsMask_)
 {
 	if (IsError())
 		ClearError();
@@ -134,19 +167,33 @@ bool DsrcModule::Decompress(const std::string &inDsrcFilename_,
 	if (outFastqFilename_.length() == 0 && !useFastqStdIo_)
 		AddError("no input FASTQ file specified");
 
+	if (fieldsMask_ == 0 || (fieldsMask_ & ~FastqFields::All) != 0)
+		AddError("invalid record fields mask");
+
 	if (IsError())
 		return false;
 
+	ModelDictionary dictionary;
+	const ModelDictionary* dictionaryPtr = NULL;
+	if (modelDictionaryFilename.length() > 0)
+	{
+		if (!LoadModelDictionary(modelDictionaryFilename, dictionary))
+			return false;
+		dictionaryPtr = &dictionary;
+	}
+
 
 	// decompress
 	//
 	if (threadsNum_ > 0)
 	{
 		DsrcDecompressorMT dsrc;
+		dsrc.SetModelDictionary(dictionaryPtr);
 		if (!dsrc.Process(outFastqFilename_,
 						  inDsrcFilename_,
 						  threadsNum_,
-						  useFastqStdIo_))
+						  useFastqStdIo_,
+						  fieldsMask_))
 		{
 			SetError(dsrc.GetError());
 			return false;
@@ -157,9 +204,11 @@ bool DsrcModule::Decompress(const std::string &inDsrcFilename_,
 	else
 	{
 		DsrcDecompressorST dsrc;
+		dsrc.SetModelDictionary(dictionaryPtr);
 		if (!dsrc.Process(outFastqFilename_,
 						  inDsrcFilename_,
-						  useFastqStdIo_))
+						  useFastqStdIo_,
+						  fieldsMask_))
 		{
 			SetError(dsrc.GetError());
 			return false;
@@ -170,6 +219,182 @@ bool DsrcModule::Decompress(const std::string &inDsrcFilename_,
 	return true;
 }
 
+bool DsrcModule::Extract(const std::string &inDsrcFilename_,
+						 const std::string &outFastqFilename_,
+						 uint64 firstRecord_,
+						 uint64 recordsCount_,
+						 bool useFastqStdIo_)
+{
+	if (IsError())
+		ClearError();
+
+	// check input params
+	//
+	if (inDsrcFilename_.length() == 0)
+		AddError("no input DSRC file specified");
+
+	if (outFastqFilename_.length() == 0 && !useFastqStdIo_)
+		AddError("no output FASTQ file specified");
+
+	if (IsError())
+		return false;
+
+	ModelDictionary dictionary;
+	const ModelDictionary* dictionaryPtr = NULL;
+	if (modelDictionaryFilename.length() > 0)
+	{
+		if (!LoadModelDictionary(modelDictionaryFilename, dictionary))
+			return false;
+		dictionaryPtr = &dictionary;
+	}
+
+
+	// extract
+	//
+	DsrcExtractorST dsrc;
+	dsrc.SetModelDictionary(dictionaryPtr);
+	if (!dsrc.Process(outFastqFilename_,
+					  inDsrcFilename_,
+					  firstRecord_,
+					  recordsCount_,
+					  useFastqStdIo_))
+	{
+		SetError(dsrc.GetError());
+		return false;
+	}
+	if (dsrc.GetLog().length() > 0)
+		AddLog(dsrc.GetLog());
+
+	return true;
+}
+
+
+bool DsrcModule::Verify(const std::string &inDsrcFilename_,
+						uint32 threadsNum_)
+{
+	if (IsError())
+		ClearError();
+
+	if (inDsrcFilename_.length() == 0)
+	{
+		AddError("no input DSRC file specified");
+		return false;
+	}
+
+	ModelDictionary dictionary;
+	const ModelDictionary* dictionaryPtr = NULL;
+	if (modelDictionaryFilename.length() > 0)
+	{
+		if (!LoadModelDictionary(modelDictionaryFilename, dictionary))
+			return false;
+		dictionaryPtr = &dictionary;
+	}
+
+	if (threadsNum_ > 0)
+	{
+		DsrcVerifierMT dsrc;
+		dsrc.SetModelDictionary(dictionaryPtr);
+		if (!dsrc.Process(inDsrcFilename_, threadsNum_))
+		{
+			SetError(dsrc.GetError());
+			return false;
+		}
+		if (dsrc.GetLog().length() > 0)
+			AddLog(dsrc.GetLog());
+	}
+	else
+	{
+		DsrcVerifierST dsrc;
+		dsrc.SetModelDictionary(dictionaryPtr);
+		if (!dsrc.Process(inDsrcFilename_))
+		{
+			SetError(dsrc.GetError());
+			return false;
+		}
+		if (dsrc.GetLog().length() > 0)
+			AddLog(dsrc.GetLog());
+	}
+	return true;
+}
+
+bool DsrcModule::TrainDictionary(const std::string& inFastqFilename_,
+								 const std::string& outDictionaryFilename_,
+								 const DsrcCompressionSettings& compSettings_,
+								 uint32 qualityOffset_)
+{
+	if (IsError())
+		ClearError();
+
+	if (inFastqFilename_.length() == 0)
+		AddError("no input FASTQ file specified");
+
+	if (outDictionaryFilename_.length() == 0)
+		AddError("no output dictionary file specified");
+
+	if (compSettings_.dnaCompressionLevel > DsrcCompressionSettings::MaxDnaCompressionLevel)
+		AddError("invalid DNA compression mode specified [0-5]\n");
+
+	if (compSettings_.qualityCompressionLevel > DsrcCompressionSettings::MaxQualityCompressionLevel)
+		AddError("invalid Quality compression mode specified [0-2]\n");
+
+	// the mixing level is used only by the DNA mode 5
+	if (compSettings_.dnaCompressionLevel == CompressionSettings::MixingDnaLevel
+			&& (compSettings_.dnaMixingLevel < DsrcCompressionSettings::MinDnaMixingLevel
+				|| compSettings_.dnaMixingLevel > DsrcCompressionSettings::MaxDnaMixingLevel))
+		AddError("invalid DNA mixing level specified [1-3]\n");
+
+	// only the order-k models adapt, the ones of the lowest modes are static
+	// and the mixed ones are too large to be stored
+	if ((compSettings_.dnaCompressionLevel == 0 || compSettings_.dnaCompressionLevel == 5)
+			&& compSettings_.qualityCompressionLevel == 0)
+		AddError("model dictionaries need the DNA compression mode 1-4 or the Quality mode above 0");
+
+	if ( !(compSettings_.fastqBufferSizeMb >= DsrcCompressionSettings::MinFastqBufferSizeMB
+		   && compSettings_.fastqBufferSizeMb <= DsrcCompressionSettings::MaxFastqBufferSizeMB) )
+	{
+		AddError("invalid fastq buffer size specified [1-1024] \n");
+	}
+
+	if (qualityOffset_ != FastqDatasetType::AutoQualityOffsetSelect
+			&& !(qualityOffset_ >= 33 && qualityOffset_ <= 64) )
+	{
+		AddError("invalid Quality offset mode specified [33, 64]");
+	}
+
+	if (IsError())
+		return false;
+
+	DsrcDictionaryTrainerST trainer;
+	if (!trainer.Process(inFastqFilename_, outDictionaryFilename_, compSettings_, qualityOffset_))
+	{
+		SetError(trainer.GetError());
+		return false;
+	}
+	if (trainer.GetLog().length() > 0)
+		AddLog(trainer.GetLog());
+
+	return true;
+}
+
+void DsrcModule::SetModelDictionary(const std::string& dictionaryFilename_)
+{
+	modelDictionaryFilename = dictionaryFilename_;
+}
+
+bool DsrcModule::LoadModelDictionary(const std::string& filename_, ModelDictionary& dictionary_)
+{
+	try
+	{
+		dictionary_.Load(filename_);
+	}
+	catch (const DsrcException& e_)
+	{
+		AddError(e_.what());
+		return false;
+	}
+	return true;
+}
+
 
 // error handling
 //
@@ -16,6 +16,7 @@
 #include "DsrcWorker.h"
 #include "FastqParser.h"
 #include "BlockCompressor.h"
+#include "ModelDictionary.h"
 #include "utils.h"
 #include "ErrorHandler.h"
 
@@ -30,6 +31,8 @@ namespace th = std;
 
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
+#include <cstdio>
 
 namespace dsrc
 {
@@ -42,6 +45,30 @@ using namespace fq;
 
 const uint32 IDsrcOperator::AvailableHardwareThreadsNum = th::thread::hardware_concurrency();
 
+void IDsrcOperator::AddWriterStallsLog(uint64 stalls_, uint64 blocks_)
+{
+	std::ostringstream ss;
+	ss << "Writer stalls: " << stalls_ << " / " << blocks_ << " blocks";
+	AddLog(ss.str());
+}
+
+void IDsrcOperator::AddCorruptBlocksError(std::vector<int64>& blocks_, uint64 blocksCount_)
+{
+	std::ostringstream ss;
+	ss << "Verified blocks: " << blocksCount_;
+	AddLog(ss.str());
+
+	if (blocks_.empty())
+		return;
+
+	std::sort(blocks_.begin(), blocks_.end());
+
+	ss.str("");
+	ss << "CRC32 checksums mismatch in " << blocks_.size() << " / " << blocksCount_ << " blocks:";
+	for (uint64 i = 0; i < blocks_.size(); ++i)
+		ss << ' ' << blocks_[i];
+	AddError(ss.str());
+}
 
 bool DsrcCompressorST::Process(const std::string& fastqFilename_,
 							   const std::string& dsrcFilename_,
@@ -58,18 +85,20 @@ bool DsrcCompressorST::Process(const std::string& fastqFilename_,
 	//
 	DsrcDataChunk* dsrcChunk = NULL;
 	FastqDataChunk* fastqChunk = NULL;
+	FastqDataChunk* checkChunk = NULL;		// decoded by the CRC32 check, the input is kept intact
 	//
 	//
 
 	FastqDatasetType datasetType;
 	CompressionSettings settings = CompressionSettings::ConvertFrom(compSettings_);
+	settings.modelDictionary = modelDictionary;
 
 	try
 	{
 		if (useFastqStdIo_)
 			reader = new FastqStdIoReader();
 		else
-			reader = new FastqFileReader(fastqFilename_);
+			reader = CreateFastqFileReader(fastqFilename_, compSettings_.fastqBufferSizeMb << 20);
 
 		// join into constructor for RAII style
 		writer = new DsrcFileWriter();
@@ -105,29 +134,35 @@ bool DsrcCompressorST::Process(const std::string& fastqFilename_,
 	if (!IsError())
 	{
 		BitMemoryWriter bitMemory(dsrcChunk->data);
-		BlockCompressor superblock(datasetType, settings);
+		BlockCompressorChains chains(datasetType, settings);
+		uint64 blockId = 0;
 
 		do
 		{
-			superblock.Store(bitMemory, dsrcChunk->rawStreamsInfo, dsrcChunk->compStreamsInfo, *fastqChunk);
+			BlockCompressor& superblock = chains.Acquire(blockId);
+			superblock.Store(bitMemory, *dsrcChunk, *fastqChunk);
 
 			bitMemory.Flush();
 			dsrcChunk->size = bitMemory.Position();
 
 			writer->WriteNextChunk(dsrcChunk);
 
-			if (compSettings_.calculateCrc32)
+			if (compSettings_.calculateCrc32 && compSettings_.verifyCrc32)
 			{
 				BitMemoryReader reader(dsrcChunk->data.Pointer(), dsrcChunk->data.Size());
-				std::fill(fastqChunk->data.Pointer(), fastqChunk->data.Pointer() + fastqChunk->data.Size(), 0xCC);
+				if (checkChunk == NULL)
+					checkChunk = new FastqDataChunk(fastqChunk->data.Size());
+				checkChunk->Reset();
 
-				if (!superblock.VerifyChecksum(reader, *fastqChunk))
+				if (!chains.GetChecker(blockId).VerifyChecksum(reader, *checkChunk))
 				{
 					AddError("CRC32 checksums mismatch.");
 					break;
 				}
 			}
 
+			chains.Release(blockId++);
+
 			fastqChunk->Reset();
 			dsrcChunk->Reset();
 			bitMemory.Reset();
@@ -156,6 +191,7 @@ bool DsrcCompressorST::Process(const std::string& fastqFilename_,
 
 	// make reusable
 	//
+	TFree(checkChunk);
 	TFree(fastqChunk);
 	TFree(dsrcChunk);
 	//
@@ -169,7 +205,8 @@ bool DsrcCompressorST::Process(const std::string& fastqFilename_,
 
 bool DsrcDecompressorST::Process(const std::string& fastqFilename_,
 								 const std::string& dsrcFilename_,
-								 bool useFastqStdIo_)
+								 bool useFastqStdIo_,
+								 uint32 fieldsMask_)
 {
 	ASSERT(!IsError());
 
@@ -186,7 +223,7 @@ bool DsrcDecompressorST::Process(const std::string& fastqFilename_,
 	try
 	{
 		reader = new DsrcFileReader();
-		reader->StartDecompress(dsrcFilename_);
+		reader->StartDecompress(dsrcFilename_, modelDictionary);
 
 		if (useFastqStdIo_)
 			writer = new FastqStdIoWriter();
@@ -203,13 +240,16 @@ bool DsrcDecompressorST::Process(const std::string& fastqFilename_,
 
 	if (!IsError())
 	{
-		BlockCompressor superblock(reader->GetDatasetType(), reader->GetCompressionSettings());
+		BlockCompressorChains chains(reader->GetDatasetType(), reader->GetCompressionSettings());
+		chains.SetFieldsMask(fieldsMask_);
 
+		uint64 blockId = 0;
 		while (reader->ReadNextChunk(dsrcChunk))
 		{
 			BitMemoryReader bitMemory(dsrcChunk->data.Pointer(), dsrcChunk->size);
 
-			superblock.Read(bitMemory, *fastqChunk);
+			chains.Acquire(blockId).Read(bitMemory, *fastqChunk);
+			chains.Release(blockId++);
 
 			writer->WriteNextChunk(fastqChunk);
 
@@ -234,6 +274,297 @@ bool DsrcDecompressorST::Process(const std::string& fastqFilename_,
 	return !IsError();
 }
 
+bool DsrcExtractorST::Process(const std::string& fastqFilename_,
+							  const std::string& dsrcFilename_,
+							  uint64 firstRecord_,
+							  uint64 recordsCount_,
+							  bool useFastqStdIo_)
+{
+	ASSERT(!IsError());
+
+	DsrcFileReader* reader = NULL;
+	IFastqStreamWriter* writer = NULL;
+
+	DsrcDataChunk* dsrcChunk = NULL;
+	FastqDataChunk* fastqChunk = NULL;
+
+	bool outputCreated = false;
+
+	try
+	{
+		reader = new DsrcFileReader();
+		reader->StartDecompress(dsrcFilename_, modelDictionary);
+
+		if (!reader->HasRecordsIndex())
+		{
+			AddError("archive does not store the records index (created with DSRC prior v3.0)");
+		}
+		else if (firstRecord_ > reader->RecordsCount())
+		{
+			AddError("records range exceeds the number of records in archive");
+		}
+		else
+		{
+			if (useFastqStdIo_)
+			{
+				writer = new FastqStdIoWriter();
+			}
+			else
+			{
+				// an existing output, e.g. a device, is never removed
+				FILE* existing = fopen(fastqFilename_.c_str(), "rb");
+				if (existing != NULL)
+					fclose(existing);
+
+				writer = new FastqFileWriter(fastqFilename_);
+				outputCreated = existing == NULL;
+			}
+
+			dsrcChunk = new DsrcDataChunk(DsrcDataChunk::DefaultBufferSize);
+			fastqChunk = new FastqDataChunk(FastqDataChunk::DefaultBufferSize);
+		}
+	}
+	catch (const DsrcException& e_)
+	{
+		AddError(e_.what());
+	}
+
+	if (!IsError())
+	{
+		try
+		{
+			const CompressionSettings& settings = reader->GetCompressionSettings();
+
+			uint64 recordId = firstRecord_;
+			const uint64 lastRecord = firstRecord_ + MIN(recordsCount_, reader->RecordsCount() - firstRecord_);
+
+			// with the model chains, the decoding starts with the cleared models
+			// of the blocks preceding the range
+			const uint64 firstBlock = (recordId < lastRecord) ? reader->FindBlockByRecord(recordId) : 0;
+			BlockCompressorChains chains(reader->GetDatasetType(), settings, settings.ModelChainsBegin(firstBlock));
+
+			if (recordId < lastRecord)
+				reader->SeekToBlock(settings.ModelChainsBegin(firstBlock));
+
+			// decompress only the blocks overlapping the range and write out
+			// the part of the FASTQ block containing the requested records
+			while (recordId < lastRecord && reader->ReadNextChunk(dsrcChunk))
+			{
+				const uint64 blockId = reader->CurrentBlockId() - 1;
+				const DsrcBlockInfo& info = reader->GetBlockInfo(blockId);
+
+				BitMemoryReader bitMemory(dsrcChunk->data.Pointer(), dsrcChunk->size);
+				BlockCompressor& superblock = chains.Acquire(blockId);
+				superblock.Read(bitMemory, *fastqChunk);
+				chains.Release(blockId);
+
+				if (blockId < firstBlock)
+				{
+					fastqChunk->Reset();
+					dsrcChunk->Reset();
+					continue;
+				}
+
+				const std::vector<FastqRecord>& records = superblock.GetRecords();
+				const uint64 beginIdx = recordId - info.firstRecord;
+				const uint64 endIdx = MIN(lastRecord - info.firstRecord, info.recordsCount);
+
+				uchar* begin = records[beginIdx].title;
+				uchar* end = (endIdx < info.recordsCount) ? records[endIdx].title
+														  : fastqChunk->data.Pointer() + fastqChunk->size;
+
+				FastqDataChunk range(begin, end - begin);
+				range.size = end - begin;
+				writer->WriteNextChunk(&range);
+
+				recordId = info.firstRecord + endIdx;
+
+				fastqChunk->Reset();
+				dsrcChunk->Reset();
+			}
+
+			reader->FinishDecompress();
+			writer->Close();
+
+			if (recordId != lastRecord)
+				AddError("corrupted DSRC archive records index");
+		}
+		catch (const DsrcException& e_)
+		{
+			AddError(e_.what());
+		}
+	}
+
+	TFree(fastqChunk);
+	TFree(dsrcChunk);
+
+	TFree(writer);
+	TFree(reader);
+
+	// no partial output is left behind a failed extraction
+	if (IsError() && outputCreated)
+		std::remove(fastqFilename_.c_str());
+
+	return !IsError();
+}
+
+bool DsrcVerifierST::Process(const std::string& dsrcFilename_)
+{
+	ASSERT(!IsError());
+
+	DsrcFileReader* reader = NULL;
+
+	DsrcDataChunk* dsrcChunk = NULL;
+	FastqDataChunk* fastqChunk = NULL;
+
+	try
+	{
+		reader = new DsrcFileReader();
+		reader->StartDecompress(dsrcFilename_, modelDictionary);
+
+		if (!reader->GetCompressionSettings().calculateCrc32)
+		{
+			AddError("archive does not store CRC32 checksums (compressed without -c)");
+		}
+		else
+		{
+			dsrcChunk = new DsrcDataChunk(DsrcDataChunk::DefaultBufferSize);
+			fastqChunk = new FastqDataChunk(FastqDataChunk::DefaultBufferSize);
+		}
+	}
+	catch (const DsrcException& e_)
+	{
+		AddError(e_.what());
+	}
+
+	if (!IsError())
+	{
+		BlockCompressorChains chains(reader->GetDatasetType(), reader->GetCompressionSettings());
+
+		std::vector<int64> corruptBlocks;
+		uint64 blockId = 0;
+		while (reader->ReadNextChunk(dsrcChunk))
+		{
+			BitMemoryReader bitMemory(dsrcChunk->data.Pointer(), dsrcChunk->size);
+			BlockCompressor& superblock = chains.Acquire(blockId);
+
+			bool valid = false;
+			try
+			{
+				valid = superblock.VerifyChecksum(bitMemory, *fastqChunk);
+			}
+			catch (const std::exception&)
+			{
+				superblock.Reset();
+			}
+			chains.Release(blockId);
+
+			if (!valid)
+				corruptBlocks.push_back(blockId);
+
+			blockId++;
+			fastqChunk->Reset();
+			dsrcChunk->Reset();
+		}
+
+		reader->FinishDecompress();
+
+		AddCorruptBlocksError(corruptBlocks, blockId);
+	}
+
+	TFree(fastqChunk);
+	TFree(dsrcChunk);
+
+	TFree(reader);
+
+	return !IsError();
+}
+
+bool DsrcDictionaryTrainerST::Process(const std::string& fastqFilename_,
+									  const std::string& dictionaryFilename_,
+									  const DsrcCompressionSettings& compSettings_,
+									  uint32 qualityOffset_)
+{
+	ASSERT(!IsError());
+
+	IFastqStreamReader* reader = NULL;
+	DsrcDataChunk* dsrcChunk = NULL;
+	FastqDataChunk* fastqChunk = NULL;
+
+	FastqDatasetType datasetType;
+	CompressionSettings settings = CompressionSettings::ConvertFrom(compSettings_);
+
+	try
+	{
+		reader = CreateFastqFileReader(fastqFilename_, compSettings_.fastqBufferSizeMb << 20);
+
+		dsrcChunk = new DsrcDataChunk(DsrcDataChunk::DefaultBufferSize);
+		fastqChunk = new FastqDataChunk(compSettings_.fastqBufferSizeMb << 20);
+
+		const bool findQOffset = qualityOffset_ == FastqDatasetType::AutoQualityOffsetSelect;
+		if (!findQOffset)
+		{
+			datasetType.qualityOffset = qualityOffset_;
+		}
+
+		FastqParser parser;
+		if (!reader->ReadNextChunk(fastqChunk) || parser.Analyze(*fastqChunk, datasetType, findQOffset) == 0)
+		{
+			AddError("Error analyzing FASTQ dataset");
+		}
+	}
+	catch (const DsrcException& e_)
+	{
+		AddError(e_.what());
+	}
+
+	if (!IsError())
+	{
+		// the blocks are compressed as one chain, the models adapting to all of them
+		BitMemoryWriter bitMemory(dsrcChunk->data);
+		BlockCompressor superblock(datasetType, settings);
+		uint64 blockId = 0;
+
+		do
+		{
+			superblock.SetModelsChained(blockId++ > 0);
+			superblock.Store(bitMemory, *dsrcChunk, *fastqChunk);
+
+			fastqChunk->Reset();
+			dsrcChunk->Reset();
+			bitMemory.Reset();
+		}
+		while (reader->ReadNextChunk(fastqChunk));
+
+		reader->Close();
+
+		try
+		{
+			ModelDictionary dictionary;
+			superblock.StoreModels(dictionary);
+			dictionary.Save(dictionaryFilename_);
+
+			std::ostringstream ss;
+			ss << "Trained models (in bytes)\n";
+			ss << "DNA: " << std::setw(16) << dictionary.DnaModels().size() << '\n';
+			ss << "QUA: " << std::setw(16) << dictionary.QualityModels().size() << '\n';
+			ss << "Blocks: " << blockId << ", hash: " << std::hex << std::uppercase
+			   << std::setw(8) << std::setfill('0') << dictionary.Hash() << '\n';
+			AddLog(ss.str());
+		}
+		catch (const DsrcException& e_)
+		{
+			AddError(e_.what());
+		}
+	}
+
+	TFree(fastqChunk);
+	TFree(dsrcChunk);
+	TFree(reader);
+
+	return !IsError();
+}
+
 bool DsrcCompressorMT::Process(const std::string& fastqFilename_,
 							   const std::string& dsrcFilename_,
 							   const DsrcCompressionSettings& compSettings_,
@@ -249,7 +580,7 @@ bool DsrcCompressorMT::Process(const std::string& fastqFilename_,
 	FastqDataPool* fastqPool = NULL;
 	FastqDataQueue* fastqQueue = NULL;
 	DsrcDataPool* dsrcPool = NULL;
-	DsrcDataQueue* dsrcQueue = NULL;
+	DsrcDataReorderQueue* dsrcQueue = NULL;
 	ErrorHandler* errorHandler = NULL;
 	//
 	//
@@ -259,13 +590,14 @@ bool DsrcCompressorMT::Process(const std::string& fastqFilename_,
 
 	FastqDatasetType datasetType;
 	CompressionSettings compSettings = CompressionSettings::ConvertFrom(compSettings_);
+	compSettings.modelDictionary = modelDictionary;
 
 	try
 	{
 		if (useFastqStdIo_)
 			fileReader = new FastqStdIoReader();
 		else
-			fileReader = new FastqFileReader(fastqFilename_);
+			fileReader = CreateFastqFileReader(fastqFilename_, compSettings_.fastqBufferSizeMb << 20);
 
 		fileWriter = new DsrcFileWriter();
 		fileWriter->StartCompress(dsrcFilename_);
@@ -275,7 +607,7 @@ bool DsrcCompressorMT::Process(const std::string& fastqFilename_,
 		fastqQueue = new FastqDataQueue(partNum, 1);										// maxPart, threadCount
 
 		dsrcPool = new DsrcDataPool(partNum, compSettings_.fastqBufferSizeMb << 20);
-		dsrcQueue = new DsrcDataQueue(partNum, threadNum_);
+		dsrcQueue = new DsrcDataReorderQueue(partNum * 2, threadNum_);				// window, threadCount
 
 		if (compSettings_.calculateCrc32)
 			errorHandler = new MultithreadedErrorHandler();
@@ -312,6 +644,10 @@ bool DsrcCompressorMT::Process(const std::string& fastqFilename_,
 		//
 		th::thread readerThread(th::ref(*dataReader));
 
+		BlockCompressorChains* chains = NULL;
+		if (compSettings.HasModelChains())
+			chains = new BlockCompressorChains(datasetType, compSettings);
+
 		std::vector<DsrcCompressor*> operators;
 		operators.resize(threadNum_);
 
@@ -320,7 +656,7 @@ bool DsrcCompressorMT::Process(const std::string& fastqFilename_,
 
 		for (uint32 i = 0; i < threadNum_; ++i)
 		{
-			operators[i] = new DsrcCompressor(*fastqQueue, *fastqPool, *dsrcQueue, *dsrcPool, *errorHandler, datasetType, compSettings);
+			operators[i] = new DsrcCompressor(*fastqQueue, *fastqPool, *dsrcQueue, *dsrcPool, *errorHandler, datasetType, compSettings, chains);
 			opThreadGroup.create_thread(th::ref(*operators[i]));
 		}
 
@@ -334,7 +670,7 @@ bool DsrcCompressorMT::Process(const std::string& fastqFilename_,
 
 		for (uint32 i = 0; i < threadNum_; ++i)
 		{
-			operators[i] = new DsrcCompressor(*fastqQueue, *fastqPool, *dsrcQueue, *dsrcPool, *errorHandler, datasetType, compSettings);
+			operators[i] = new DsrcCompressor(*fastqQueue, *fastqPool, *dsrcQueue, *dsrcPool, *errorHandler, datasetType, compSettings, chains);
 			opThreadGroup.push_back(th::thread(th::ref(*operators[i])));
 		}
 
@@ -357,6 +693,8 @@ bool DsrcCompressorMT::Process(const std::string& fastqFilename_,
 			AddError(errorHandler->GetError());
 
 
+		AddWriterStallsLog(dsrcQueue->StallCount(), dsrcQueue->PopCount());
+
 		// free resources, cleanup
 		//
 		fastqQueue->Reset();
@@ -366,6 +704,7 @@ bool DsrcCompressorMT::Process(const std::string& fastqFilename_,
 		{
 			delete operators[i];
 		}
+		TFree(chains);
 
 		fileReader->Close();
 		fileWriter->FinishCompress();
@@ -409,7 +748,8 @@ bool DsrcCompressorMT::Process(const std::string& fastqFilename_,
 bool DsrcDecompressorMT::Process(const std::string& fastqFilename_,
 								 const std::string& dsrcFilename_,
 								 uint32 threadNum_,
-								 bool useFastqStdIo_)
+								 bool useFastqStdIo_,
+								 uint32 fieldsMask_)
 {
 	ASSERT(!IsError());
 
@@ -419,7 +759,7 @@ bool DsrcDecompressorMT::Process(const std::string& fastqFilename_,
 	// make reusable
 	//
 	FastqDataPool* fastqPool = NULL;
-	FastqDataQueue* fastqQueue = NULL;
+	FastqDataReorderQueue* fastqQueue = NULL;
 	DsrcDataPool* dsrcPool = NULL;
 	DsrcDataQueue* dsrcQueue = NULL;
 	ErrorHandler* errorHandler = NULL;
@@ -432,7 +772,7 @@ bool DsrcDecompressorMT::Process(const std::string& fastqFilename_,
 	try
 	{
 		fileReader = new DsrcFileReader();
-		fileReader->StartDecompress(dsrcFilename_);		// here get FASTQ buffer size!!!!
+		fileReader->StartDecompress(dsrcFilename_, modelDictionary);		// here get FASTQ buffer size!!!!
 
 		if (useFastqStdIo_)
 			fileWriter= new FastqStdIoWriter();
@@ -446,9 +786,9 @@ bool DsrcDecompressorMT::Process(const std::string& fastqFilename_,
 		dsrcQueue = new DsrcDataQueue(partNum, 1);
 
 		fastqPool = new FastqDataPool(partNum, fastqBufferSizeMB << 20);		// maxPart, bufferPartSize
-		fastqQueue = new FastqDataQueue(partNum, threadNum_);					// maxPart, threadCount
+		fastqQueue = new FastqDataReorderQueue(partNum * 2, threadNum_);		// window, threadCount
 
-		errorHandler = new ErrorHandler();
+		errorHandler = new MultithreadedErrorHandler();		// set by the workers on a corrupt block
 		dataReader = new DsrcReader(*fileReader, *dsrcQueue, *dsrcPool, *errorHandler);
 		dataWriter = new FastqWriter(*fileWriter, *fastqQueue, *fastqPool, *errorHandler);
 	}
@@ -463,6 +803,13 @@ bool DsrcDecompressorMT::Process(const std::string& fastqFilename_,
 		//
 		th::thread readerThread(th::ref(*dataReader));
 
+		BlockCompressorChains* chains = NULL;
+		if (fileReader->GetCompressionSettings().HasModelChains())
+		{
+			chains = new BlockCompressorChains(fileReader->GetDatasetType(), fileReader->GetCompressionSettings());
+			chains->SetFieldsMask(fieldsMask_);
+		}
+
 		std::vector<DsrcDecompressor*> operators;
 		operators.resize(threadNum_);
 
@@ -473,7 +820,8 @@ bool DsrcDecompressorMT::Process(const std::string& fastqFilename_,
 		for (uint32 i = 0; i < threadNum_; ++i)
 		{
 			operators[i] = new DsrcDecompressor(*fastqQueue, *fastqPool, *dsrcQueue, *dsrcPool, *errorHandler,
-												fileReader->GetDatasetType(), fileReader->GetCompressionSettings());
+												fileReader->GetDatasetType(), fileReader->GetCompressionSettings(),
+												fieldsMask_, chains);
 			opThreadGroup.create_thread(th::ref(*operators[i]));
 		}
 
@@ -488,7 +836,8 @@ bool DsrcDecompressorMT::Process(const std::string& fastqFilename_,
 		for (uint32 i = 0; i < threadNum_; ++i)
 		{
 			operators[i] = new DsrcDecompressor(*fastqQueue, *fastqPool, *dsrcQueue, *dsrcPool, *errorHandler,
-												fileReader->GetDatasetType(), fileReader->GetCompressionSettings());
+												fileReader->GetDatasetType(), fileReader->GetCompressionSettings(),
+												fieldsMask_, chains);
 			opThreadGroup.push_back(th::thread(th::ref(*operators[i])));
 		}
 
@@ -502,6 +851,11 @@ bool DsrcDecompressorMT::Process(const std::string& fastqFilename_,
 		}
 #endif
 
+		if (errorHandler->IsError())
+			AddError(errorHandler->GetError());
+
+		AddWriterStallsLog(fastqQueue->StallCount(), fastqQueue->PopCount());
+
 		// free resources, cleanup
 		//
 		fastqQueue->Reset();
@@ -511,6 +865,7 @@ bool DsrcDecompressorMT::Process(const std::string& fastqFilename_,
 		{
 			delete operators[i];
 		}
+		TFree(chains);
 
 		fileReader->FinishDecompress();
 		fileWriter->Close();
@@ -535,6 +890,119 @@ bool DsrcDecompressorMT::Process(const std::string& fastqFilename_,
 	return !IsError();
 }
 
+bool DsrcVerifierMT::Process(const std::string& dsrcFilename_,
+							 uint32 threadNum_)
+{
+	ASSERT(!IsError());
+
+	DsrcFileReader* fileReader = NULL;
+
+	FastqDataPool* fastqPool = NULL;
+	DsrcDataPool* dsrcPool = NULL;
+	DsrcDataQueue* dsrcQueue = NULL;
+	ErrorHandler* errorHandler = NULL;
+
+	DsrcReader* dataReader = NULL;
+
+	try
+	{
+		fileReader = new DsrcFileReader();
+		fileReader->StartDecompress(dsrcFilename_, modelDictionary);
+
+		if (!fileReader->GetCompressionSettings().calculateCrc32)
+		{
+			AddError("archive does not store CRC32 checksums (compressed without -c)");
+		}
+		else
+		{
+			const uint32 fastqBufferSizeMB = fileReader->GetCompressionSettings().fastqBufferSizeMb;
+			const uint32 partNum = (fastqBufferSizeMB < 128) ? threadNum_ * 4 : threadNum_ * 2;
+
+			dsrcPool = new DsrcDataPool(partNum, fastqBufferSizeMB << 20);
+			dsrcQueue = new DsrcDataQueue(partNum, 1);
+
+			// a single decoding buffer per worker
+			fastqPool = new FastqDataPool(threadNum_, fastqBufferSizeMB << 20);
+
+			errorHandler = new ErrorHandler();
+			dataReader = new DsrcReader(*fileReader, *dsrcQueue, *dsrcPool, *errorHandler);
+		}
+	}
+	catch (const DsrcException& e_)
+	{
+		AddError(e_.what());
+	}
+
+	if (!IsError())
+	{
+		BlockCompressorChains* chains = NULL;
+		if (fileReader->GetCompressionSettings().HasModelChains())
+			chains = new BlockCompressorChains(fileReader->GetDatasetType(), fileReader->GetCompressionSettings());
+
+		std::vector<DsrcVerifier*> operators;
+		operators.resize(threadNum_);
+
+#ifdef USE_BOOST_THREAD
+		boost::thread_group opThreadGroup;
+
+		for (uint32 i = 0; i < threadNum_; ++i)
+		{
+			operators[i] = new DsrcVerifier(*fastqPool, *dsrcQueue, *dsrcPool, *errorHandler,
+											fileReader->GetDatasetType(), fileReader->GetCompressionSettings(), chains);
+			opThreadGroup.create_thread(th::ref(*operators[i]));
+		}
+
+		(*dataReader)();	// main thread works as reader
+
+		opThreadGroup.join_all();
+#else
+		std::vector<th::thread> opThreadGroup;
+
+		for (uint32 i = 0; i < threadNum_; ++i)
+		{
+			operators[i] = new DsrcVerifier(*fastqPool, *dsrcQueue, *dsrcPool, *errorHandler,
+											fileReader->GetDatasetType(), fileReader->GetCompressionSettings(), chains);
+			opThreadGroup.push_back(th::thread(th::ref(*operators[i])));
+		}
+
+		(*dataReader)();
+
+		for (th::thread& t : opThreadGroup)
+		{
+			t.join();
+		}
+#endif
+
+		std::vector<int64> corruptBlocks;
+		uint64 blocksCount = 0;
+		for (uint32 i = 0; i < threadNum_; ++i)
+		{
+			const std::vector<int64>& blocks = operators[i]->GetCorruptBlocks();
+			corruptBlocks.insert(corruptBlocks.end(), blocks.begin(), blocks.end());
+			blocksCount += operators[i]->GetBlocksCount();
+
+			delete operators[i];
+		}
+		TFree(chains);
+
+		dsrcQueue->Reset();
+		fileReader->FinishDecompress();
+
+		AddCorruptBlocksError(corruptBlocks, blocksCount);
+	}
+
+	TFree(dataReader);
+	TFree(errorHandler);
+
+	TFree(dsrcQueue);
+	TFree(dsrcPool);
+	TFree(fastqPool);
+
+	TFree(fileReader);
+
+	return !IsError();
+}
+
 } // namespace comp
 
 } // namespace dsrc
@@ -13,6 +13,7 @@
 #include "../include/dsrc/Globals.h"
 
 #include <string>
+#include <vector>
 
 #include "FastqStream.h"
 #include "DsrcFile.h"
@@ -28,8 +29,18 @@ class IDsrcOperator
 public:
 	static const uint32 AvailableHardwareThreadsNum;
 
+	IDsrcOperator()
+		:	modelDictionary(NULL)
+	{}
+
 	virtual ~IDsrcOperator() {}
 
+	// the trained models to compress with, or the ones the archive needs
+	void SetModelDictionary(const ModelDictionary* dictionary_)
+	{
+		modelDictionary = dictionary_;
+	}
+
 	bool IsError() const
 	{
 		return errorMessage.length() > 0;
@@ -58,6 +69,7 @@ public:
 protected:
 	std::string errorMessage;
 	std::string logMessage;
+	const ModelDictionary* modelDictionary;
 
 	void AddError(const std::string& err_)
 	{
@@ -68,6 +80,13 @@ protected:
 	{
 		logMessage += log_ + '\n';
 	}
+
+	// how many times the output writer had to wait for a missing block
+	// while the following ones were already processed
+	void AddWriterStallsLog(uint64 stalls_, uint64 blocks_);
+
+	// lists the blocks failing the checksums verification
+	void AddCorruptBlocksError(std::vector<int64>& blocks_, uint64 blocksCount_);
 };
 
 class DsrcCompressorST : public IDsrcOperator
@@ -85,9 +104,39 @@ class DsrcDecompressorST : public IDsrcOperator
 public:
 	bool Process(const std::string& fastqFilename_,
 				 const std::string& dsrcFilename_,
+				 bool useFastqStdIo_,
+				 uint32 fieldsMask_ = FastqFields::All);
+};
+
+class DsrcExtractorST : public IDsrcOperator
+{
+public:
+	bool Process(const std::string& fastqFilename_,
+				 const std::string& dsrcFilename_,
+				 uint64 firstRecord_,
+				 uint64 recordsCount_,
 				 bool useFastqStdIo_);
 };
 
+// decodes all the blocks checking the stored CRC32 checksums,
+// without writing out the records
+class DsrcVerifierST : public IDsrcOperator
+{
+public:
+	bool Process(const std::string& dsrcFilename_);
+};
+
+// compresses the records discarding the output, to store the DNA and quality
+// models adapted to all of them as the dictionary
+class DsrcDictionaryTrainerST : public IDsrcOperator
+{
+public:
+	bool Process(const std::string& fastqFilename_,
+				 const std::string& dictionaryFilename_,
+				 const DsrcCompressionSettings& compSettings_,
+				 uint32 qualityOffset_);
+};
+
 class DsrcCompressorMT : public IDsrcOperator
 {
 public:
@@ -105,7 +154,16 @@ public:
 	bool Process(const std::string& fastqFilename_,
 				 const std::string& dsrcFilename_,
 				 uint32 threadNum_,
-				 bool useFastqStdIo_);
+				 bool useFastqStdIo_,
+				 uint32 fieldsMask_ = FastqFields::All);
+};
+
+// the blocks are verified in any order, with no output ordering
+class DsrcVerifierMT : public IDsrcOperator
+{
+public:
+	bool Process(const std::string& dsrcFilename_,
+				 uint32 threadNum_);
 };
 
 } // namespace comp
@@ -13,6 +13,7 @@
 #include "DsrcIo.h"
 #include "BlockCompressor.h"
 #include "ErrorHandler.h"
+#include "utils.h"
 
 #include <algorithm>
 #include <cstring>
@@ -33,42 +34,63 @@ void DsrcCompressor::Process()
 
 	FastqDataChunk* fqChunk = NULL;
 	DsrcDataChunk* dsrcData = NULL;
+	FastqDataChunk* checkChunk = NULL;		// decoded by the CRC32 check, the input is kept intact
 
-	BlockCompressor superblock(datasetType, compSettings);
+	BlockCompressor* ownBlock = (chains == NULL) ? new BlockCompressor(datasetType, compSettings) : NULL;
+
+	// the output part is taken before the input one -- otherwise the parts
+	// popped later could use up the pool while the part awaited by the
+	// reordering writer waits for it
+	dsrcPool.Acquire(dsrcData);
 
 	while (!errorHandler.IsError() && fastqQueue.Pop(partId, fqChunk))
 	{
 		ASSERT(fqChunk->size > 0);
-
-		dsrcPool.Acquire(dsrcData);
 		ASSERT(dsrcData != NULL);
 
+		// the chained block waits for the previous one of its chain
+		BlockCompressor& superblock = (chains == NULL) ? *ownBlock : chains->Acquire(partId);
+
 		BitMemoryWriter bitMemory(dsrcData->data);
 
-		superblock.Store(bitMemory, dsrcData->rawStreamsInfo, dsrcData->compStreamsInfo, *fqChunk);
+		superblock.Store(bitMemory, *dsrcData, *fqChunk);
 
 		bitMemory.Flush();
 		dsrcData->size = bitMemory.Position();
 
-		if (compSettings.calculateCrc32)
+		if (compSettings.calculateCrc32 && compSettings.verifyCrc32)
 		{
 			BitMemoryReader reader(dsrcData->data.Pointer(), dsrcData->data.Size());
-			std::fill(fqChunk->data.Pointer(), fqChunk->data.Pointer() + fqChunk->data.Size(), 0xCC);
+			if (checkChunk == NULL)
+				checkChunk = new FastqDataChunk(fqChunk->data.Size());
+			checkChunk->Reset();
 
-			if (!superblock.VerifyChecksum(reader, *fqChunk))
+			// the chained models are checked by the decoder following the chain
+			BlockCompressor& checker = (chains == NULL) ? *ownBlock : chains->GetChecker(partId);
+			if (!checker.VerifyChecksum(reader, *checkChunk))
 			{
 				errorHandler.SetError("CRC32 checksums mismatch.");
 			}
 		}
 
+		if (chains != NULL)
+			chains->Release(partId);
+
 		dsrcQueue.Push(partId, dsrcData);
 		dsrcData = NULL;
 		bitMemory.Reset();
 
 		fastqPool.Release(fqChunk);
 		fqChunk = NULL;
+
+		dsrcPool.Acquire(dsrcData);
 	}
 
+	dsrcPool.Release(dsrcData);
+
+	TFree(checkChunk);
+	TFree(ownBlock);
+
 	dsrcQueue.SetCompleted();
 }
 
@@ -79,9 +101,19 @@ void DsrcDecompressor::Process()
 	FastqDataChunk* fqChunk = NULL;
 	DsrcDataChunk* dsrcData = NULL;
 
-	BlockCompressor superblock(datasetType, compSettings);
+	BlockCompressor* ownBlock = NULL;
+	if (chains == NULL)
+	{
+		ownBlock = new BlockCompressor(datasetType, compSettings);
+		ownBlock->SetFieldsMask(fieldsMask);
+	}
 
-	while (!errorHandler.IsError() && dsrcQueue.Pop(partId, dsrcData))
+	// taken before the input part, as by the compressor
+	fastqPool.Acquire(fqChunk);
+
+	// after an error the parts are passed on empty, the reader stops and the
+	// writer only releases them -- leaving no thread waiting for the others
+	while (dsrcQueue.Pop(partId, dsrcData))
 	{
 		ASSERT(dsrcData);
 		ASSERT(dsrcData->size > 0);
@@ -89,20 +121,91 @@ void DsrcDecompressor::Process()
 
 		BitMemoryReader bitMemory(dsrcData->data.Pointer(), dsrcData->size);
 
-		fastqPool.Acquire(fqChunk);
+		BlockCompressor& superblock = (chains == NULL) ? *ownBlock : chains->Acquire(partId);
 
-		superblock.Read(bitMemory, *fqChunk);
+		if (!errorHandler.IsError())
+		{
+			try
+			{
+				superblock.Read(bitMemory, *fqChunk);
+			}
+			catch (const DsrcException& e_)
+			{
+				errorHandler.SetError(e_.what());
+				fqChunk->Reset();
+			}
+		}
+
+		if (chains != NULL)
+			chains->Release(partId);
 
 		fastqQueue.Push(partId, fqChunk);
 		fqChunk = NULL;
 
 		dsrcPool.Release(dsrcData);
 		dsrcData = NULL;
+
+		fastqPool.Acquire(fqChunk);
 	}
 
+	fastqPool.Release(fqChunk);
+
+	TFree(ownBlock);
+
 	fastqQueue.SetCompleted();
 }
 
+void DsrcVerifier::Process()
+{
+	int64 partId = 0;
+
+	FastqDataChunk* fqChunk = NULL;
+	DsrcDataChunk* dsrcData = NULL;
+
+	BlockCompressor* ownBlock = (chains == NULL) ? new BlockCompressor(datasetType, compSettings) : NULL;
+
+	// the decoded records are not used, so one chunk serves all the blocks
+	fastqPool.Acquire(fqChunk);
+
+	while (!errorHandler.IsError() && dsrcQueue.Pop(partId, dsrcData))
+	{
+		ASSERT(dsrcData);
+		ASSERT(dsrcData->size <= dsrcData->data.Size());
+
+		BitMemoryReader bitMemory(dsrcData->data.Pointer(), dsrcData->size);
+
+		// a corrupt block breaks the models of the next blocks of its chain,
+		// which are reported as well
+		BlockCompressor& superblock = (chains == NULL) ? *ownBlock : chains->Acquire(partId);
+
+		bool valid = false;
+		try
+		{
+			valid = superblock.VerifyChecksum(bitMemory, *fqChunk);
+		}
+		catch (const std::exception&)
+		{
+			superblock.Reset();
+		}
+
+		if (chains != NULL)
+			chains->Release(partId);
+
+		if (!valid)
+			corruptBlocks.push_back(partId);
+		blocksCount++;
+
+		fqChunk->Reset();
+
+		dsrcPool.Release(dsrcData);
+		dsrcData = NULL;
+	}
+
+	fastqPool.Release(fqChunk);
+
+	TFree(ownBlock);
+}
+
 } // namespace comp
 
 } // namespace dsrc
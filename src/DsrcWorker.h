@@ -26,15 +26,14 @@ namespace dsrc
 namespace comp
 {
 
+class BlockCompressorChains;
+
 class IDsrcThreadWorker
 {
 public:
-	IDsrcThreadWorker(fq::FastqDataQueue& fastqQueue_, fq::FastqDataPool& fastqPool_,
-				   DsrcDataQueue& dsrcQueue_, DsrcDataPool& dsrcPool_, core::ErrorHandler& errorHandler_,
+	IDsrcThreadWorker(fq::FastqDataPool& fastqPool_, DsrcDataPool& dsrcPool_, core::ErrorHandler& errorHandler_,
 				   const FastqDatasetType& type_, const CompressionSettings& settings_)
-		:	fastqQueue(fastqQueue_)
-		,	fastqPool(fastqPool_)
-		,	dsrcQueue(dsrcQueue_)
+		:	fastqPool(fastqPool_)
 		,	dsrcPool(dsrcPool_)
 		,	errorHandler(errorHandler_)
 		,	datasetType(type_)
@@ -49,9 +48,7 @@ public:
 	}
 
 protected:
-	fq::FastqDataQueue&	fastqQueue;
 	fq::FastqDataPool& fastqPool;
-	DsrcDataQueue& dsrcQueue;
 	DsrcDataPool& dsrcPool;
 	core::ErrorHandler&	errorHandler;
 
@@ -62,16 +59,27 @@ private:
 	virtual void Process() = 0;
 };
 
+// the compressed parts are handed off directly to the writer's reorder queue,
+// with the model chains the workers share their block compressors
+//
 class DsrcCompressor : public IDsrcThreadWorker
 {
 public:
 	DsrcCompressor(fq::FastqDataQueue& fastqQueue_, fq::FastqDataPool& fastqPool_,
-				   DsrcDataQueue& dsrcQueue_, DsrcDataPool& dsrcPool_, core::ErrorHandler& errorHandler_,
-				   const FastqDatasetType& type_, const CompressionSettings& settings_)
-		:	IDsrcThreadWorker(fastqQueue_, fastqPool_, dsrcQueue_, dsrcPool_, errorHandler_, type_, settings_)
+				   DsrcDataReorderQueue& dsrcQueue_, DsrcDataPool& dsrcPool_, core::ErrorHandler& errorHandler_,
+				   const FastqDatasetType& type_, const CompressionSettings& settings_,
+				   BlockCompressorChains* chains_ = NULL)
+		:	IDsrcThreadWorker(fastqPool_, dsrcPool_, errorHandler_, type_, settings_)
+		,	fastqQueue(fastqQueue_)
+		,	dsrcQueue(dsrcQueue_)
+		,	chains(chains_)
 	{}
 
 private:
+	fq::FastqDataQueue&	fastqQueue;
+	DsrcDataReorderQueue& dsrcQueue;
+	BlockCompressorChains* chains;
+
 	void Process();
 };
 
@@ -79,13 +87,58 @@ private:
 class DsrcDecompressor : public IDsrcThreadWorker
 {
 public:
-	DsrcDecompressor(fq::FastqDataQueue& fastqQueue_, fq::FastqDataPool& fastqPool_,
+	DsrcDecompressor(fq::FastqDataReorderQueue& fastqQueue_, fq::FastqDataPool& fastqPool_,
 					DsrcDataQueue& dsrcQueue_, DsrcDataPool& dsrcPool_, core::ErrorHandler& errorHandler_,
-					const FastqDatasetType& type_, const CompressionSettings& settings_)
-		:	IDsrcThreadWorker(fastqQueue_, fastqPool_, dsrcQueue_, dsrcPool_, errorHandler_, type_, settings_)
+					const FastqDatasetType& type_, const CompressionSettings& settings_,
+					uint32 fieldsMask_ = FastqFields::All, BlockCompressorChains* chains_ = NULL)
+		:	IDsrcThreadWorker(fastqPool_, dsrcPool_, errorHandler_, type_, settings_)
+		,	fastqQueue(fastqQueue_)
+		,	dsrcQueue(dsrcQueue_)
+		,	fieldsMask(fieldsMask_)
+		,	chains(chains_)
 	{}
 
 private:
+	fq::FastqDataReorderQueue& fastqQueue;
+	DsrcDataQueue& dsrcQueue;
+	uint32 fieldsMask;
+	BlockCompressorChains* chains;
+
+	void Process();
+};
+
+
+// checks the checksums of the blocks without passing the records further,
+// the corrupt blocks do not stop the processing
+//
+class DsrcVerifier : public IDsrcThreadWorker
+{
+public:
+	DsrcVerifier(fq::FastqDataPool& fastqPool_, DsrcDataQueue& dsrcQueue_, DsrcDataPool& dsrcPool_,
+				 core::ErrorHandler& errorHandler_, const FastqDatasetType& type_, const CompressionSettings& settings_,
+				 BlockCompressorChains* chains_ = NULL)
+		:	IDsrcThreadWorker(fastqPool_, dsrcPool_, errorHandler_, type_, settings_)
+		,	dsrcQueue(dsrcQueue_)
+		,	chains(chains_)
+		,	blocksCount(0)
+	{}
+
+	uint64 GetBlocksCount() const
+	{
+		return blocksCount;
+	}
+
+	const std::vector<int64>& GetCorruptBlocks() const
+	{
+		return corruptBlocks;
+	}
+
+private:
+	DsrcDataQueue& dsrcQueue;
+	BlockCompressorChains* chains;
+	uint64 blocksCount;
+	std::vector<int64> corruptBlocks;
+
 	void Process();
 };
 
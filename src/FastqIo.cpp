@@ -10,7 +10,6 @@
 #include "FastqIo.h"
 
 #include <vector>
-#include <map>
 
 #include "Buffer.h"
 #include "FastqStream.h"
@@ -72,66 +71,20 @@ void FastqWriter::operator()()
 {
 	FastqDataChunk* part = NULL;
 	int64 partId = 0;
-	int64 lastPartId = -1;
 
-	std::map<int64, FastqDataChunk*> partsQueue;
-
-	while (!errorHandler.IsError() && recordsQueue.Pop(partId, part))
+	// the reorder queue returns the parts in order, after an error they are
+	// only released until the workers stop
+	while (recordsQueue.Pop(partId, part))
 	{
-		ASSERT(part->size > 0);
-		std::vector<FastqRecord>::const_iterator i;
-
-		if (partId != lastPartId + 1)
+		if (!errorHandler.IsError())
 		{
-			ASSERT(partsQueue.count(partId) == 0);
-			partsQueue.insert(std::make_pair(partId, part));
-			continue;
+			ASSERT(part->size > 0);
+			fileWriter.WriteNextChunk(part);
 		}
 
-		fileWriter.WriteNextChunk(part);
-		lastPartId++;
-
 		recordsPool.Release(part);
 		part = NULL;
-
-		while (partsQueue.size() > 0)
-		{
-			if (partsQueue.begin()->first == lastPartId + 1)
-			{
-				part = partsQueue.begin()->second;
-				fileWriter.WriteNextChunk(part);
-				lastPartId++;
-
-				recordsPool.Release(part);
-				partsQueue.erase(partsQueue.begin());
-			}
-			else
-			{
-				break;
-			}
-		}
-
-		part = NULL;
 	}
-
-	while (!errorHandler.IsError() && partsQueue.size() > 0)
-	{
-		if (partsQueue.begin()->first == lastPartId + 1)
-		{
-			part = partsQueue.begin()->second;
-			fileWriter.WriteNextChunk(part);
-			lastPartId++;
-
-			recordsPool.Release(part);
-			partsQueue.erase(partsQueue.begin());
-		}
-		else
-		{
-			break;
-		}
-	}
-
-	ASSERT(errorHandler.IsError() || partsQueue.size() == 0);
 }
 
 } // namesapce fq
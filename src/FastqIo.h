@@ -25,6 +25,7 @@ namespace fq
 {
 
 typedef core::TDataQueue<FastqDataChunk> FastqDataQueue;
+typedef core::TReorderQueue<FastqDataChunk> FastqDataReorderQueue;
 typedef core::TDataPool<FastqDataChunk> FastqDataPool;
 
 
@@ -33,9 +34,8 @@ typedef core::TDataPool<FastqDataChunk> FastqDataPool;
 class IFastqIoOperator
 {
 public:
-	IFastqIoOperator(FastqDataQueue& queue_, FastqDataPool& pool_, core::ErrorHandler& errorHandler_)
-		:	recordsQueue(queue_)
-		,	recordsPool(pool_)
+	IFastqIoOperator(FastqDataPool& pool_, core::ErrorHandler& errorHandler_)
+		:	recordsPool(pool_)
 		,	errorHandler(errorHandler_)
 	{}
 
@@ -44,7 +44,6 @@ public:
 	virtual void operator()() = 0;
 
 protected:
-	FastqDataQueue&		recordsQueue;
 	FastqDataPool&		recordsPool;
 	core::ErrorHandler& errorHandler;
 };
@@ -53,7 +52,8 @@ class FastqReader : public IFastqIoOperator
 {
 public:
 	FastqReader(IFastqStreamReader& reader_, FastqDataQueue& queue_, FastqDataPool& pool_, core::ErrorHandler& errorHandler_)
-		:	IFastqIoOperator(queue_, pool_, errorHandler_)
+		:	IFastqIoOperator(pool_, errorHandler_)
+		,	recordsQueue(queue_)
 		,	fileReader(reader_)
 		,	numParts(0)
 	{}
@@ -62,6 +62,7 @@ public:
 	void operator()();
 
 private:
+	FastqDataQueue&		recordsQueue;
 	IFastqStreamReader&	fileReader;
 	uint32 numParts;
 };
@@ -69,14 +70,16 @@ private:
 class FastqWriter : public IFastqIoOperator
 {
 public:
-	FastqWriter(IFastqStreamWriter& writer_, FastqDataQueue& queue_, FastqDataPool& pool_, core::ErrorHandler& errorHandler_)
-		:	IFastqIoOperator(queue_, pool_, errorHandler_)
+	FastqWriter(IFastqStreamWriter& writer_, FastqDataReorderQueue& queue_, FastqDataPool& pool_, core::ErrorHandler& errorHandler_)
+		:	IFastqIoOperator(pool_, errorHandler_)
+		,	recordsQueue(queue_)
 		,	fileWriter(writer_)
 	{}
 
 	void operator()();
 
 private:
+	FastqDataReorderQueue&	recordsQueue;
 	IFastqStreamWriter&	fileWriter;
 };
 
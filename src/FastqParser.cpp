@@ -215,16 +215,31 @@ bool FastqParser::Analyze(const std::vector<FastqRecord>& records_, uint64 recCo
 }
 
 uint64 FastqParser::ParseFrom(const FastqDataChunk& chunk_, std::vector<FastqRecord>& records_, uint64& rec_count_, StreamsInfo& streamsInfo_)
+{
+	StartParsing(chunk_);
+
+	streamsInfo_.Clear();
+	rec_count_ = 0;
+	ParseNext(records_, rec_count_, (uint64)-1, streamsInfo_);
+	ASSERT(rec_count_ > 0);
+
+	return ParsedSize();
+}
+
+void FastqParser::StartParsing(const FastqDataChunk& chunk_)
 {
 	ASSERT(buffer == NULL);
 
 	memory = (byte*)chunk_.data.Pointer();
 	memoryPos = 0;
 	memorySize = chunk_.size;
+	skippedBytes = 0;
+}
 
-	streamsInfo_.Clear();
-	rec_count_ = 0;
-	while (memoryPos < memorySize && ReadNextRecord(records_[rec_count_]))
+uint64 FastqParser::ParseNext(std::vector<FastqRecord>& records_, uint64& rec_count_, uint64 maxCount_, StreamsInfo& streamsInfo_)
+{
+	uint64 count = 0;
+	while (count < maxCount_ && memoryPos < memorySize && ReadNextRecord(records_[rec_count_]))
 	{
 		const FastqRecord& rec = records_[rec_count_];
 		streamsInfo_.sizes[StreamsInfo::TagStream] += rec.titleLen;
@@ -232,30 +247,41 @@ uint64 FastqParser::ParseFrom(const FastqDataChunk& chunk_, std::vector<FastqRec
 		streamsInfo_.sizes[StreamsInfo::QualityStream] += rec.qualityLen;
 
 		rec_count_++;
+		count++;
 		if (records_.size() < rec_count_ + 1)
 			records_.resize(records_.size() + REC_EXTENSION_FACTOR(records_.size()));
 	}
+	return count;
+}
+
+
+uint64 FastqParserExt::ParseFrom(const FastqDataChunk &chunk_, std::vector<FastqRecord> &records_, uint64 &rec_count_,
+								 StreamsInfo& streamsInfo_, uint64 tagPreserveFlags_)
+{
+	StartParsing(chunk_);
+
+	rec_count_ = 0;
+	ParseNext(records_, rec_count_, (uint64)-1, streamsInfo_, tagPreserveFlags_);
 	ASSERT(rec_count_ > 0);
 
-	return chunk_.size - skippedBytes;
+	return ParsedSize();
 }
 
+void FastqParserExt::StartParsing(const FastqDataChunk& chunk_)
+{
+	FastqParser::StartParsing(chunk_);
+	totalBytesCut = 0;
+}
 
-uint64 FastqParserExt::ParseFrom(const FastqDataChunk &chunk_, std::vector<FastqRecord> &records_, uint64 &rec_count_,
+uint64 FastqParserExt::ParseNext(std::vector<FastqRecord> &records_, uint64 &rec_count_, uint64 maxCount_,
 								 StreamsInfo& streamsInfo_, uint64 tagPreserveFlags_)
 {
-	ASSERT(buffer == NULL);
 	ASSERT(tagPreserveFlags_ != 0);
 
 	uchar tagBuffer[MaxTagBufferSize];
-	totalBytesCut = 0;
-
-	memory = (byte*)chunk_.data.Pointer();
-	memoryPos = 0;
-	memorySize = chunk_.size;
 
-	rec_count_ = 0;
-	while (memoryPos < memorySize && ReadNextRecord(records_[rec_count_], tagBuffer, tagPreserveFlags_))
+	uint64 count = 0;
+	while (count < maxCount_ && memoryPos < memorySize && ReadNextRecord(records_[rec_count_], tagBuffer, tagPreserveFlags_))
 	{
 		const FastqRecord& rec = records_[rec_count_];
 		streamsInfo_.sizes[StreamsInfo::TagStream] += rec.titleLen;
@@ -263,13 +289,13 @@ uint64 FastqParserExt::ParseFrom(const FastqDataChunk &chunk_, std::vector<Fastq
 		streamsInfo_.sizes[StreamsInfo::QualityStream] += rec.qualityLen;
 
 		rec_count_++;
+		count++;
 		if (records_.size() < rec_count_ + 1)
 			records_.resize(records_.size() + REC_EXTENSION_FACTOR(records_.size()));
 	}
-	ASSERT(rec_count_ > 0);
-	ASSERT(chunk_.size >= totalBytesCut + skippedBytes);
+	ASSERT(memorySize >= totalBytesCut + skippedBytes);
 
-	return chunk_.size - totalBytesCut - skippedBytes;
+	return count;
 }
 
 bool FastqParserExt::ReadNextRecord(FastqRecord &rec_, uchar *tagBuffer_, uint64 tagPreserveFlags_)
@@ -305,8 +331,8 @@ bool FastqParserExt::ReadNextRecord(FastqRecord &rec_, uchar *tagBuffer_, uint64
 		fieldBeginPos = i + 1;
 	}
 
-	// skip copying the separator after the last token
-	if (bufferPos > 0 && bufferPos != fieldBeginPos)
+	// drop the separator (or the line end, when the last token is kept)
+	if (bufferPos > 0)
 		bufferPos -= 1;
 
 	ASSERT(rec_.titleLen >= bufferPos);
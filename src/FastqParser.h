@@ -15,6 +15,13 @@
 #include "Common.h"
 #include "Fastq.h"
 
+#if defined(DSRC_USE_SSE2)
+#	include <emmintrin.h>
+#	if defined(_MSC_VER)
+#		include <intrin.h>
+#	endif
+#endif
+
 namespace dsrc
 {
 
@@ -38,6 +45,20 @@ public:
 					 uint64& rec_count_,
 					 StreamsInfo& streamsInfo_);
 
+	// parsing in portions: ParseNext() appends at most maxCount_ records,
+	// returning less when the chunk is over
+	void StartParsing(const FastqDataChunk& chunk_);
+	uint64 ParseNext(std::vector<FastqRecord>& records_,
+					 uint64& rec_count_,
+					 uint64 maxCount_,
+					 StreamsInfo& streamsInfo_);
+
+	// size of the parsed data without the skipped CR symbols
+	uint64 ParsedSize() const
+	{
+		return memorySize - skippedBytes;
+	}
+
 	bool Analyze(const FastqDataChunk& chunk_,
 				 FastqDatasetType& header_,
 				 bool estimateQualityOffset_ = false);
@@ -104,26 +125,48 @@ protected:
 
 	uint32 SkipLine()
 	{
-		uint32 len = 0;
-		for (;;)
+		const uint64 eol = FindLineEnd();
+		uint32 len = (uint32)(eol - memoryPos);
+		memoryPos = eol;
+
+		if (memoryPos < memorySize)
 		{
 			int32 c = Getc();
-			if (c == -1)
-				break;
+			if (c == '\r' && Peekc() == '\n')	// case of CR LF
+				Skipc();
+		}
+		return len;
+	}
 
-			if (c != '\n' && c != '\r')
-			{
-				len++;
-			}
-			else
-			{
-				if (c == '\r' && Peekc() == '\n')	// case of CR LF
-					Skipc();
+	// position of the first CR or LF from the current one, or the memory end
+	uint64 FindLineEnd() const
+	{
+		uint64 pos = memoryPos;
 
-				break;
+#if defined(DSRC_USE_SSE2)
+		const __m128i lf = _mm_set1_epi8('\n');
+		const __m128i cr = _mm_set1_epi8('\r');
+
+		for ( ; pos + 16 <= memorySize; pos += 16)
+		{
+			const __m128i v = _mm_loadu_si128((const __m128i*)(memory + pos));
+			uint32 mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, lf), _mm_cmpeq_epi8(v, cr)));
+			if (mask != 0)
+			{
+#	if defined(_MSC_VER)
+				unsigned long idx;
+				_BitScanForward(&idx, mask);
+				return pos + idx;
+#	else
+				return pos + __builtin_ctz(mask);
+#	endif
 			}
 		}
-		return len;
+#endif
+
+		while (pos < memorySize && memory[pos] != '\n' && memory[pos] != '\r')
+			pos++;
+		return pos;
 	}
 
 	int32 Getc()
@@ -168,6 +211,15 @@ public:
 	// this is a bad design, but trying to avoid virtual function call
 	uint64 ParseFrom(const FastqDataChunk &chunk_, std::vector<FastqRecord> &records_, uint64 &rec_count_,
 					 StreamsInfo& streamsInfo_, uint64 tagPreserveFlags_);
+
+	void StartParsing(const FastqDataChunk& chunk_);
+	uint64 ParseNext(std::vector<FastqRecord> &records_, uint64 &rec_count_, uint64 maxCount_,
+					 StreamsInfo& streamsInfo_, uint64 tagPreserveFlags_);
+
+	uint64 ParsedSize() const
+	{
+		return memorySize - totalBytesCut - skippedBytes;
+	}
 	bool ReadNextRecord(FastqRecord& rec_, uchar* tagBuffer_, uint64 tagPreserveFlags_);
 
 private:
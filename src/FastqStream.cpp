@@ -71,7 +71,7 @@ bool IFastqStreamReader::ReadNextChunk(FastqDataChunk* chunk_)
 	return true;
 }
 
-uint64 IFastqStreamReader::GetNextRecordPos(uchar* data_, uint64 pos_, const uint64 size_)
+uint64 IFastqStreamReader::GetNextRecordPos(const uchar* data_, uint64 pos_, const uint64 size_)
 {
 	SkipToEol(data_, pos_, size_);
 	++pos_;
@@ -97,6 +97,78 @@ uint64 IFastqStreamReader::GetNextRecordPos(uchar* data_, uint64 pos_, const uin
 	return pos0;
 }
 
+
+FastqMappedFileReader::FastqMappedFileReader(const std::string& fileName_, uint64 chunkSize_)
+	:	file(fileName_)
+	,	chunkSize(chunkSize_)
+	,	position(0)
+{
+	ASSERT(chunkSize > SwapBufferSize);
+
+	file.AdviseSequential();
+	file.AdviseWillNeed(0, std::min(file.Size(), chunkSize * ReadAheadChunks));
+}
+
+bool FastqMappedFileReader::ReadNextChunk(FastqDataChunk* chunk_)
+{
+	if (Eof() || position >= file.Size())
+	{
+		eof = true;
+		chunk_->size = 0;
+		return false;
+	}
+
+	const uchar* data = file.Pointer() + position;
+	uint64 dataSize = file.Size() - position;
+
+	if (dataSize > chunkSize)	// somewhere before end
+	{
+		uint64 chunkEnd = GetNextRecordPos(data, chunkSize - SwapBufferSize, dataSize);
+		dataSize = chunkEnd;
+
+		chunk_->size = chunkEnd - 1;
+		if (usesCrlf)
+			chunk_->size -= 1;
+	}
+	else						// at the end of file
+	{
+		chunk_->size = dataSize - 1;	// skip the last EOF symbol
+		if (usesCrlf)
+			chunk_->size -= 1;
+
+		eof = true;
+	}
+
+	// copied, as the pool buffers are decoded into by the CRC32 check and
+	// extended by the compressors -- the mapping spares only the swap buffer
+	// copies and the reads of the buffered reader
+	if (chunk_->data.Size() < dataSize)
+		chunk_->data.Extend(dataSize);
+	std::copy(data, data + dataSize, chunk_->data.Pointer());
+
+	// the copied pages won't be used anymore
+	file.AdviseDontNeed(position, dataSize);
+	position += dataSize;
+
+	const uint64 readAhead = std::min(file.Size() - position, chunkSize * ReadAheadChunks);
+	if (readAhead > 0)
+		file.AdviseWillNeed(position, readAhead);
+
+	return true;
+}
+
+IFastqStreamReader* CreateFastqFileReader(const std::string& fileName_, uint64 chunkSize_)
+{
+	try
+	{
+		return new FastqMappedFileReader(fileName_, chunkSize_);
+	}
+	catch (const DsrcException& )
+	{}
+
+	return new FastqFileReader(fileName_);
+}
+
 } // namespace fq
 
 } // namespace dsrc
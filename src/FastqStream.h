@@ -26,7 +26,7 @@ namespace fq
 
 class IFastqStreamReader
 {
-private:
+protected:
 	static const uint32 SwapBufferSize = 1 << 13;
 
 public:
@@ -46,9 +46,9 @@ public:
 		return eof;
 	}
 
-	bool ReadNextChunk(FastqDataChunk* chunk_);
+	virtual bool ReadNextChunk(FastqDataChunk* chunk_);
 
-	void Close()
+	virtual void Close()
 	{
 		ASSERT(stream != NULL);
 		stream->Close();
@@ -63,15 +63,14 @@ protected:
 		return stream->Read(memory_, size_);
 	}
 
-private:
 	core::Buffer	swapBuffer;
 	uint64			bufferSize;
 	bool			eof;
 	bool			usesCrlf;
 
-	uint64 GetNextRecordPos(uchar* data_, uint64 pos_, const uint64 size_);
+	uint64 GetNextRecordPos(const uchar* data_, uint64 pos_, const uint64 size_);
 
-	void SkipToEol(uchar* data_, uint64& pos_, const uint64 size_)
+	void SkipToEol(const uchar* data_, uint64& pos_, const uint64 size_)
 	{
 		ASSERT(pos_ < size_);
 
@@ -132,6 +131,37 @@ public:
 	}
 };
 
+// reads the file through a memory mapping -- the chunks are copied once
+// into the pool buffers, without the reads and the swap buffer copies
+//
+class FastqMappedFileReader : public IFastqStreamReader
+{
+public:
+	FastqMappedFileReader(const std::string& fileName_, uint64 chunkSize_);
+
+	~FastqMappedFileReader()
+	{}
+
+	bool ReadNextChunk(FastqDataChunk* chunk_);
+
+	void Close()
+	{
+		file.Close();
+	}
+
+private:
+	static const uint64 ReadAheadChunks = 2;
+
+	core::MemoryMappedFile file;
+	uint64 chunkSize;
+	uint64 position;
+};
+
+// creates the memory-mapped reader if the file can be mapped,
+// falls back to the buffered file reader otherwise
+//
+IFastqStreamReader* CreateFastqFileReader(const std::string& fileName_, uint64 chunkSize_);
+
 class FastqFileWriter : public IFastqStreamWriter
 {
 public:
@@ -44,6 +44,14 @@
 
 #include <stdio.h>
 
+#if !defined (_WIN32)
+#	include <sys/types.h>
+#	include <sys/stat.h>
+#	include <sys/mman.h>
+#	include <fcntl.h>
+#	include <unistd.h>
+#endif
+
 namespace dsrc
 {
 
@@ -187,6 +195,118 @@ void FileStreamWriterExt::SetPosition(uint64 pos_)
 	position = pos_;
 }
 
+
+#if !defined (_WIN32)
+
+MemoryMappedFile::MemoryMappedFile(const std::string& fileName_)
+	:	memory(NULL)
+	,	size(0)
+	,	fileDesc(-1)
+{
+	fileDesc = open(fileName_.c_str(), O_RDONLY);
+	if (fileDesc == -1)
+	{
+		throw DsrcException(("Cannot open file to read: " + fileName_).c_str());
+	}
+
+	struct stat st;
+	if (fstat(fileDesc, &st) != 0 || !S_ISREG(st.st_mode))
+	{
+		close(fileDesc);
+		throw DsrcException(("Cannot map file: " + fileName_).c_str());
+	}
+
+	size = st.st_size;
+	if (size == 0)
+		return;
+
+	void* p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileDesc, 0);
+	if (p == MAP_FAILED)
+	{
+		close(fileDesc);
+		throw DsrcException(("Cannot map file: " + fileName_).c_str());
+	}
+	memory = (uchar*)p;
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+	if (fileDesc != -1)
+		Close();
+}
+
+void MemoryMappedFile::Close()
+{
+	ASSERT(fileDesc != -1);
+
+	if (memory != NULL)
+		munmap(memory, size);
+	close(fileDesc);
+
+	memory = NULL;
+	size = 0;
+	fileDesc = -1;
+}
+
+void MemoryMappedFile::AdviseSequential()
+{
+	if (memory != NULL)
+		madvise(memory, size, MADV_SEQUENTIAL);
+}
+
+void MemoryMappedFile::AdviseWillNeed(uint64 pos_, uint64 size_)
+{
+	ASSERT(pos_ + size_ <= size);
+
+	const uint64 pageSize = sysconf(_SC_PAGESIZE);
+	const uint64 begin = pos_ & ~(pageSize - 1);
+	const uint64 end = pos_ + size_;
+
+	if (end > begin)
+		madvise(memory + begin, end - begin, MADV_WILLNEED);
+}
+
+void MemoryMappedFile::AdviseDontNeed(uint64 pos_, uint64 size_)
+{
+	ASSERT(pos_ + size_ <= size);
+
+	// only the pages lying entirely inside the range can be dropped, as the
+	// boundary pages can still be shared with the neighbouring chunks
+	const uint64 pageSize = sysconf(_SC_PAGESIZE);
+	const uint64 begin = (pos_ + pageSize - 1) & ~(pageSize - 1);
+	const uint64 end = (pos_ + size_) & ~(pageSize - 1);
+
+	if (end > begin)
+		madvise(memory + begin, end - begin, MADV_DONTNEED);
+}
+
+#else
+
+MemoryMappedFile::MemoryMappedFile(const std::string& fileName_)
+	:	memory(NULL)
+	,	size(0)
+	,	fileDesc(-1)
+{
+	throw DsrcException(("Cannot map file: " + fileName_).c_str());
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{}
+
+void MemoryMappedFile::Close()
+{}
+
+void MemoryMappedFile::AdviseSequential()
+{}
+
+void MemoryMappedFile::AdviseWillNeed(uint64 , uint64 )
+{}
+
+void MemoryMappedFile::AdviseDontNeed(uint64 , uint64 )
+{}
+
+#endif
+
 } // namespace core
 
 } // namespace dsrc
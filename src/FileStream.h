@@ -100,6 +100,41 @@ private:
 	uint64 position;
 };
 
+
+// read-only mapping of the whole file
+//
+class MemoryMappedFile
+{
+public:
+	MemoryMappedFile(const std::string& fileName_);
+	~MemoryMappedFile();
+
+	void Close();
+
+	const uchar* Pointer() const
+	{
+		return memory;
+	}
+
+	uint64 Size() const
+	{
+		return size;
+	}
+
+	void AdviseSequential();
+	void AdviseWillNeed(uint64 pos_, uint64 size_);
+	void AdviseDontNeed(uint64 pos_, uint64 size_);
+
+private:
+	uchar* memory;
+	uint64 size;
+	int fileDesc;
+
+	MemoryMappedFile(const MemoryMappedFile&) {}
+	MemoryMappedFile& operator= (const MemoryMappedFile&)
+	{ return *this; }
+};
+
 } // namespace core
 
 } // namespace dsrc
@@ -0,0 +1,137 @@
+/*
+  This file is a part of DSRC software distributed under GNU GPL 2 licence.
+  The homepage of the DSRC project is http://sun.aei.polsl.pl/dsrc
+  
+  Authors: Lucas Roguski and Sebastian Deorowicz
+  
+  Version: 2.00
+*/
+
+#include "ModelDictionary.h"
+#include "BitMemory.h"
+#include "FileStream.h"
+#include "Crc32.h"
+
+#include <cstring>
+
+namespace dsrc
+{
+
+namespace comp
+{
+
+using namespace core;
+
+const char ModelDictionary::Magic[8] = {'D', 'S', 'R', 'C', 'D', 'I', 'C', 'T'};
+
+ModelDictionary::ModelDictionary()
+	:	dnaOrder(0)
+	,	dnaMixingLevel(0)
+	,	qualityOrder(0)
+	,	lossyQuality(false)
+	,	hash(0)
+{}
+
+void ModelDictionary::SetModels(const CompressionSettings& settings_,
+								const byte* dnaModels_, uint64 dnaSize_,
+								const byte* qualityModels_, uint64 qualitySize_)
+{
+	dnaOrder = settings_.dnaOrder;
+	dnaMixingLevel = settings_.dnaMixingLevel;
+	qualityOrder = settings_.qualityOrder;
+	lossyQuality = settings_.lossyQuality;
+	dnaModels.assign(dnaModels_, dnaModels_ + dnaSize_);
+	qualityModels.assign(qualityModels_, qualityModels_ + qualitySize_);
+
+	BitMemoryWriter writer(HeaderSize + dnaModels.size() + qualityModels.size());
+	StoreContents(writer);
+
+	Crc32Hasher hasher;
+	hash = hasher.ComputeHash(writer.Pointer(), (uint32)writer.Position());
+}
+
+void ModelDictionary::StoreContents(BitMemoryWriter& writer_) const
+{
+	writer_.PutBytes((const byte*)Magic, sizeof(Magic));
+	writer_.PutByte(Version);
+	writer_.PutByte(dnaOrder);
+	writer_.PutByte(qualityOrder);
+	writer_.PutByte(lossyQuality ? 1 : 0);
+	writer_.PutByte(dnaMixingLevel);
+
+	writer_.PutWord((uint32)dnaModels.size());
+	writer_.PutBytes(dnaModels.data(), dnaModels.size());
+	writer_.PutWord((uint32)qualityModels.size());
+	writer_.PutBytes(qualityModels.data(), qualityModels.size());
+}
+
+void ModelDictionary::Save(const std::string& filename_) const
+{
+	// the contents followed by their hash
+	BitMemoryWriter writer(HeaderSize + dnaModels.size() + qualityModels.size() + 4);
+	StoreContents(writer);
+	writer.PutWord(hash);
+
+	FileStreamWriter stream(filename_);
+	if (stream.Write(writer.Pointer(), writer.Position()) != (int64)writer.Position())
+		throw DsrcException(("Cannot write model dictionary: " + filename_).c_str());
+}
+
+void ModelDictionary::Load(const std::string& filename_)
+{
+	FileStreamReaderExt stream(filename_);
+	const uint64 size = stream.Size();
+
+	if (size < HeaderSize + 4 || size > (1ULL << 32))
+		throw DsrcException(("Invalid model dictionary: " + filename_).c_str());
+
+	Buffer buffer(size);
+	if (stream.Read(buffer.Pointer(), size) != (int64)size)
+		throw DsrcException(("Cannot read model dictionary: " + filename_).c_str());
+
+	BitMemoryReader reader(buffer.Pointer(), size);
+
+	char magic[sizeof(Magic)];
+	reader.GetBytes((byte*)magic, sizeof(Magic));
+	if (std::memcmp(magic, Magic, sizeof(Magic)) != 0)
+		throw DsrcException(("Invalid model dictionary: " + filename_).c_str());
+
+	const uint32 version = reader.GetByte();
+	if (version == 0 || version > Version)
+		throw DsrcException(("Unsupported model dictionary version: " + filename_).c_str());
+
+	BitMemoryReader hashReader(buffer.Pointer() + size - 4, 4);
+	const uint32 storedHash = hashReader.GetWord();
+
+	Crc32Hasher hasher;
+	if (hasher.ComputeHash(buffer.Pointer(), (uint32)(size - 4)) != storedHash)
+		throw DsrcException(("Corrupted model dictionary: " + filename_).c_str());
+
+	dnaOrder = reader.GetByte();
+	qualityOrder = reader.GetByte();
+	lossyQuality = reader.GetByte() != 0;
+	dnaMixingLevel = version >= 2 ? reader.GetByte() : 0;
+
+	if (dnaOrder > CompressionSettings::MaxDnaOrder || qualityOrder > CompressionSettings::MaxQualityOrder
+			|| dnaMixingLevel > CompressionSettings::MaxDnaMixingLevel)
+		throw DsrcException(("Corrupted model dictionary: " + filename_).c_str());
+
+	// the sizes are checked against the remaining bytes, the last 4 being the hash
+	const uint32 dnaSize = reader.GetWord();
+	if (dnaSize > size - 4 - reader.Position() - 4)
+		throw DsrcException(("Corrupted model dictionary: " + filename_).c_str());
+	dnaModels.resize(dnaSize);
+	reader.GetBytes(dnaModels.data(), dnaSize);
+
+	const uint32 qualitySize = reader.GetWord();
+	if (qualitySize != size - 4 - reader.Position())
+		throw DsrcException(("Corrupted model dictionary: " + filename_).c_str());
+	qualityModels.resize(qualitySize);
+	reader.GetBytes(qualityModels.data(), qualitySize);
+
+	hash = storedHash;
+}
+
+} // namespace comp
+
+} // namespace dsrc
@@ -0,0 +1,94 @@
+/*
+  This file is a part of DSRC software distributed under GNU GPL 2 licence.
+  The homepage of the DSRC project is http://sun.aei.polsl.pl/dsrc
+  
+  Authors: Lucas Roguski and Sebastian Deorowicz
+  
+  Version: 2.00
+*/
+
+#ifndef H_MODELDICTIONARY
+#define H_MODELDICTIONARY
+
+#include "../include/dsrc/Globals.h"
+
+#include <vector>
+#include <string>
+
+#include "Common.h"
+
+namespace dsrc
+{
+
+namespace comp
+{
+
+// the DNA and quality models trained on a sample of the data, e.g. of one
+// instrument or run type -- the blocks not continuing the models of the previous
+// ones start from them instead of the cleared models. The archive stores only
+// the hash of the dictionary, which needs to be given again to decompress it
+//
+class ModelDictionary
+{
+public:
+	static const uint32 Version = 2;		// v2: DNA mixing level
+
+	ModelDictionary();
+
+	void Load(const std::string& filename_);
+	void Save(const std::string& filename_) const;
+
+	// the models, as stored by the modelers of the given settings
+	void SetModels(const CompressionSettings& settings_,
+				   const byte* dnaModels_, uint64 dnaSize_,
+				   const byte* qualityModels_, uint64 qualitySize_);
+
+	// whether the models are the ones of the modelers of the settings
+	bool Matches(const CompressionSettings& settings_) const
+	{
+		return dnaOrder == settings_.dnaOrder
+				&& dnaMixingLevel == settings_.dnaMixingLevel
+				&& qualityOrder == settings_.qualityOrder
+				&& lossyQuality == settings_.lossyQuality;
+	}
+
+	bool IsEmpty() const
+	{
+		return dnaModels.empty() && qualityModels.empty();
+	}
+
+	uint32 Hash() const
+	{
+		return hash;
+	}
+
+	const std::vector<byte>& DnaModels() const
+	{
+		return dnaModels;
+	}
+
+	const std::vector<byte>& QualityModels() const
+	{
+		return qualityModels;
+	}
+
+private:
+	static const char Magic[8];
+	static const uint32 HeaderSize = 8 + 1 + 4 + 4 + 4;
+
+	uint32 dnaOrder;
+	uint32 dnaMixingLevel;
+	uint32 qualityOrder;
+	bool lossyQuality;
+	std::vector<byte> dnaModels;
+	std::vector<byte> qualityModels;
+	uint32 hash;
+
+	void StoreContents(core::BitMemoryWriter& writer_) const;
+};
+
+} // namespace comp
+
+} // namespace dsrc
+
+#endif // H_MODELDICTIONARY
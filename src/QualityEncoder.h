@@ -30,24 +30,26 @@ public:
 	static const uint32 TotalOrder = _TTotalOrder;
 
 	TQualityModelBase()
-		:	models(NULL)
+		:	models(ModelCount)
 		,	hash(0)
 		,	symBuffer(0)
+	{}
+
+	void Clear()
 	{
-		models = new Coder[ModelCount];
+		hash = 0;
+		symBuffer = 0;
+		models.Clear();
 	}
 
-	~TQualityModelBase()
+	void StoreModels(core::BitMemoryWriter& writer_) const
 	{
-		delete models;
+		StoreCoderStats(writer_, models);
 	}
 
-	void Clear()
+	void ReadModels(core::BitMemoryReader& reader_)
 	{
-		hash = 0;
-		symBuffer = 0;
-		CoderStatType* cd = (CoderStatType*)models;
-		std::fill(cd, cd + ModelCount * SymbolCount, 1);
+		ReadCoderStats(reader_, models);
 	}
 
 protected:
@@ -67,10 +69,9 @@ protected:
 	static const THash SymbolHashMask = (1ULL << (SymbolOrder * AlphabetBits)) - 1ULL;
 	static const THash SymbolContextBits = AlphabetBits * SymbolOrder;
 
-	typedef TSymbolCoderRC<AlphabetSize> Coder;
-	typedef typename Coder::StatType CoderStatType;
+	typedef typename TSymbolCoderSelector<AlphabetSize>::Coder Coder;
 
-	Coder* models;
+	TLazyCoderTable<Coder> models;
 	THash hash;
 	THash symBuffer;
 
@@ -24,6 +24,13 @@ public:
 	virtual void Encode(core::BitMemoryWriter& writer_, const fq::FastqRecord* records_, uint32 recordsCount_) = 0;
 	virtual void Decode(core::BitMemoryReader& reader_, fq::FastqRecord* records_, uint32 recordsCount_) = 0;
 
+	// resets the adaptive models, kept otherwise between the blocks
+	virtual void Clear() {}
+
+	// the adapted models, as kept by the model dictionaries
+	virtual void StoreModels(core::BitMemoryWriter& /*writer_*/) const {}
+	virtual void ReadModels(core::BitMemoryReader& /*reader_*/) {}
+
 protected:
 	static const uint32 MaxSymbolCount = 255;
 };
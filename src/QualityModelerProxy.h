@@ -158,6 +158,21 @@ public:
 		modeler->Decode(reader_, records_, recordsCount_);
 	}
 
+	void Clear()
+	{
+		modeler->Clear();
+	}
+
+	void StoreModels(core::BitMemoryWriter& writer_) const
+	{
+		modeler->StoreModels(writer_);
+	}
+
+	void ReadModels(core::BitMemoryReader& reader_)
+	{
+		modeler->ReadModels(reader_);
+	}
+
 private:
 	IQualityModeler* modeler;
 
@@ -202,6 +217,48 @@ public:
 		}
 	}
 
+	void Clear()
+	{
+		for (uint32 i = 0; i < ModelersCount; ++i)
+		{
+			if (modelers[i] != NULL)
+				modelers[i]->Clear();
+		}
+	}
+
+	// the models of each created scheme, preceded by the scheme id
+	void StoreModels(core::BitMemoryWriter& writer_) const
+	{
+		for (uint32 i = 0; i < ModelersCount; ++i)
+		{
+			if (modelers[i] != NULL)
+			{
+				writer_.PutByte(i);
+				modelers[i]->StoreModels(writer_);
+			}
+		}
+
+		writer_.PutByte(SchemeNone);
+	}
+
+	void ReadModels(core::BitMemoryReader& reader_)
+	{
+		for ( ;; )
+		{
+			if (reader_.Position() >= reader_.Size())
+				throw DsrcException("Corrupted model dictionary");
+
+			const SchemeId scheme = reader_.GetByte();
+			if (scheme == SchemeNone)
+				break;
+
+			if (scheme >= ModelersCount)
+				throw DsrcException("Corrupted model dictionary");
+
+			SelectModeler(scheme)->ReadModels(reader_);
+		}
+	}
+
 private:
 	static const uint32 ModelersCount = 4 * 2;
 
@@ -14,6 +14,7 @@
 #include "QualityEncoder.h"
 #include "Fastq.h"
 #include "QualityModeler.h"
+#include "RangeCoder.h"
 
 #include "huffman.h"
 #include "utils.h"
@@ -37,8 +38,6 @@ public:
 	{
 		encoder.Store(writer_);
 
-		model.Clear();
-
 		RangeEncoder coder(writer_);
 		coder.Start();
 
@@ -54,8 +53,6 @@ public:
 	{
 		encoder.Read(reader_);
 
-		model.Clear();
-
 		RangeDecoder coder(reader_);
 		coder.Start();
 
@@ -67,6 +64,21 @@ public:
 		coder.End();
 	}
 
+	void Clear()
+	{
+		model.Clear();
+	}
+
+	void StoreModels(core::BitMemoryWriter& writer_) const
+	{
+		model.StoreModels(writer_);
+	}
+
+	void ReadModels(core::BitMemoryReader& reader_)
+	{
+		model.ReadModels(reader_);
+	}
+
 private:
 	typedef _TQualityEncoder Encoder;
 	typedef typename Encoder::Model Model;
@@ -94,6 +106,9 @@ public:
 	using Super::Encode;
 	using Super::Decode;
 	using Super::ProcessStats;
+	using Super::Clear;
+	using Super::StoreModels;
+	using Super::ReadModels;
 
 };
 
@@ -114,6 +129,9 @@ public:
 	using Super::Encode;
 	using Super::Decode;
 	using Super::ProcessStats;
+	using Super::Clear;
+	using Super::StoreModels;
+	using Super::ReadModels;
 };
 
 /*
@@ -134,6 +152,9 @@ public:
 	using Super::Encode;
 	using Super::Decode;
 	using Super::ProcessStats;
+	using Super::Clear;
+	using Super::StoreModels;
+	using Super::ReadModels;
 };
 */
 
@@ -156,6 +177,9 @@ public:
 	using Super::Encode;
 	using Super::Decode;
 	using Super::ProcessStats;
+	using Super::Clear;
+	using Super::StoreModels;
+	using Super::ReadModels;
 };
 
 } // namespace comp
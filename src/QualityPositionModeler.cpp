@@ -196,14 +196,7 @@ void QualityPositionModelerPlain::DecodeRecords(BitMemoryReader &reader_, FastqR
 		uint32 nCount = 0;
 		for (uint32 j = 0; j < r.qualityLen; ++j)
 		{
-			uint32 bit = reader_.GetBits(positionContexts[j].GetMinLen());
-			int32 idx = positionContexts[j].DecodeFast(bit);
-
-			while (idx < 0)
-			{
-				bit = reader_.GetBit();
-				idx = positionContexts[j].Decode(bit);
-			};
+			int32 idx = positionContexts[j].DecodeSymbol(reader_);
 
 			r.quality[j] = symbols[idx];
 
@@ -308,14 +301,7 @@ void QualityPositionModelerTruncated::DecodeRecords(BitMemoryReader &reader_, Fa
 		uint32 nCount = 0;
 		for (uint32 j = 0; j < thLen; ++j)
 		{
-			uint32 bit = reader_.GetBits(positionContexts[j].GetMinLen());
-			int32 idx = positionContexts[j].DecodeFast(bit);
-
-			while (idx < 0)
-			{
-				bit = reader_.GetBit();
-				idx = positionContexts[j].Decode(bit);
-			};
+			int32 idx = positionContexts[j].DecodeSymbol(reader_);
 
 			ASSERT(idx < (int32)MaxSymbolCount);
 			r.quality[j] = symbols[idx];
@@ -425,14 +425,7 @@ void QualityRLEModeler::DecodeRuns(BitMemoryReader &reader_)
 		for (uint32 i = 0; i < runLength; ++i)
 		{
 			// decode quality
-			uint32 bit = reader_.GetBits(qContexts[prev].GetMinLen());
-			int32 idx = qContexts[prev].DecodeFast(bit);
-
-			while (idx < 0)
-			{
-				bit = reader_.GetBit();
-				idx = qContexts[prev].Decode(bit);
-			};
+			int32 idx = qContexts[prev].DecodeSymbol(reader_);
 
 			ASSERT((uint32)idx < qSymbolCount);
 			ASSERT(qSymbols[idx] != EmptySymbol);
@@ -440,14 +433,7 @@ void QualityRLEModeler::DecodeRuns(BitMemoryReader &reader_)
 			prev = idx;
 
 			// decode length
-			bit = reader_.GetBits(lContexts[prev].GetMinLen());
-			idx = lContexts[prev].DecodeFast(bit);
-
-			while (idx < 0)
-			{
-				bit = reader_.GetBit();
-				idx = lContexts[prev].Decode(bit);
-			};
+			idx = lContexts[prev].DecodeSymbol(reader_);
 
 			ASSERT((uint32)idx < lSymbolCount);
 			ASSERT(lSymbols[idx] != EmptySymbol);
@@ -67,7 +67,7 @@ bool RecordsBlockCompressor::ReadNextRecord(FastqRecord& rec_)
 
 void RecordsBlockCompressor::Feed(BitMemoryReader &memory_)
 {
-	compressor.ReadRecords(memory_, fastqBuffer);
+	compressor.ReadRecords(memory_, fastqBuffer, compressor.fieldsMask);
 	ASSERT(fastqBuffer.size > 0);
 
 	compressor.PostprocessRecords();
@@ -141,8 +141,8 @@ void RecordsBlockCompressor::InsertNewRecord(const FastqRecord& rec_)
 			fieldBeginPos = i + 1;
 		}
 
-		// skip copying the separator after the last token
-		if (bufferPos > 0 && bufferPos != fieldBeginPos)
+		// drop the separator (or the line end, when the last token is kept)
+		if (bufferPos > 0)
 			bufferPos -= 1;
 
 		r.title = p;
@@ -188,10 +188,20 @@ uint64 RecordsBlockCompressor::RecordSize(const FastqRecord& r_)
 void RecordsBlockCompressor::ExtractNextRecord(FastqRecord& rec_)
 {
 	fq::FastqRecord& r = compressor.records[recordsIdx];
+	const uint32 fieldsMask = compressor.fieldsMask;
 
-	rec_.tag.assign(r.title, r.title + r.titleLen);
-	rec_.sequence.assign(r.sequence, r.sequence + r.sequenceLen);
-	if (compressor.datasetType.plusRepetition)
+	// not selected fields are left empty
+	if ((fieldsMask & FastqFields::Tag) != 0)
+		rec_.tag.assign(r.title, r.title + r.titleLen);
+	else
+		rec_.tag.clear();
+
+	if ((fieldsMask & FastqFields::Sequence) != 0)
+		rec_.sequence.assign(r.sequence, r.sequence + r.sequenceLen);
+	else
+		rec_.sequence.clear();
+
+	if (compressor.datasetType.plusRepetition && !rec_.tag.empty())
 	{
 		rec_.plus = rec_.tag;
 		rec_.plus[0] = '+';
@@ -199,12 +209,16 @@ void RecordsBlockCompressor::ExtractNextRecord(FastqRecord& rec_)
 	else if (rec_.plus.length() != 1)
 	{
 		rec_.plus.assign(1, '+');
-		if (compressor.datasetType.plusRepetition)
+		if (compressor.datasetType.plusRepetition && !rec_.tag.empty())
 		{
 			rec_.plus.insert(rec_.plus.end(), rec_.tag.begin() + 1, rec_.tag.end());
 		}
 	}
-	rec_.quality.assign(r.quality, r.quality + r.qualityLen);
+
+	if ((fieldsMask & FastqFields::Quality) != 0)
+		rec_.quality.assign(r.quality, r.quality + r.qualityLen);
+	else
+		rec_.quality.clear();
 }
 
 } // namespace ext
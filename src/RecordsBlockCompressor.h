@@ -112,6 +112,12 @@ public:
 		rawChunkSize = 0;
 	}
 
+	void SkipToRecord(uint64 recordIdx_)
+	{
+		ASSERT(recordIdx_ <= recordsCount);
+		recordsIdx = recordIdx_;
+	}
+
 	void WriteNextRecord(const FastqRecord& rec_);
 	void Flush(core::BitMemoryWriter &memory_);
 
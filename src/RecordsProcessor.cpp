@@ -132,23 +132,38 @@ void IRecordsProcessor::FinalizeStats()
 	}
 }
 
-fq::FastqChecksum IRecordsProcessor::ProcessForward(FastqRecord *records_, uint64 recordsCount_, uint32 flags_)
+void IRecordsProcessor::StartForward(uint32 flags_)
 {
-	if (flags_ == fq::FastqChecksum::CALC_NONE)
+	InitializeStats();
+
+	checksumFlags = flags_;
+	fastqHasher.Reset();
+	fastqHasher.SetFlags(flags_);
+}
+
+void IRecordsProcessor::ProcessForward(FastqRecord *records_, uint64 recordsCount_)
+{
+	if (checksumFlags == fq::FastqChecksum::CALC_NONE)
 	{
 		for (uint64 i = 0; i < recordsCount_; ++i)
 			ProcessForward(records_[i]);
-		return fq::FastqChecksum();
+		return;
 	}
 
-	fastqHasher.Reset();
-	fastqHasher.SetFlags(flags_);
 	for (uint64 i = 0; i < recordsCount_; ++i)
 	{
 		fq::FastqRecord& r = records_[i];
 		fastqHasher.Update(r);
 		ProcessForward(r);
 	}
+}
+
+fq::FastqChecksum IRecordsProcessor::FinishForward()
+{
+	FinalizeStats();
+
+	if (checksumFlags == fq::FastqChecksum::CALC_NONE)
+		return fq::FastqChecksum();
 
 	return fastqHasher.GetChecksum();
 }
@@ -223,41 +238,52 @@ void LosslessRecordsProcessor::ProcessForward(FastqRecord &rec_)
 		ProcessFromColorSpace(rec_);
 	}
 
-	for (uint32 i = 0; i < rec_.sequenceLen; ++i)
+	// the record fields and the stats are kept in locals, as the byte
+	// stores would force reloading them on every symbol
+	uchar* sequence = rec_.sequence;
+	uchar* quality = rec_.quality;
+	const uint32 sequenceLen = rec_.sequenceLen;
+	const uchar qOffset = qualityOffset;
+	uint32* dnaFreqs = dnaStats.symbolFreqs;
+	uint32* qualityFreqs = qualityStats.symbolFreqs;
+	uint32 rleLength = qualityStats.rleLength;
+
+	for (uint32 i = 0; i < sequenceLen; ++i)
 	{
-		ASSERT(dnaToIndexTable[rec_.sequence[i]] != DnaStats::EmptySymbol);
-//		ASSERT(rec_.quality[i] >= qualityOffset && rec_.quality[i] - qualityOffset < 45);
+		ASSERT(dnaToIndexTable[sequence[i]] != DnaStats::EmptySymbol);
+//		ASSERT(quality[i] >= qualityOffset && quality[i] - qualityOffset < 45);
 
 		// transfom from symbol space to index space
-		rec_.sequence[i] = dnaToIndexTable[rec_.sequence[i]];
-		rec_.quality[i] -= qualityOffset;
+		const uchar s = dnaToIndexTable[sequence[i]];
+		uchar q = quality[i] - qOffset;
 
 		// check if the symbol differs from AGCT and whether can be transfered to quality stream
 		// ATM. only supports standard IUPAC symbols (for backward compatibility)
-		if (rec_.sequence[i] > 3 && rec_.quality[i] < 7 && rec_.sequence[i] <= 18)
+		if (s > 3 && q < 7 && s <= 18)
 		{
-			rec_.quality[i] += (uchar)(128 + (((uint32)rec_.sequence[i] - 3 + 1) << 3) - 16);
+			q += (uchar)(128 + (((uint32)s - 3 + 1) << 3) - 16);
 		}
 		else
 		{
-			rec_.sequence[seqLen++] = rec_.sequence[i];
+			sequence[seqLen++] = s;
 
 			// update DNA stats
-			dnaStats.symbolFreqs[rec_.sequence[i]]++;
+			dnaFreqs[s]++;
 		}
+		quality[i] = q;
 
 		// update quality stats
-		qualityStats.symbolFreqs[rec_.quality[i]]++;
+		qualityFreqs[q]++;
 
-		if (rec_.quality[i] != prevQSymbol)
-			qualityStats.rleLength++;
+		rleLength += (q != prevQSymbol);
 
-		if (rec_.quality[i] != HashSymbolNormal)
+		if (q != HashSymbolNormal)
 			curQThLen = i;
 
-		prevQSymbol = rec_.quality[i];
+		prevQSymbol = q;
 	}
 
+	qualityStats.rleLength = rleLength;
 	rec_.sequenceLen = seqLen;
 	rec_.truncatedLen = curQThLen;
 	rec_.truncatedLen += (uint16)(rec_.qualityLen > 0);
@@ -303,19 +329,14 @@ void LosslessRecordsProcessor::ProcessBackward(FastqRecord &rec_)
 
 	if (colorSpace)
 	{
-		uchar seq0, qua0;
+		// otherwise the first symbols are already decoded in place
+		uchar seq0 = rec_.sequence[0];
+		uchar qua0 = rec_.quality[0];
 		if (csStats.constBeginSym)
 		{
-			seq0 = csStats.seqBegin;
-			qua0 = csStats.quaBegin;
+			seq0 = dnaFromIndexTable[csStats.seqBegin];
+			qua0 = qualityOffset + csStats.quaBegin;
 		}
-		else
-		{
-			seq0 = rec_.sequence[0];
-			qua0 = rec_.quality[0];
-		}
-		seq0 = dnaFromIndexTable[seq0];
-		qua0 += qualityOffset;
 
 		ProcessToColorSpace(rec_, seq0, qua0);
 	}
@@ -358,45 +379,53 @@ void LossyRecordsProcessor::ProcessForward(FastqRecord &rec_)
 		ProcessFromColorSpace(rec_);
 	}
 
+	uchar* sequence = rec_.sequence;
+	uchar* quality = rec_.quality;
+	const uint32 sequenceLen = rec_.sequenceLen;
+	uint32* dnaFreqs = dnaStats.symbolFreqs;
+	uint32* qualityFreqs = qualityStats.symbolFreqs;
+	uint32 rleLength = qualityStats.rleLength;
+
 	uint32 seqLen = 0;
-	for (uint32 i = 0; i < rec_.sequenceLen; ++i)
+	for (uint32 i = 0; i < sequenceLen; ++i)
 	{
-		ASSERT(dnaToIndexTable[rec_.sequence[i]] != 255);
-		ASSERT(rec_.quality[i] >= qualityOffset && rec_.quality[i] - qualityOffset < 45);
+		ASSERT(dnaToIndexTable[sequence[i]] != 255);
+		ASSERT(quality[i] >= qualityOffset && quality[i] - qualityOffset < 45);
 
 		// transfom from symbol to index space
-		rec_.sequence[i] = dnaToIndexTable[rec_.sequence[i]];
-		rec_.quality[i] = qualityToIndexTable[rec_.quality[i] - qualityOffset];
+		const uchar s = dnaToIndexTable[sequence[i]];
+		// qualities past the binning range fall into the top bin
+		uchar q = qualityToIndexTable[MIN((uint32)(quality[i] - qualityOffset), 63U)];
 
 		// trim AMB code to N?
-		if (rec_.sequence[i] >= 4)
+		if (s >= 4)
 		{
 			// in most cases quality should be 0, if not - downgrade quality
-			if (rec_.quality[i] != 0)
-				rec_.quality[i] = 0;
+			q = 0;
 		}
 		else
 		{
 			// in most cases quality should be different from 0
-			if (rec_.quality[i] == 0)
-				rec_.quality[i] = 1;
+			if (q == 0)
+				q = 1;
 
-			rec_.sequence[seqLen++] = rec_.sequence[i];
+			sequence[seqLen++] = s;
 
-			dnaStats.symbolFreqs[rec_.sequence[i]]++;
+			dnaFreqs[s]++;
 		}
+		quality[i] = q;
 
-		qualityStats.symbolFreqs[rec_.quality[i]]++;
+		qualityFreqs[q]++;
 
-		if (rec_.quality[i] != prevQSymbol)
-			qualityStats.rleLength++;
+		rleLength += (q != prevQSymbol);
 
-		if (rec_.quality[i] != HashSymbolNormal)
+		if (q != HashSymbolNormal)
 			curQThLen = i;
 
-		prevQSymbol = rec_.quality[i];
+		prevQSymbol = q;
 	}
 
+	qualityStats.rleLength = rleLength;
 	rec_.sequenceLen = seqLen;
 
 	rec_.sequenceLen = seqLen;
@@ -442,19 +471,14 @@ void LossyRecordsProcessor::ProcessBackward(FastqRecord &rec_)
 
 	if (colorSpace)
 	{
-		uchar seq0, qua0;
+		// otherwise the first symbols are already decoded in place
+		uchar seq0 = rec_.sequence[0];
+		uchar qua0 = rec_.quality[0];
 		if (csStats.constBeginSym)
 		{
-			seq0 = csStats.seqBegin;
-			qua0 = csStats.quaBegin;
-		}
-		else
-		{
-			seq0 = rec_.sequence[0];
-			qua0 = rec_.quality[0];
+			seq0 = dnaFromIndexTable[csStats.seqBegin];
+			qua0 = qualityOffset + qualityFromIndexTable[csStats.quaBegin];
 		}
-		seq0 = dnaFromIndexTable[seq0];
-		qua0 += qualityOffset;
 
 		ProcessToColorSpace(rec_, seq0, qua0);
 	}
@@ -79,6 +79,7 @@ public:
 	IRecordsProcessor(uint32 qualityOffset_ = 33, bool colorSpace_ = false)
 		:	qualityOffset(qualityOffset_)
 		,	colorSpace(colorSpace_)
+		,	checksumFlags(fq::FastqChecksum::CALC_NONE)
 	{
 		ASSERT(qualityOffset_ >= 33 && qualityOffset_ <= 64);
 		// offset = 33 - standard Sanger + new Illumina
@@ -100,8 +101,8 @@ public:
 			csStats.seqBegin = rec_.sequence[0];
 			csStats.quaBegin = rec_.quality[0];
 		}
-		csStats.constBeginSym &= csStats.seqBegin == rec_.sequence[0];
-		ASSERT(!csStats.constBeginSym || csStats.quaBegin == rec_.quality[0]);
+		// the quality is restored from the block header as well
+		csStats.constBeginSym &= csStats.seqBegin == rec_.sequence[0] && csStats.quaBegin == rec_.quality[0];
 	}
 
 	void ProcessToColorSpace(fq::FastqRecord& rec_, uchar seq0, uchar qua0)
@@ -112,8 +113,13 @@ public:
 	virtual void InitializeStats();
 	virtual void FinalizeStats();
 
+	// the records can be processed forward in portions, the stats and
+	// the CRC32 checksum (if enabled) returned at finish cover all of them
+	void StartForward(uint32 flags_ = fq::FastqChecksum::CALC_NONE);
+	void ProcessForward(fq::FastqRecord* records_, uint64 recordsCount_);
+	fq::FastqChecksum FinishForward();
+
 	// returns CRC32 chekcsum if enabled
-	fq::FastqChecksum ProcessForward(fq::FastqRecord* records_, uint64 recordsCount_, uint32 flags_ = fq::FastqChecksum::CALC_NONE);
 	fq::FastqChecksum ProcessBackward(fq::FastqRecord* records_, uint64 recordsCount_, uint32 flags_ = fq::FastqChecksum::CALC_NONE);
 
 	const DnaStats& GetDnaStats() const
@@ -148,6 +154,7 @@ protected:
 	ColorSpaceStats csStats;
 
 	FastqChecksumHasher fastqHasher;
+	uint32 checksumFlags;
 
 private:
 	void ProcessRecordFromColorSpace(fq::FastqRecord& rec_);
@@ -12,7 +12,15 @@
 
 #include "../include/dsrc/Globals.h"
 
+#include <type_traits>
+#include <vector>
+
+#if defined(DSRC_USE_SSE2)
+#	include <emmintrin.h>
+#endif
+
 #include "RangeCoder.h"
+#include "utils.h"
 
 namespace dsrc
 {
@@ -32,6 +40,21 @@ public:
 		std::fill(stats, stats + MaxSymbolCount, 1);
 	}
 
+	void Clear()
+	{
+		std::fill(stats, stats + MaxSymbolCount, 1);
+	}
+
+	const StatType* Stats() const
+	{
+		return stats;
+	}
+
+	void SetStats(const StatType* stats_)
+	{
+		std::copy(stats_, stats_ + MaxSymbolCount, stats);
+	}
+
 	void EncodeSymbol(RangeEncoder& rc_, uint32 sym_)
 	{
 		ASSERT(sym_ < MaxSymbolCount);
@@ -62,7 +85,28 @@ public:
 		return idx;
 	}
 
-private:
+	// updates the stats as coding the symbol would, without coding it
+	void Update(uint32 sym_)
+	{
+		ASSERT(sym_ < MaxSymbolCount);
+
+		Accumulate();
+		stats[sym_] += StepSize;
+	}
+
+	// the most frequent symbol, the first one of the ties
+	uint32 TopSymbol() const
+	{
+		uint32 top = 0;
+		for (uint32 i = 1; i < MaxSymbolCount; ++i)
+		{
+			if (stats[i] > stats[top])
+				top = i;
+		}
+		return top;
+	}
+
+protected:
 	static const StatType StepSize = 2;
 	static const uint32 MaxAccumulatedValue = (1<<16) - MaxSymbolCount*StepSize;
 
@@ -92,6 +136,415 @@ private:
 	StatType stats[MaxSymbolCount];			// can be assumed to be uint16
 };
 
+// the same adaptive model as TSymbolCoderRC, producing the identical code stream,
+// but keeping a running total and the cumulative frequencies in a Fenwick tree,
+// so that coding a symbol takes O(log n) instead of O(n) operations
+//
+template <uint32 _TMaxSymbolCount>
+class TSymbolCoderFenwickRC
+{
+public:
+	typedef uint16 StatType;
+	static const uint32 MaxSymbolCount = _TMaxSymbolCount > 0 ? _TMaxSymbolCount : 1;
+
+	TSymbolCoderFenwickRC()
+	{
+		Clear();
+	}
+
+	void Clear()
+	{
+		std::fill(stats, stats + MaxSymbolCount, 1);
+		Rebuild();
+	}
+
+	const StatType* Stats() const
+	{
+		return stats;
+	}
+
+	void SetStats(const StatType* stats_)
+	{
+		std::copy(stats_, stats_ + MaxSymbolCount, stats);
+		Rebuild();
+	}
+
+	void EncodeSymbol(RangeEncoder& rc_, uint32 sym_)
+	{
+		ASSERT(sym_ < MaxSymbolCount);
+
+		if (total >= MaxAccumulatedValue)
+			Rescale();
+
+		rc_.EncodeFrequency(stats[sym_], LowEnd(sym_), total);
+
+		Update(sym_);
+	}
+
+	uint32 DecodeSymbol(RangeDecoder& rc_)
+	{
+		if (total >= MaxAccumulatedValue)
+			Rescale();
+
+		uint32 cul = rc_.GetCumulativeFreq(total);
+
+		// descend the tree looking for the last symbol with the low end <= cul
+		uint32 idx = 0;
+		uint32 rest = cul;
+		for (uint32 step = TopStep; step > 0; step >>= 1)
+		{
+			if (idx + step <= MaxSymbolCount && tree[idx + step - 1] <= rest)
+			{
+				idx += step;
+				rest -= tree[idx - 1];
+			}
+		}
+		ASSERT(idx < MaxSymbolCount);
+
+		rc_.UpdateFrequency(stats[idx], cul - rest, total);
+		Update(idx);
+		return idx;
+	}
+
+private:
+	static const StatType StepSize = 2;
+	static const uint32 MaxAccumulatedValue = (1<<16) - MaxSymbolCount*StepSize;
+	static const uint32 TopStep = 1 << core::TLog2<MaxSymbolCount>::Value;
+
+	// sum of the frequencies of symbols [0, sym_)
+	uint32 LowEnd(uint32 sym_) const
+	{
+		uint32 sum = 0;
+		for (uint32 i = sym_; i > 0; i &= i - 1)
+			sum += tree[i - 1];
+		return sum;
+	}
+
+	void Update(uint32 sym_)
+	{
+		stats[sym_] += StepSize;
+		for (uint32 i = sym_ + 1; i <= MaxSymbolCount; i += i & (0 - i))
+			tree[i - 1] += StepSize;
+		total += StepSize;
+	}
+
+	void Rescale()
+	{
+		for (uint32 i = 0; i < MaxSymbolCount; ++i)
+			stats[i] -= stats[i] >> 1;		// no '>>=' to avoid reducing stats to 0
+		Rebuild();
+	}
+
+	void Rebuild()
+	{
+		total = 0;
+		for (uint32 i = 0; i < MaxSymbolCount; ++i)
+		{
+			tree[i] = stats[i];
+			total += stats[i];
+		}
+
+		for (uint32 i = 1; i <= MaxSymbolCount; ++i)
+		{
+			uint32 parent = i + (i & (0 - i));
+			if (parent <= MaxSymbolCount)
+				tree[parent - 1] += tree[i - 1];
+		}
+	}
+
+	StatType stats[MaxSymbolCount];
+	StatType tree[MaxSymbolCount];			// 1-based Fenwick tree stored at [i - 1]
+	uint32 total;
+};
+
+#if defined(DSRC_USE_SSE2)
+
+// TSymbolCoderRC for the 4 and 8 symbol alphabets of the DNA models, whose stats
+// fit in a single SSE register -- encoding computes the prefix sums and rescales
+// all the symbols at once. Decoding is inherited: there the next context depends
+// on the decoded symbol and the predicted branches of the scalar search have
+// a shorter latency than the SSE prefix sums and search (see bench/SymbolCoderBench)
+//
+template <uint32 _TMaxSymbolCount>
+class TSymbolCoderSseRC : public TSymbolCoderRC<_TMaxSymbolCount>
+{
+	typedef TSymbolCoderRC<_TMaxSymbolCount> Super;
+
+public:
+	typedef typename Super::StatType StatType;
+	static const uint32 MaxSymbolCount = Super::MaxSymbolCount;
+
+	static_assert(MaxSymbolCount == 4 || MaxSymbolCount == 8, "unsupported alphabet size");
+
+	void EncodeSymbol(RangeEncoder& rc_, uint32 sym_)
+	{
+		ASSERT(sym_ < MaxSymbolCount);
+
+		__m128i s = Load();
+		__m128i cum = PrefixSums(s);
+		uint32 acc = _mm_extract_epi16(cum, MaxSymbolCount - 1);
+
+		if (acc >= Super::MaxAccumulatedValue)
+		{
+			s = _mm_sub_epi16(s, _mm_srli_epi16(s, 1));		// no '>>=' to avoid reducing stats to 0
+			cum = PrefixSums(s);
+			acc = _mm_extract_epi16(cum, MaxSymbolCount - 1);
+		}
+
+		StatType freqs[8];
+		StatType hiEnds[8];
+		_mm_storeu_si128((__m128i*)freqs, s);
+		_mm_storeu_si128((__m128i*)hiEnds, cum);
+
+		rc_.EncodeFrequency(freqs[sym_], hiEnds[sym_] - freqs[sym_], acc);
+
+		// the stats are updated and stored as a whole, a narrower store would
+		// not be forwarded to the next load of the same coder
+		const __m128i lanes = _mm_set_epi16(7, 6, 5, 4, 3, 2, 1, 0);
+		const __m128i step = _mm_and_si128(_mm_cmpeq_epi16(lanes, _mm_set1_epi16((short)sym_)),
+										   _mm_set1_epi16(Super::StepSize));
+		Store(_mm_add_epi16(s, step));
+	}
+
+private:
+	__m128i Load() const
+	{
+		if (MaxSymbolCount == 8)
+			return _mm_loadu_si128((const __m128i*)Super::stats);
+		return _mm_loadl_epi64((const __m128i*)Super::stats);
+	}
+
+	void Store(__m128i s_)
+	{
+		if (MaxSymbolCount == 8)
+			_mm_storeu_si128((__m128i*)Super::stats, s_);
+		else
+			_mm_storel_epi64((__m128i*)Super::stats, s_);
+	}
+
+	// inclusive prefix sums of the stats, the lanes past the alphabet are undefined
+	static __m128i PrefixSums(__m128i s_)
+	{
+		s_ = _mm_add_epi16(s_, _mm_slli_si128(s_, 2));
+		s_ = _mm_add_epi16(s_, _mm_slli_si128(s_, 4));
+		if (MaxSymbolCount == 8)
+			s_ = _mm_add_epi16(s_, _mm_slli_si128(s_, 8));
+		return s_;
+	}
+};
+
+#endif
+
+// the linear scans are faster for the mid-sized alphabets, while the tree pays off
+// for the larger quality alphabets and SSE for the DNA ones -- see bench/SymbolCoderBench
+//
+template <uint32 _TMaxSymbolCount>
+struct TSymbolCoderSelector
+{
+	static const uint32 FenwickMinSymbolCount = 64;
+
+	typedef typename std::conditional<(_TMaxSymbolCount >= FenwickMinSymbolCount),
+									  TSymbolCoderFenwickRC<_TMaxSymbolCount>,
+									  TSymbolCoderRC<_TMaxSymbolCount> >::type Coder;
+};
+
+#if defined(DSRC_USE_SSE2)
+
+template <>
+struct TSymbolCoderSelector<4>
+{
+	typedef TSymbolCoderSseRC<4> Coder;
+};
+
+template <>
+struct TSymbolCoderSelector<8>
+{
+	typedef TSymbolCoderSseRC<8> Coder;
+};
+
+#endif
+
+// the coders of the order-k models, cleared lazily: each coder is tagged with the
+// epoch of its last clear, Clear() only starts a new epoch and the coders of the
+// older ones are cleared on their first use. This way a block pays only for the
+// contexts it touches instead of clearing the whole (up to tens of MB) model
+//
+template <class _TCoder>
+class TLazyCoderTable
+{
+public:
+	typedef _TCoder Coder;
+
+	TLazyCoderTable(uint32 count_)
+		:	entries(NULL)
+		,	count(count_)
+		,	epoch(1)
+	{
+		entries = new Entry[count];
+		for (uint32 i = 0; i < count; ++i)
+			entries[i].epoch = epoch;
+	}
+
+	~TLazyCoderTable()
+	{
+		delete[] entries;
+	}
+
+	uint32 Size() const
+	{
+		return count;
+	}
+
+	void Clear()
+	{
+		// on the wrap-around all the tags are reset to an epoch older than the current one
+		if (++epoch == 0)
+		{
+			for (uint32 i = 0; i < count; ++i)
+				entries[i].epoch = 0;
+			epoch = 1;
+		}
+	}
+
+	Coder& operator[](uint32 idx_)
+	{
+		ASSERT(idx_ < count);
+
+		Entry& e = entries[idx_];
+		if (e.epoch != epoch)
+		{
+			e.coder.Clear();
+			e.epoch = epoch;
+		}
+		return e.coder;
+	}
+
+	// whether the coder is still in the cleared state of the current epoch
+	bool IsCleared(uint32 idx_) const
+	{
+		ASSERT(idx_ < count);
+		return entries[idx_].epoch != epoch;
+	}
+
+	// the coder as of its last use, valid only when not IsCleared()
+	const Coder& Peek(uint32 idx_) const
+	{
+		ASSERT(idx_ < count);
+		return entries[idx_].coder;
+	}
+
+private:
+	// the tag is stored next to the stats, so that checking it does not cost
+	// another cache miss
+	struct Entry
+	{
+		Coder coder;
+		uint16 epoch;
+	};
+
+	Entry* entries;
+	const uint32 count;
+	uint16 epoch;
+
+	TLazyCoderTable(const TLazyCoderTable&);
+	TLazyCoderTable& operator=(const TLazyCoderTable&);
+};
+
+// storage of the coder stats of the trained models: only the coders differing
+// from the cleared ones are written, each scaled down to the given total so that
+// the models still adapt quickly to the data they start coding
+//
+static const uint32 MaxStoredStatsTotal = 1 << 15;
+static const uint32 DefaultStoredStatsTotal = 16384;
+
+template <class _TCoder>
+void StoreCoderStats(core::BitMemoryWriter& writer_, const TLazyCoderTable<_TCoder>& coders_,
+					 uint32 statsLimit_ = DefaultStoredStatsTotal)
+{
+	typedef typename _TCoder::StatType StatType;
+	const uint32 symbolCount = _TCoder::MaxSymbolCount;
+	const uint32 count_ = coders_.Size();
+
+	ASSERT(statsLimit_ < MaxStoredStatsTotal);
+
+	std::vector<uint32> indices;
+	std::vector<StatType> stats;
+	StatType s[symbolCount];
+
+	for (uint32 i = 0; i < count_; ++i)
+	{
+		if (coders_.IsCleared(i))
+			continue;
+
+		std::copy(coders_.Peek(i).Stats(), coders_.Peek(i).Stats() + symbolCount, s);
+
+		uint32 total = 0;
+		for (uint32 j = 0; j < symbolCount; ++j)
+			total += s[j];
+
+		while (total > statsLimit_ && total > symbolCount)
+		{
+			total = 0;
+			for (uint32 j = 0; j < symbolCount; ++j)
+			{
+				s[j] -= s[j] >> 1;
+				total += s[j];
+			}
+		}
+
+		if (total == symbolCount)		// all the stats are 1
+			continue;
+
+		indices.push_back(i);
+		stats.insert(stats.end(), s, s + symbolCount);
+	}
+
+	writer_.PutWord(count_);
+	writer_.PutWord((uint32)indices.size());
+
+	for (uint32 i = 0; i < indices.size(); ++i)
+	{
+		writer_.PutWord(indices[i]);
+		for (uint32 j = 0; j < symbolCount; ++j)
+			writer_.Put2Bytes(stats[i * symbolCount + j]);
+	}
+}
+
+template <class _TCoder>
+void ReadCoderStats(core::BitMemoryReader& reader_, TLazyCoderTable<_TCoder>& coders_)
+{
+	typedef typename _TCoder::StatType StatType;
+	const uint32 symbolCount = _TCoder::MaxSymbolCount;
+	const uint32 count_ = coders_.Size();
+
+	if (reader_.Position() + 8 > reader_.Size() || reader_.GetWord() != count_)
+		throw DsrcException("Corrupted model dictionary");
+
+	const uint32 entries = reader_.GetWord();
+	if (entries > count_ || (reader_.Size() - reader_.Position()) / (4 + 2 * symbolCount) < entries)
+		throw DsrcException("Corrupted model dictionary");
+
+	StatType s[symbolCount];
+	for (uint32 i = 0; i < entries; ++i)
+	{
+		const uint32 idx = reader_.GetWord();
+
+		bool valid = idx < count_;
+		uint32 total = 0;
+		for (uint32 j = 0; j < symbolCount; ++j)
+		{
+			s[j] = reader_.Get2Bytes();
+			valid &= s[j] > 0;
+			total += s[j];
+		}
+
+		if (!valid || total >= MaxStoredStatsTotal)
+			throw DsrcException("Corrupted model dictionary");
+
+		coders_[idx].SetStats(s);
+	}
+}
+
 class SymbolCoderRC
 {
 public:
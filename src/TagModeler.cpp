@@ -265,7 +265,10 @@ void TagAnalyzer::UpdateFieldsStats(const FastqRecord &rec_)
 			cur_field.min_len = k - start_pos;
 		}
 
-		cur_field.chars.resize(cur_field.max_len);
+		const uint32 charsSize = MIN(cur_field.max_len, Field::MAX_FIELD_STAT_LEN + 1);
+		if (cur_field.chars.size() < charsSize)
+			cur_field.chars.resize(charsSize, std::vector<uint32>(Field::HUF_LOCAL_SIZE, 0));
+
 		uint32 chars_len = MIN(Field::MAX_FIELD_STAT_LEN, k-start_pos);
 
 		// count freqs
@@ -471,7 +474,7 @@ void TagAnalyzer::FinalizeFieldsStats()
 		{
 			if (!f->is_constant)
 			{
-				f->chars.resize(MIN(f->max_len, Field::MAX_FIELD_STAT_LEN+1));
+				f->chars.resize(MIN(f->max_len + 1, Field::MAX_FIELD_STAT_LEN+1), std::vector<uint32>(Field::HUF_LOCAL_SIZE, 0));
 				f->no_of_bits_per_len = core::bit_length(f->max_len - f->min_len);
 			}
 			continue;
@@ -1073,14 +1076,7 @@ void TagTokenizerDecoder::DecodeNextFields(BitMemoryReader &bit_stream, FastqRec
 			{
 				HuffmanEncoder *cur_huf = cur_field.Huffman_local[MIN(k, Field::MAX_FIELD_STAT_LEN)];
 
-				uint32 bit = bit_stream.GetBits(cur_huf->GetMinLen());
-				int32 h_tmp = cur_huf->DecodeFast(bit);
-
-				while (h_tmp < 0)
-				{
-					bit = bit_stream.GetBit();
-					h_tmp = cur_huf->Decode(bit);
-				};
+				int32 h_tmp = cur_huf->DecodeSymbol(bit_stream);
 
 				rec_.title[rec_.titleLen++] = h_tmp;
 			}
@@ -1150,14 +1146,7 @@ uint32 TagTokenizerDecoder::ReadNumericField(BitMemoryReader &bit_stream, Field
 			{
 				if (field_.Huffman_global)
 				{
-					uint32 bit = bit_stream.GetBits(field_.Huffman_global->GetMinLen());
-					int32 h_tmp = field_.Huffman_global->DecodeFast(bit);
-
-					while (h_tmp < 0)
-					{
-						bit = bit_stream.GetBit();
-						h_tmp = field_.Huffman_global->Decode(bit);
-					};
+					int32 h_tmp = field_.Huffman_global->DecodeSymbol(bit_stream);
 
 					num_val = h_tmp;
 				}
@@ -1324,13 +1313,7 @@ void TagRawDecoder::DecodeNextFields(BitMemoryReader &reader_, FastqRecord &rec_
 
 	for (uint32 i = 0; i < rec_.titleLen; ++i)
 	{
-		uint32 bit = reader_.GetBits(encoder->GetMinLen());
-		int32 sidx = encoder->DecodeFast(bit);
-		while (sidx < 0)
-		{
-			bit = reader_.GetBit();
-			sidx = encoder->Decode(bit);
-		};
+		int32 sidx = encoder->DecodeSymbol(reader_);
 
 		rec_.title[i] = symbols[sidx];
 	}
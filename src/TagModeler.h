@@ -85,7 +85,7 @@ struct Field
 	std::map<int32, int32> num_values;
 	std::map<int32, int32> delta_values;
 
-	std::vector<std::map<char,uint32> > chars;	// @ pos [char, count]
+	std::vector<std::vector<uint32> > chars;	// @ pos [char, count], positions past MAX_FIELD_STAT_LEN share the last one
 
 	Field();
 	Field(const Field& f_);
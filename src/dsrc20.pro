@@ -31,6 +31,7 @@ SOURCES += \
     DsrcWorker.cpp \
     DsrcOperator.cpp \
     DsrcIo.cpp \
+    ModelDictionary.cpp \
     RecordsBlockCompressor.cpp
 
 SOURCES += \
@@ -62,6 +63,8 @@ HEADERS += \
     DnaModeler.h \
     DnaModelerBasicB2.h \
     DnaModelerRCO.h \
+    DnaModelerHashed.h \
+    DnaModelerMixing.h \
     SymbolCoderRC.h \
     QualityPositionModeler.h \
     QualityRLEModeler.h \
@@ -82,6 +85,7 @@ HEADERS += \
     DsrcOperator.h \
     Common.h \
     Crc32.h \
+    ModelDictionary.h \
     ErrorHandler.h \
     RecordsBlockCompressor.h
 
@@ -28,7 +28,8 @@ HuffmanEncoder::HuffmanEncoder(uint32 initial_size)
 	,	cur_id(0)
 	,	tmp_id(0)
 	,	bits_per_id(0)
-	,	speedup_tree(NULL)
+	,	lookup(NULL)
+	,	lookup_bits(0)
 	,	bit_memory_r(NULL)
 	,	bit_memory_w(NULL)
 {
@@ -56,8 +57,8 @@ HuffmanEncoder::~HuffmanEncoder()
 	if (heap)
 		delete[] heap, heap = NULL;
 
-	if (speedup_tree)
-		delete[] speedup_tree, speedup_tree = NULL;
+	if (lookup)
+		delete[] lookup, lookup = NULL;
 
 	ASSERT(bit_memory_w == NULL);
 	ASSERT(bit_memory_r == NULL);
@@ -72,7 +73,8 @@ HuffmanEncoder::HuffmanEncoder(const HuffmanEncoder &encoder_)
 	,	cur_id(0)
 	,	tmp_id(0)
 	,	bits_per_id(0)
-	,	speedup_tree(NULL)
+	,	lookup(NULL)
+	,	lookup_bits(0)
 	,	bit_memory_r(NULL)
 	,	bit_memory_w(NULL)
 {
@@ -234,8 +236,10 @@ void HuffmanEncoder::LoadTree(core::BitMemoryReader &bit_stream)
 
 	root_id = bit_memory_r->GetWord();
 	n_symbols = bit_memory_r->GetWord();
-	ASSERT(n_symbols > 1);
-	ASSERT(n_symbols < (1 << 10));
+
+	// the tree shape comes from the stream, a corrupted block can describe any
+	if (n_symbols <= 1 || n_symbols >= (1 << 10) || (uint32)root_id < n_symbols - 1 || (uint32)root_id >= 2 * n_symbols)
+		throw DsrcException("corrupted Huffman tree");
 
 	tmp_id = root_id;
 	cur_id = root_id;
@@ -260,40 +264,68 @@ void HuffmanEncoder::LoadTree(core::BitMemoryReader &bit_stream)
 
 	if (!min_len)
 		min_len = 1;
-	ComputeSpeedupTree();
+	ComputeLookupTable();
 
 	ASSERT(memBegin + memSize == bit_memory_r->Position());
 	bit_memory_r = NULL;
 }
 
 // ********************************************************************************************
-void HuffmanEncoder::ComputeSpeedupTree()
+void HuffmanEncoder::ComputeLookupTable()
 {
-	if (!min_len)
-		return;
+	lookup_bits = TreeDepth(root_id);
+	if (lookup_bits > MaxLookupBits)
+		lookup_bits = MaxLookupBits;
+	ASSERT(lookup_bits > 0);
 
-	if (speedup_tree)
-		delete[] speedup_tree;
-	speedup_tree = new int32[(uint32) (1 << min_len)];
+	if (lookup)
+		delete[] lookup;
+	lookup = new LookupEntry[(uint32) (1 << lookup_bits)];
 
-	for (int32 i = 0; i < (1 << min_len); ++i)
-	{
-		cur_id = root_id;
-		for (int32 j = min_len-1; j >= 0; --j)
-		{
-			Decode(i & (1 << j));
-		}
-		speedup_tree[i] = cur_id;
-	}
+	FillLookupTable(root_id, 0, 0);
 
 	cur_id = root_id;
 	tmp_id = root_id;
 }
 
+// ********************************************************************************************
+uint32 HuffmanEncoder::TreeDepth(int32 node_id) const
+{
+	if (node_id <= 0)				// leaf
+		return 0;
+
+	return 1 + std::max(TreeDepth(tree[node_id].left_child), TreeDepth(tree[node_id].right_child));
+}
+
+// ********************************************************************************************
+void HuffmanEncoder::FillLookupTable(int32 node_id, uint32 depth, uint32 prefix)
+{
+	if (node_id <= 0)				// leaf -- all the entries starting with its code
+	{
+		ASSERT(depth > 0);
+
+		const uint32 shift = lookup_bits - depth;
+		const LookupEntry entry = {(uint16) -node_id, (uint16) depth};
+		std::fill(lookup + (prefix << shift), lookup + ((prefix + 1) << shift), entry);
+		return;
+	}
+
+	if (depth == lookup_bits)
+	{
+		const LookupEntry entry = {(uint16) node_id, 0};
+		lookup[prefix] = entry;
+		return;
+	}
+
+	FillLookupTable(tree[node_id].left_child, depth + 1, prefix << 1);
+	FillLookupTable(tree[node_id].right_child, depth + 1, (prefix << 1) | 1);
+}
+
 // ********************************************************************************************
 void HuffmanEncoder::Restart(uint32 _size)
 {
-	if (size != _size)
+	// the buffers left by RestartDecompress() are too small for encoding
+	if (size != _size || heap == NULL || codes == NULL)
 	{
 		size = _size;
 
@@ -303,8 +335,8 @@ void HuffmanEncoder::Restart(uint32 _size)
 			delete[] codes;
 		if (heap)
 			delete[] heap;
-		if (speedup_tree)
-			delete[] speedup_tree;
+		if (lookup)
+			delete[] lookup;
 
 		if (size)
 		{
@@ -320,7 +352,7 @@ void HuffmanEncoder::Restart(uint32 _size)
 			codes = NULL;
 			heap  = NULL;
 		}
-		speedup_tree = NULL;
+		lookup = NULL;
 	}
 
 	n_symbols = 0;
@@ -335,8 +367,8 @@ void HuffmanEncoder::RestartDecompress(uint32 _size, uint32 _root_id)
 		delete[] codes;
 	if (heap)
 		delete[] heap;
-	if (speedup_tree)
-		delete[] speedup_tree;
+	if (lookup)
+		delete[] lookup;
 
 
 	size = _size;
@@ -356,7 +388,7 @@ void HuffmanEncoder::RestartDecompress(uint32 _size, uint32 _root_id)
 	}
 	n_symbols = _size;
 
-	speedup_tree = NULL;
+	lookup = NULL;
 }
 
 } // namespace comp
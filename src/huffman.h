@@ -45,7 +45,7 @@ public:
 	void RestartDecompress(uint32 _size = 0, uint32 _root_id = 0);
 
 	inline bool Insert(const uint32 frequency);
-	inline int32 DecodeFast(const uint32 bits);
+	inline int32 DecodeSymbol(core::BitMemoryReader& bit_stream);
 
 	uint32 GetMinLen() const { return min_len; }
 	uint32 GetBitsPerId() const { return bits_per_id; }
@@ -81,6 +81,17 @@ private:
 		{}
 	};
 
+	// decoding table indexed by the next lookup_bits of the stream: either
+	// the symbol with its code length or, for the longer codes, the tree
+	// node reached after lookup_bits (len == 0)
+	struct LookupEntry
+	{
+		uint16 value;
+		uint16 len;
+	};
+
+	static const uint32 MaxLookupBits = 11;
+
 	uint32 size;
 	uint32 n_symbols;
 	uint32 min_len;
@@ -94,7 +105,8 @@ private:
 	Node *tree;
 	Frequency *heap;
 	Code *codes;
-	int32 *speedup_tree;
+	LookupEntry *lookup;
+	uint32 lookup_bits;
 
 	core::BitMemoryReader *bit_memory_r;
 	core::BitMemoryWriter *bit_memory_w;
@@ -102,7 +114,9 @@ private:
 	inline void EncodeProcess(int32 node_id);
 	inline int32 DecodeProcess(int32 node_id);
 
-	void ComputeSpeedupTree();
+	void ComputeLookupTable();
+	uint32 TreeDepth(int32 node_id) const;
+	void FillLookupTable(int32 node_id, uint32 depth, uint32 prefix);
 };
 
 // ********************************************************************************************
@@ -131,7 +145,8 @@ int32 HuffmanEncoder::DecodeProcess(int32 node_id)
 	//if (!flag)
 	if (!bit_memory_r->GetBit())
 	{
-		--tmp_id;
+		if (--tmp_id < 0)
+			throw DsrcException("corrupted Huffman tree");
 		tree[node_id].left_child  = DecodeProcess(tmp_id);
 		tree[node_id].right_child = DecodeProcess(tmp_id);
 		return node_id;
@@ -142,7 +157,10 @@ int32 HuffmanEncoder::DecodeProcess(int32 node_id)
 		//		tree[tmp].left_child  = -1;
 		//		tree[tmp].right_child = -1;
 		//return -(int32)tmp;
-		return -(int32)bit_memory_r->GetBits(bits_per_id);
+		uint32 symbol = bit_memory_r->GetBits(bits_per_id);
+		if (symbol >= size)
+			throw DsrcException("corrupted Huffman tree");
+		return -(int32)symbol;
 	}
 }
 
@@ -176,14 +194,23 @@ int32 HuffmanEncoder::Decode(const uint32 bit)
 }
 
 // ********************************************************************************************
-inline int32 HuffmanEncoder::DecodeFast(const uint32 bits)
+inline int32 HuffmanEncoder::DecodeSymbol(core::BitMemoryReader& bit_stream)
 {
-	cur_id = speedup_tree[bits];
-//	if (cur_id < n_symbols)
-	if (cur_id <= 0)
-		return -cur_id;				// Symbol found
-	
-	return -1;					// Not found yet
+	const LookupEntry entry = lookup[bit_stream.PeekBits(lookup_bits)];
+	if (entry.len != 0)
+	{
+		bit_stream.SkipBits(entry.len);
+		return entry.value;			// Symbol found
+	}
+
+	// code longer than the table -- continue bit by bit from the node reached
+	bit_stream.SkipBits(lookup_bits);
+	cur_id = entry.value;
+
+	int32 symbol;
+	while ((symbol = Decode(bit_stream.GetBit())) < 0)
+		;
+	return symbol;
 }
 
 
@@ -12,6 +12,7 @@
 
 #include <iostream>
 #include <cstring>
+#include <cstdlib>
 
 #include "Common.h"
 #include "utils.h"
@@ -26,10 +27,14 @@ struct InputArguments
 	{
 		None,
 		CompressMode,
-		DecompressMode
+		DecompressMode,
+		ExtractMode,
+		VerifyMode,
+		TrainMode
 	};
 
 	static const int MinArguments = 3;
+	static const int MinVerifyArguments = 2;		// no output file
 
 	ModeEnum mode;
 	std::string inputFilename;
@@ -42,22 +47,39 @@ struct InputArguments
 
 	bool verboseMode;
 
+	bool hasRecordsRange;
+	uint64 firstRecord;
+	uint64 recordsCount;
+
+	bool hasFieldsMask;
+	uint32 fieldsMask;
+
+	std::string modelDictionary;
+
 	InputArguments()
 		:	mode(None)
 		,	threadsNum(1)			// TODO: default
 		,	useFastqStdIo(false)
 		,	qualityOffset(0)		// TODO: default
 		,	verboseMode(false)
+		,	hasRecordsRange(false)
+		,	firstRecord(0)
+		,	recordsCount(0)
+		,	hasFieldsMask(false)
+		,	fieldsMask(FastqFields::All)
 	{}
 };
 
 void message();
 bool parse_arguments(int argc_, const char* argv_[], InputArguments& outArgs_);
+bool parse_range(const char* str_, uint64& first_, uint64& count_);
+bool parse_fields(const char* str_, uint32& fieldsMask_);
+bool parse_long_option(const char* name_, int& i_, int argc_, const char* argv_[], const char*& value_);
 
 int main(int argc_, const char* argv_[])
 {
 	InputArguments args;
-	if (argc_ < InputArguments::MinArguments + 1)
+	if (argc_ < InputArguments::MinVerifyArguments + 1)
 	{
 		message();
 		return -1;
@@ -70,6 +92,8 @@ int main(int argc_, const char* argv_[])
 
 	bool success = true;
 	DsrcModule dsrc;
+	dsrc.SetModelDictionary(args.modelDictionary);
+
 	if (args.mode == InputArguments::CompressMode)
 	{
 		success = dsrc.Compress(args.inputFilename,
@@ -79,12 +103,32 @@ int main(int argc_, const char* argv_[])
 								args.useFastqStdIo,
 								args.qualityOffset);
 	}
-	else
+	else if (args.mode == InputArguments::DecompressMode)
 	{
 		success = dsrc.Decompress(args.inputFilename,
 								  args.outputFilename,
 								  args.threadsNum,
-								  args.useFastqStdIo);
+								  args.useFastqStdIo,
+								  args.fieldsMask);
+	}
+	else if (args.mode == InputArguments::VerifyMode)
+	{
+		success = dsrc.Verify(args.inputFilename, args.threadsNum);
+	}
+	else if (args.mode == InputArguments::TrainMode)
+	{
+		success = dsrc.TrainDictionary(args.inputFilename,
+									   args.outputFilename,
+									   args.compSettings,
+									   args.qualityOffset);
+	}
+	else
+	{
+		success = dsrc.Extract(args.inputFilename,
+							   args.outputFilename,
+							   args.firstRecord,
+							   args.recordsCount,
+							   args.useFastqStdIo);
 	}
 
 	if (!success)
@@ -108,15 +152,28 @@ void message()
 {
 	std::cerr << "DSRC - DNA Sequence Reads Compressor\n";
 	std::cerr << "version: " << DsrcModule::Version() << "\n\n";
-	std::cerr << "usage: dsrc <c|d> [options] <input filename> <output filename>\n";
+	std::cerr << "usage: dsrc <c|d|x> [options] <input filename> <output filename>\n";
+	std::cerr << "       dsrc v [options] <input filename>\n";
+	std::cerr << "       dsrc t [options] <input FASTQ filename> <output dictionary filename>\n";
 	std::cerr << "compression options:\n";
-	std::cerr << "\t-d<n>\t: DNA compression mode: 0-3, default: " << DsrcCompressionSettings::DefaultDnaCompressionLevel << '\n';
+	std::cerr << "\t-d<n>\t: DNA compression mode: 0-5, default: " << DsrcCompressionSettings::DefaultDnaCompressionLevel << '\n';
 	std::cerr << "\t-q<n>\t: Quality compression mode: 0-2, default: " << DsrcCompressionSettings::DefaultQualityCompressionLevel << '\n';
 	std::cerr << "\t-f<1,..>: keep only those fields no. in tag field string, default: keep all" << '\n';
 	std::cerr << "\t-b<n>\t: FASTQ input buffer size in MB, default: " << DsrcCompressionSettings::DefaultFastqBufferSizeMB << '\n';
 	std::cerr << "\t-o<n>\t: Quality offset, default: " << FastqDatasetType::AutoQualityOffsetSelect << " (auto selection)\n";
 	std::cerr << "\t-l\t: use Quality lossy mode (Illumina binning scheme), default: false\n";
 	std::cerr << "\t-c\t: calculate and check CRC32 checksum calculation per block, default: false\n";
+	std::cerr << "\t--crc-store\t: calculate CRC32 checksums per block (as -c) without checking them, see 'dsrc v'\n";
+	std::cerr << "\t--parallel-streams\t: encode the quality and DNA streams of each block on two extra threads, default: false\n";
+	std::cerr << "\t--mix <n>\t: models mixed by the DNA mode 5: 1-3, from the fastest to the best ratio, default: "
+			  << DsrcCompressionSettings::DefaultDnaMixingLevel << '\n';
+	std::cerr << "\t--chain <n>\t: continue the DNA and Quality models of modes 1-5 over n blocks of each chain,\n";
+	std::cerr << "\t\t\t  for the better ratio of small blocks (-b), default: 0 (each block starts anew)\n";
+	std::cerr << "\t--chains <n>\t: interleaved model chains of --chain, compressed in parallel by up to n threads:\n";
+	std::cerr << "\t\t\t  " << DsrcCompressionSettings::MinModelChainCount << "-" << DsrcCompressionSettings::MaxModelChainCount
+			  << ", default: " << DsrcCompressionSettings::DefaultModelChainCount << '\n';
+	std::cerr << "\t--dict <file>\t: start the DNA and Quality models of modes 1-4 from the dictionary trained\n";
+	std::cerr << "\t\t\t  with 'dsrc t' (also needed to decompress, extract and verify the archive)\n";
 
 	std::cerr << "automated compression modes:\n";
 	std::cerr << "\t-m<n>\t: compression mode, where n:\n";
@@ -126,9 +183,25 @@ void message()
 	//std::cerr << "\t * 3\t- option (2) with lossy quality and field filtering (-d3 -q2 -b256 -l -f1,2)\n";
 
 	std::cerr << "both compression and decompression options:\n";
-	std::cerr << "\t-t<n>\t: processing threads number, default: " << DsrcModule::AvailableHardwareThreadsNum << "(available h/w threads), max: 64" << '\n';
+	std::cerr << "\t-t<n>\t: processing threads number, default: " << DsrcModule::AvailableHardwareThreadsNum << "(available h/w threads)" << '\n';
 	std::cerr << "\t-s\t: read FASTQ data from stdin (compression) or write FASTQ data to stdout (decompression)\n";
-	std::cerr << "\t-v\t: verbose mode, default: false\n\n";
+	std::cerr << "\t-v\t: verbose mode, default: false\n";
+
+	std::cerr << "extraction options:\n";
+	std::cerr << "\t--range <a:b>\t: extract records from a (inclusive) to b (exclusive), counted from 0;\n";
+	std::cerr << "\t\t\t  with b omitted extract records until the end of archive\n";
+
+	std::cerr << "decompression options:\n";
+	std::cerr << "\t--fields <f,..>\t: decompress only the selected record fields: tag, seq, qual;\n";
+	std::cerr << "\t\t\t  with not all of them selected, the fields are written one per line\n";
+
+	std::cerr << "verification:\n";
+	std::cerr << "\tdecodes the archive blocks on -t<n> threads checking their CRC32 checksums, no output\n";
+	std::cerr << "\tis written and the numbers of the corrupt blocks are reported\n";
+
+	std::cerr << "training:\n";
+	std::cerr << "\ttrains the DNA and Quality models of the compression options on the FASTQ file (e.g. a sample\n";
+	std::cerr << "\tof one instrument or run type) and saves them as the dictionary to compress with (--dict)\n\n";
 
 	std::cerr << "usage examples:\n";
 	std::cerr << "* compress SRR001471.fastq file saving DSRC archive to SRR001471.dsrc:\n";
@@ -145,20 +218,115 @@ void message()
 	std::cerr << "\tdsrc d SRR001471.dsrc SRR001471.out.fastq\n";
 	std::cerr << "* decompress archive using 4 threads and streaming raw FASTQ data to stdout:\n";
 	std::cerr << "\tdsrc d -t4 -s SRR001471.dsrc > SRR001471.out.fastq\n";
+	std::cerr << "* extract records 1000000-1999999 from SRR001471.dsrc archive:\n";
+	std::cerr << "\tdsrc x --range 1000000:2000000 SRR001471.dsrc SRR001471.part.fastq\n";
+	std::cerr << "* decompress only the reads sequences from SRR001471.dsrc archive:\n";
+	std::cerr << "\tdsrc d --fields seq SRR001471.dsrc SRR001471.seq\n";
+	std::cerr << "* compress storing the CRC32 checksums and check the archive later:\n";
+	std::cerr << "\tdsrc c -m0 --crc-store SRR001471.fastq SRR001471.dsrc\n";
+	std::cerr << "\tdsrc v SRR001471.dsrc\n";
+	std::cerr << "* compress in 1 MB blocks continuing the models over 16 blocks of each chain:\n";
+	std::cerr << "\tdsrc c -m1 -b1 --chain 16 SRR001471.fastq SRR001471.dsrc\n";
+	std::cerr << "* train the models on a sample of the run and compress the files of the run with them:\n";
+	std::cerr << "\tdsrc t -m1 SRR001471.sample.fastq SRR001471.dict\n";
+	std::cerr << "\tdsrc c -m1 --dict SRR001471.dict SRR001471.fastq SRR001471.dsrc\n";
+	std::cerr << "\tdsrc d --dict SRR001471.dict SRR001471.dsrc SRR001471.out.fastq\n";
 }
 
-bool parse_arguments(int argc_, const char* argv_[], InputArguments& outArgs_)
+bool parse_range(const char* str_, uint64& first_, uint64& count_)
 {
-	if (argc_ < InputArguments::MinArguments + 1)
+	char* end = NULL;
+	first_ = strtoull(str_, &end, 10);
+	if (end == str_ || *end != ':')
 		return false;
 
-	if (argv_[1][0] != 'c' && argv_[1][0] != 'd')
+	const char* last = end + 1;
+	if (*last == '\0')
 	{
-		std::cerr << "Error: invalid mode specified\n";
+		count_ = (uint64)-1;		// till the end of archive
+		return true;
+	}
+
+	uint64 lastRecord = strtoull(last, &end, 10);
+	if (end == last || *end != '\0' || lastRecord < first_)
 		return false;
+
+	count_ = lastRecord - first_;
+	return true;
+}
+
+bool parse_fields(const char* str_, uint32& fieldsMask_)
+{
+	fieldsMask_ = 0;
+
+	const char* beg = str_;
+	for (const char* end = str_; ; ++end)
+	{
+		if (*end != ',' && *end != '\0')
+			continue;
+
+		const std::string field(beg, end);
+		if (field == "tag")
+			fieldsMask_ |= FastqFields::Tag;
+		else if (field == "seq")
+			fieldsMask_ |= FastqFields::Sequence;
+		else if (field == "qual")
+			fieldsMask_ |= FastqFields::Quality;
+		else
+			return false;
+
+		if (*end == '\0')
+			break;
+		beg = end + 1;
+	}
+
+	return true;
+}
+
+// matches both "--name value" and "--name=value" forms,
+// value_ is set to NULL when missing
+bool parse_long_option(const char* name_, int& i_, int argc_, const char* argv_[], const char*& value_)
+{
+	const char* param = argv_[i_];
+	const size_t len = strlen(name_);
+
+	value_ = NULL;
+	if (strcmp(param, name_) == 0)
+	{
+		if (i_ + 1 < argc_ - 1)
+			value_ = argv_[++i_];
+		return true;
+	}
+
+	if (strncmp(param, name_, len) == 0 && param[len] == '=')
+	{
+		value_ = param + len + 1;
+		return true;
 	}
 
-	outArgs_.mode = (argv_[1][0] == 'c') ? InputArguments::CompressMode : InputArguments::DecompressMode;
+	return false;
+}
+
+bool parse_arguments(int argc_, const char* argv_[], InputArguments& outArgs_)
+{
+	switch (argv_[1][0])
+	{
+		case 'c':	outArgs_.mode = InputArguments::CompressMode;		break;
+		case 'd':	outArgs_.mode = InputArguments::DecompressMode;		break;
+		case 'x':	outArgs_.mode = InputArguments::ExtractMode;		break;
+		case 'v':	outArgs_.mode = InputArguments::VerifyMode;			break;
+		case 't':	outArgs_.mode = InputArguments::TrainMode;			break;
+		default:
+			std::cerr << "Error: invalid mode specified\n";
+			return false;
+	}
+
+	const bool verifyMode = outArgs_.mode == InputArguments::VerifyMode;
+	if (argc_ < (verifyMode ? InputArguments::MinVerifyArguments : InputArguments::MinArguments) + 1)
+	{
+		std::cerr << "Error: missing input or output filename\n";
+		return false;
+	}
 
 	outArgs_.compSettings = DsrcCompressionSettings::Default();
 	DsrcCompressionSettings& compSettings = outArgs_.compSettings;
@@ -237,6 +405,92 @@ bool parse_arguments(int argc_, const char* argv_[], InputArguments& outArgs_)
 			}
 
 			case 'v':	outArgs_.verboseMode = true;		break;
+
+			case '-':
+			{
+				const char* value = NULL;
+				if (strcmp(param, "--parallel-streams") == 0)
+				{
+					compSettings.parallelStreams = true;
+				}
+				else if (strcmp(param, "--crc-store") == 0)
+				{
+					compSettings.calculateCrc32 = true;
+					compSettings.verifyCrc32 = false;
+				}
+				else if (parse_long_option("--range", i, argc_, argv_, value))
+				{
+					if (value == NULL || !parse_range(value, outArgs_.firstRecord, outArgs_.recordsCount))
+					{
+						std::cerr << "Error: invalid records range specified, expected: --range <a:b>\n";
+						return false;
+					}
+					outArgs_.hasRecordsRange = true;
+				}
+				else if (parse_long_option("--chain", i, argc_, argv_, value))
+				{
+					char* end = NULL;
+					const unsigned long length = (value != NULL) ? strtoul(value, &end, 10) : 0;
+					if (value == NULL || end == value || *end != '\0' || length > DsrcCompressionSettings::MaxModelChainLength)
+					{
+						std::cerr << "Error: invalid model chain length specified, expected: --chain <0-"
+								  << DsrcCompressionSettings::MaxModelChainLength << ">\n";
+						return false;
+					}
+					compSettings.modelChainLength = (uint32)length;
+				}
+				else if (parse_long_option("--chains", i, argc_, argv_, value))
+				{
+					char* end = NULL;
+					const unsigned long count = (value != NULL) ? strtoul(value, &end, 10) : 0;
+					if (value == NULL || end == value || *end != '\0'
+							|| count < DsrcCompressionSettings::MinModelChainCount || count > DsrcCompressionSettings::MaxModelChainCount)
+					{
+						std::cerr << "Error: invalid model chains count specified, expected: --chains <"
+								  << DsrcCompressionSettings::MinModelChainCount << "-" << DsrcCompressionSettings::MaxModelChainCount << ">\n";
+						return false;
+					}
+					compSettings.modelChainCount = (uint32)count;
+				}
+				else if (parse_long_option("--mix", i, argc_, argv_, value))
+				{
+					char* end = NULL;
+					const unsigned long level = (value != NULL) ? strtoul(value, &end, 10) : 0;
+					if (value == NULL || end == value || *end != '\0'
+							|| level < DsrcCompressionSettings::MinDnaMixingLevel || level > DsrcCompressionSettings::MaxDnaMixingLevel)
+					{
+						std::cerr << "Error: invalid DNA mixing level specified, expected: --mix <"
+								  << DsrcCompressionSettings::MinDnaMixingLevel << "-" << DsrcCompressionSettings::MaxDnaMixingLevel << ">\n";
+						return false;
+					}
+					compSettings.dnaMixingLevel = (uint32)level;
+				}
+				else if (parse_long_option("--dict", i, argc_, argv_, value))
+				{
+					if (value == NULL || *value == '\0')
+					{
+						std::cerr << "Error: no model dictionary specified, expected: --dict <file>\n";
+						return false;
+					}
+					outArgs_.modelDictionary = value;
+				}
+				else if (parse_long_option("--fields", i, argc_, argv_, value))
+				{
+					if (value == NULL || !parse_fields(value, outArgs_.fieldsMask))
+					{
+						std::cerr << "Error: invalid record fields specified, expected: --fields <tag,seq,qual>\n";
+						return false;
+					}
+					outArgs_.hasFieldsMask = true;
+				}
+				else
+				{
+					std::cerr << "Error: invalid option: " << param << '\n';
+					return false;
+				}
+
+				break;
+			}
 		}
 	}
 
@@ -245,7 +499,11 @@ bool parse_arguments(int argc_, const char* argv_[], InputArguments& outArgs_)
 	//
 	outArgs_.inputFilename.clear();
 	outArgs_.outputFilename.clear();
-	if (!outArgs_.useFastqStdIo)
+	if (verifyMode)
+	{
+		outArgs_.inputFilename = argv_[argc_-1];
+	}
+	else if (!outArgs_.useFastqStdIo)
 	{
 		outArgs_.inputFilename = argv_[argc_-2];
 		outArgs_.outputFilename = argv_[argc_-1];
@@ -277,9 +535,13 @@ bool parse_arguments(int argc_, const char* argv_[], InputArguments& outArgs_)
 				fastqFilename = &outArgs_.inputFilename;
 			dsrcFilename = &outArgs_.outputFilename;
 		}
+		else if (outArgs_.mode == InputArguments::TrainMode)
+		{
+			fastqFilename = &outArgs_.inputFilename;
+		}
 		else
 		{
-			if (!outArgs_.useFastqStdIo)
+			if (!outArgs_.useFastqStdIo && !verifyMode)
 				fastqFilename = &outArgs_.outputFilename;
 			dsrcFilename = &outArgs_.inputFilename;
 		}
@@ -299,15 +561,34 @@ bool parse_arguments(int argc_, const char* argv_[], InputArguments& outArgs_)
 		return false;
 	}
 
-	if (outArgs_.threadsNum == 0 || outArgs_.threadsNum > 64)								// limit to 64 ATM ;)
+	if ((outArgs_.mode == InputArguments::ExtractMode) != outArgs_.hasRecordsRange)
+	{
+		std::cerr << "Error: records range (--range) must be specified in extraction mode only\n";
+		return false;
+	}
+
+	if (outArgs_.hasFieldsMask && outArgs_.mode != InputArguments::DecompressMode)
+	{
+		std::cerr << "Error: record fields (--fields) can be specified in decompression mode only\n";
+		return false;
+	}
+
+	if (outArgs_.mode == InputArguments::TrainMode && (outArgs_.useFastqStdIo || outArgs_.modelDictionary.length() > 0))
+	{
+		std::cerr << "Error: training reads a FASTQ file into a new dictionary, -s and --dict are not supported\n";
+		return false;
+	}
+	compSettings.modelDictionary = outArgs_.modelDictionary;
+
+	if (outArgs_.threadsNum == 0)
 	{
-		std::cerr << "Error: invalid thread number specified [1-64]\n";
+		std::cerr << "Error: invalid thread number specified (at least 1)\n";
 		return false;
 	}
 
 	if (compSettings.dnaCompressionLevel > DsrcCompressionSettings::MaxDnaCompressionLevel)
 	{
-		std::cerr << "Error: invalid DNA compression mode specified [0-3]\n";
+		std::cerr << "Error: invalid DNA compression mode specified [0-5]\n";
 		return false;
 	}
 
@@ -14,6 +14,10 @@
 
 #include <string>
 
+#if defined(DSRC_USE_SSE2)
+#	include <emmintrin.h>
+#endif
+
 namespace dsrc
 {
 
@@ -187,6 +191,20 @@ inline uint32 bit_length(uint64 x)
 	return 64;
 }
 
+// brings the cache line of the address in ahead of its use -- with GCC as asm,
+// since its optimizer treats the prefetch builtins as free of side effects and
+// drops the calls of the functions only prefetching
+inline void prefetch(const void* p_)
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	__asm__ __volatile__("prefetcht0 %0" : : "m"(*(const char*)p_));
+#elif defined(DSRC_USE_SSE2)
+	_mm_prefetch((const char*)p_, _MM_HINT_T0);
+#elif defined(__GNUC__)
+	__builtin_prefetch(p_);
+#endif
+}
+
 } // namespace core
 
 } // namespace dsrc
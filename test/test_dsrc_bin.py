@@ -1,6 +1,7 @@
 #!/usr/bin/python
 
 import os
+import random
 import sys
 
 # set this up to a local DSRC binary
@@ -14,6 +15,14 @@ dsrc_decompress_cmd = "%s d {params} {infile} {outfile}" % dsrc_exec
 dsrc_compress_stdio_cmd = "%s c -s {params} {outfile} < {infile}" % dsrc_exec
 dsrc_decompress_stdio_cmd = "%s d -s {params} {infile} > {outfile}" % dsrc_exec
 
+dsrc_extract_cmd = "%s x --range {range} {infile} {outfile}" % dsrc_exec
+
+dsrc_decompress_fields_cmd = "%s d --fields {fields} {infile} {outfile}" % dsrc_exec
+
+dsrc_verify_cmd = "%s v {params} {infile}" % dsrc_exec
+
+dsrc_train_cmd = "%s t {params} {infile} {outfile}" % dsrc_exec
+
 diff_cmd = "diff -q {infile} {outfile}"
 
 
@@ -32,6 +41,17 @@ def run_cmd(cmd_):
         raise RunException("Error running command: %s (exit status: %d)" % (cmd_, ret))
 
 
+def make_blocks_file(outfile_, recordsCount_ = 12000):
+    # random reads spanning a few 1 MB blocks, N with regular qualities
+    # keeps it in the DNA stream
+    rand = random.Random(1)
+    with open(outfile_, "w") as f:
+        for i in xrange(recordsCount_):
+            seq = "".join(rand.choice("ACGTACGTACGTN") for _ in xrange(100))
+            qua = "".join(chr(rand.randint(35, 73)) for _ in xrange(100))
+            f.write("@read_%d\n%s\n+\n%s\n" % (i, seq, qua))
+
+
 def perform_test(params_, infile_, checkOutput_ = True, usesStdio_ = False):
     dsrc_tmp_file = "__out.dsrc"
     fastq_tmp_file = "__out.fastq"
@@ -91,6 +111,265 @@ def perform_test(params_, infile_, checkOutput_ = True, usesStdio_ = False):
     return test_passed
     
 
+def perform_range_test(params_, infile_, first_, last_, expectValid_ = True):
+    dsrc_tmp_file = "__out.dsrc"
+    fastq_tmp_file = "__out.fastq"
+
+    # set-up : cleanup
+    if os.path.isfile(dsrc_tmp_file):
+        os.remove(dsrc_tmp_file)
+
+    if os.path.isfile(fastq_tmp_file):
+        os.remove(fastq_tmp_file)
+
+    # perform test
+    try:
+        print "Compressing..."
+        cmd = dsrc_compress_cmd.format(params=params_,
+                                       infile=infile_,
+                                       outfile=dsrc_tmp_file)
+        run_cmd(cmd)
+
+        print "Extracting..."
+        cmd = dsrc_extract_cmd.format(range="%d:%d" % (first_, last_),
+                                      infile=dsrc_tmp_file,
+                                      outfile=fastq_tmp_file)
+        if not expectValid_:
+            if os.system(cmd) == 0:
+                raise RunException("Extraction expected to fail: %s" % cmd)
+            if os.path.isfile(fastq_tmp_file):
+                raise RunException("Output left behind the failed extraction: %s" % cmd)
+        else:
+            run_cmd(cmd)
+
+            print "File check..."
+            with open(infile_) as f:
+                expected = f.readlines()[first_ * 4 : last_ * 4]
+            with open(fastq_tmp_file) as f:
+                extracted = f.readlines()
+            if expected != extracted:
+                raise RunException("Extracted records differ: %s [%d:%d]" % (infile_, first_, last_))
+
+    except RunException as exc:
+        print "FAIL: " + str(exc)
+        test_passed = False
+    else:
+        print "PASS"
+        test_passed = True
+
+    # tear-down : cleanup
+    #
+    if os.path.isfile(dsrc_tmp_file):
+        os.remove(dsrc_tmp_file)
+
+    if os.path.isfile(fastq_tmp_file):
+        os.remove(fastq_tmp_file)
+
+    return test_passed
+
+
+def perform_fields_test(params_, infile_, fields_):
+    dsrc_tmp_file = "__out.dsrc"
+    fastq_tmp_file = "__out.fastq"
+
+    # set-up : cleanup
+    if os.path.isfile(dsrc_tmp_file):
+        os.remove(dsrc_tmp_file)
+
+    if os.path.isfile(fastq_tmp_file):
+        os.remove(fastq_tmp_file)
+
+    # perform test
+    try:
+        print "Compressing..."
+        cmd = dsrc_compress_cmd.format(params=params_,
+                                       infile=infile_,
+                                       outfile=dsrc_tmp_file)
+        run_cmd(cmd)
+
+        print "Decompressing fields..."
+        cmd = dsrc_decompress_fields_cmd.format(fields=fields_,
+                                                infile=dsrc_tmp_file,
+                                                outfile=fastq_tmp_file)
+        run_cmd(cmd)
+
+        print "File check..."
+        # line numbers of the fields within a record
+        field_lines = {"tag" : 0, "seq" : 1, "qual" : 3}
+        selected = sorted([field_lines[f] for f in fields_.split(",")])
+        with open(infile_) as f:
+            lines = f.readlines()
+            expected = [lines[i] for i in range(len(lines)) if i % 4 in selected]
+        with open(fastq_tmp_file) as f:
+            decompressed = f.readlines()
+        if expected != decompressed:
+            raise RunException("Decompressed fields differ: %s [%s]" % (infile_, fields_))
+
+    except RunException as exc:
+        print "FAIL: " + str(exc)
+        test_passed = False
+    else:
+        print "PASS"
+        test_passed = True
+
+    # tear-down : cleanup
+    #
+    if os.path.isfile(dsrc_tmp_file):
+        os.remove(dsrc_tmp_file)
+
+    if os.path.isfile(fastq_tmp_file):
+        os.remove(fastq_tmp_file)
+
+    return test_passed
+
+
+def perform_verify_test(params_, verifyParams_, infile_, expectValid_ = True):
+    dsrc_tmp_file = "__out.dsrc"
+
+    # set-up : cleanup
+    if os.path.isfile(dsrc_tmp_file):
+        os.remove(dsrc_tmp_file)
+
+    # perform test
+    try:
+        print "Compressing..."
+        cmd = dsrc_compress_cmd.format(params=params_,
+                                       infile=infile_,
+                                       outfile=dsrc_tmp_file)
+        run_cmd(cmd)
+
+        print "Verifying..."
+        cmd = dsrc_verify_cmd.format(params=verifyParams_,
+                                     infile=dsrc_tmp_file)
+        if expectValid_:
+            run_cmd(cmd)
+        elif os.system(cmd) == 0:
+            raise RunException("Verification expected to fail: %s" % cmd)
+
+    except RunException as exc:
+        print "FAIL: " + str(exc)
+        test_passed = False
+    else:
+        print "PASS"
+        test_passed = True
+
+    # tear-down : cleanup
+    #
+    if os.path.isfile(dsrc_tmp_file):
+        os.remove(dsrc_tmp_file)
+
+    return test_passed
+
+
+def perform_corrupt_test(params_, decompParams_, infile_):
+    dsrc_tmp_file = "__out.dsrc"
+    fastq_tmp_file = "__out.fastq"
+
+    # set-up : cleanup
+    if os.path.isfile(dsrc_tmp_file):
+        os.remove(dsrc_tmp_file)
+
+    # perform test
+    try:
+        print "Compressing..."
+        cmd = dsrc_compress_cmd.format(params=params_,
+                                       infile=infile_,
+                                       outfile=dsrc_tmp_file)
+        run_cmd(cmd)
+
+        # damage the data of the first block
+        with open(dsrc_tmp_file, "r+b") as f:
+            f.seek(60)
+            data = bytearray(f.read(340))
+            f.seek(60)
+            f.write(bytearray(b ^ 0xff for b in data))
+
+        print "Decompressing..."
+        cmd = dsrc_decompress_cmd.format(params=decompParams_,
+                                         infile=dsrc_tmp_file,
+                                         outfile=fastq_tmp_file)
+        # reported as an error, not aborted by a signal
+        ret = os.system(cmd)
+        if not os.WIFEXITED(ret) or os.WEXITSTATUS(ret) != 255:
+            raise RunException("Decompression expected to report an error: %s (exit status: %d)" % (cmd, ret))
+
+    except RunException as exc:
+        print "FAIL: " + str(exc)
+        test_passed = False
+    else:
+        print "PASS"
+        test_passed = True
+
+    # tear-down : cleanup
+    #
+    if os.path.isfile(dsrc_tmp_file):
+        os.remove(dsrc_tmp_file)
+
+    if os.path.isfile(fastq_tmp_file):
+        os.remove(fastq_tmp_file)
+
+    return test_passed
+
+
+def perform_dictionary_test(params_, infile_):
+    dict_tmp_file = "__out.dict"
+    dsrc_tmp_file = "__out.dsrc"
+    fastq_tmp_file = "__out.fastq"
+
+    # set-up : cleanup
+    for f in [dict_tmp_file, dsrc_tmp_file, fastq_tmp_file]:
+        if os.path.isfile(f):
+            os.remove(f)
+
+    # perform test
+    try:
+        print "Training..."
+        cmd = dsrc_train_cmd.format(params=params_,
+                                    infile=infile_,
+                                    outfile=dict_tmp_file)
+        run_cmd(cmd)
+
+        print "Compressing..."
+        dict_params = "%s --dict %s" % (params_, dict_tmp_file)
+        cmd = dsrc_compress_cmd.format(params=dict_params,
+                                       infile=infile_,
+                                       outfile=dsrc_tmp_file)
+        run_cmd(cmd)
+
+        print "Decompressing without the dictionary..."
+        cmd = dsrc_decompress_cmd.format(params=params_,
+                                         infile=dsrc_tmp_file,
+                                         outfile=fastq_tmp_file)
+        if os.system(cmd) == 0:
+            raise RunException("Decompression expected to fail: %s" % cmd)
+
+        print "Decompressing..."
+        cmd = dsrc_decompress_cmd.format(params=dict_params,
+                                         infile=dsrc_tmp_file,
+                                         outfile=fastq_tmp_file)
+        run_cmd(cmd)
+
+        print "File check..."
+        cmd = diff_cmd.format(infile=infile_,
+                              outfile=fastq_tmp_file)
+        run_cmd(cmd)
+
+    except RunException as exc:
+        print "FAIL: " + str(exc)
+        test_passed = False
+    else:
+        print "PASS"
+        test_passed = True
+
+    # tear-down : cleanup
+    #
+    for f in [dict_tmp_file, dsrc_tmp_file, fastq_tmp_file]:
+        if os.path.isfile(f):
+            os.remove(f)
+
+    return test_passed
+
+
 def run_tests(dir_):
 
     if not os.path.isdir(dir_):
@@ -120,7 +399,105 @@ def run_tests(dir_):
 
                 tests_results.append((fq_file, th, m, test_f2f_passed))
                 tests_results.append((fq_file, th, m, test_f2s_passed))
-            
+
+        # streams of each block encoded concurrently
+        #
+        for params in ["-t1 -m1 --parallel-streams", "-t4 -m2 --parallel-streams"]:
+            print "** Running case: (%s + file+file) ****" % params
+            test_streams_passed = perform_test(params, fq_file_path, True)
+
+            tests_results.append((fq_file, "c", params, test_streams_passed))
+
+        # hashed high-order DNA models
+        #
+        for params in ["-t1 -d4 -q1 -c", "-t4 -d4 -q2 -b1"]:
+            print "** Running case: (%s + file+file) ****" % params
+            test_hashed_passed = perform_test(params, fq_file_path, True)
+
+            tests_results.append((fq_file, "h", params, test_hashed_passed))
+
+        # mixed DNA context models
+        #
+        for params in ["-t1 -d5 --mix 1 -q1 -c", "-t4 -d5 --mix 3 -q2 -b1 --chain 2"]:
+            print "** Running case: (%s + file+file) ****" % params
+            test_mixing_passed = perform_test(params, fq_file_path, True)
+
+            tests_results.append((fq_file, "m", params, test_mixing_passed))
+
+        # models continued over the blocks of each chain
+        #
+        for params in ["-t1 -m1 -b1 --chain 4 --chains 3 -c", "-t4 -m2 -b1 --chain 3 -c"]:
+            print "** Running case: (%s + file+file) ****" % params
+            test_chain_passed = perform_test(params, fq_file_path, True)
+
+            tests_results.append((fq_file, "k", params, test_chain_passed))
+
+        # models starting from the trained dictionary
+        #
+        for params in ["-t1 -m1 -c", "-t4 -m2 -b1 --chain 2"]:
+            print "** Running case: (%s + dictionary) ****" % params
+            test_dict_passed = perform_dictionary_test(params, fq_file_path)
+
+            tests_results.append((fq_file, "t", params, test_dict_passed))
+
+        # records range extraction
+        #
+        with open(fq_file_path) as f:
+            records_count = len(f.readlines()) / 4
+        ranges = [(0, records_count, True), (records_count / 2, records_count, True),
+                  (records_count, records_count, True), (records_count + 1, records_count + 2, False)]
+        for r in ranges:
+            params = "-t4 -m0 -b1"
+            print "** Running case: (%s + range %d:%d) ****" % (params, r[0], r[1])
+            test_range_passed = perform_range_test(params, fq_file_path, r[0], r[1], r[2])
+
+            tests_results.append((fq_file, "x", "%d:%d" % r[:2], test_range_passed))
+
+        # the range decoded from the beginning of its model chains
+        params = "-t4 -m1 -b1 --chain 2"
+        print "** Running case: (%s + range %d:%d) ****" % (params, records_count / 2, records_count)
+        test_range_passed = perform_range_test(params, fq_file_path, records_count / 2, records_count)
+
+        tests_results.append((fq_file, "x", params, test_range_passed))
+
+        # selective fields decompression
+        #
+        for fields in ["seq", "qual", "tag,seq"]:
+            params = "-t4 -m1"
+            print "** Running case: (%s + fields %s) ****" % (params, fields)
+            test_fields_passed = perform_fields_test(params, fq_file_path, fields)
+
+            tests_results.append((fq_file, "d", fields, test_fields_passed))
+
+        # archive verification, the checksums stored with and without
+        # checking them at compression, the blocks verified in parallel
+        #
+        for params, verify_params, valid in [("-t4 -m1 -c", "-t1", True), ("-t1 -m0 --crc-store", "-t1", True),
+                                             ("-t4 -m0 -b1 --crc-store", "-t4", True), ("-t1 -m0", "-t4", False)]:
+            print "** Running case: (%s + verify %s) ****" % (params, verify_params)
+            test_verify_passed = perform_verify_test(params, verify_params, fq_file_path, valid)
+
+            tests_results.append((fq_file, "v", params, test_verify_passed))
+
+    # the Huffman coders reused after the verification of the previous block
+    #
+    blocks_file = "__blocks.fastq"
+    make_blocks_file(blocks_file)
+    for params in ["-t1 -m0 -b1 -c", "-t1 -d0 -q1 -b1 -c --parallel-streams"]:
+        print "** Running case: (%s + multiple blocks) ****" % params
+        test_blocks_passed = perform_test(params, blocks_file, True)
+
+        tests_results.append((blocks_file, "b", params, test_blocks_passed))
+
+    # the corrupt block reported by the decompression threads
+    #
+    for params, decomp_params in [("-t1 -m1 -b1", "-t1"), ("-t4 -m2 -b1", "-t4")]:
+        print "** Running case: (%s + corrupt %s) ****" % (params, decomp_params)
+        test_corrupt_passed = perform_corrupt_test(params, decomp_params, blocks_file)
+
+        tests_results.append((blocks_file, "e", params, test_corrupt_passed))
+    os.remove(blocks_file)
+
     return tests_results
 
     # TODO: exhaustive test